@@ -0,0 +1,143 @@
+/*
+==============================================================================
+
+BoxCuller.h
+Created: 17 October 2026 8:05pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define how the renderer tests a list of axis-aligned bounding boxes
+*  against the view frustum, several boxes at a time.
+*/
+
+#ifndef BOXCULLER_H_INCLUDED
+#define BOXCULLER_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <cmath>
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #include <emmintrin.h>
+ #define BOXCULLER_USE_SSE2 1
+#else
+ #define BOXCULLER_USE_SSE2 0
+#endif
+
+
+
+//==============================================================================
+/**
+*  Holds a list of axis-aligned boxes and finds which of them are at least partly inside a
+*  set of planes, such as the six sides of a view frustum.
+*
+*  A box is outside if, for any plane, its corner furthest along the plane's normal is still
+*  behind it. That corner's distance is the distance of the box's centre plus the box's
+*  half-extents weighted by the absolute values of the normal, so each test is two dot
+*  products and no branches. Like any plane-by-plane test, it keeps a few boxes that sit
+*  just outside a corner of the frustum, but it never drops one that can be seen.
+*
+*  The boxes are stored as separate arrays of centres and half-extents, one per axis, padded
+*  to a multiple of four, so that with SSE2 each plane is tested against four boxes in one
+*  go. Without it, the same arithmetic runs one box at a time.
+*/
+class BoxCuller
+{
+public:
+	BoxCuller() noexcept : numBoxes(0) {}
+
+	/** Removes all the boxes. */
+	void clear()
+	{
+		for (auto* a : { &centreX, &centreY, &centreZ, &extentX, &extentY, &extentZ })
+			a->clearQuick();
+
+		numBoxes = 0;
+	}
+
+	/** Adds a box by its lowest and highest corners, and returns its index. */
+	int add(const float* low, const float* high)
+	{
+		// Keep the arrays a multiple of four long, padding with empty boxes at the origin
+		if (numBoxes % 4 == 0)
+			for (auto* a : { &centreX, &centreY, &centreZ, &extentX, &extentY, &extentZ })
+				a->insertMultiple(-1, 0.0f, 4);
+
+		centreX.set(numBoxes, (low[0] + high[0]) * 0.5f);
+		centreY.set(numBoxes, (low[1] + high[1]) * 0.5f);
+		centreZ.set(numBoxes, (low[2] + high[2]) * 0.5f);
+		extentX.set(numBoxes, (high[0] - low[0]) * 0.5f);
+		extentY.set(numBoxes, (high[1] - low[1]) * 0.5f);
+		extentZ.set(numBoxes, (high[2] - low[2]) * 0.5f);
+
+		return numBoxes++;
+	}
+
+	int size() const noexcept      { return numBoxes; }
+
+	/** Replaces the contents of visible with the indices, in order, of the boxes that aren't
+		wholly behind any of the planes. Each plane is a, b, c, d, with a point p in front of it
+		when a*p.x + b*p.y + c*p.z + d >= 0; the normals needn't be unit length.
+	*/
+	void findVisible(const float (*planes)[4], int numPlanes, Array<int>& visible) const
+	{
+		visible.clearQuick();
+
+	   #if BOXCULLER_USE_SSE2
+		for (auto first = 0; first < numBoxes; first += 4)
+		{
+			auto cx = _mm_loadu_ps(centreX.begin() + first), cy = _mm_loadu_ps(centreY.begin() + first);
+			auto cz = _mm_loadu_ps(centreZ.begin() + first);
+			auto ex = _mm_loadu_ps(extentX.begin() + first), ey = _mm_loadu_ps(extentY.begin() + first);
+			auto ez = _mm_loadu_ps(extentZ.begin() + first);
+			auto outside = _mm_setzero_ps();
+
+			for (auto i = 0; i < numPlanes; ++i)
+			{
+				auto* p = planes[i];
+				auto distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(p[0])), _mm_mul_ps(cy, _mm_set1_ps(p[1]))),
+										   _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(p[2])), _mm_set1_ps(p[3])));
+				auto reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::abs(p[0]))), _mm_mul_ps(ey, _mm_set1_ps(std::abs(p[1])))),
+										_mm_mul_ps(ez, _mm_set1_ps(std::abs(p[2]))));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+			}
+
+			auto inside = ~_mm_movemask_ps(outside) & 15;
+
+			for (auto i = 0; i < 4 && first + i < numBoxes; ++i)
+				if ((inside & (1 << i)) != 0)
+					visible.add(first + i);
+		}
+	   #else
+		for (auto box = 0; box < numBoxes; ++box)
+		{
+			auto isOutside = false;
+
+			for (auto i = 0; i < numPlanes && !isOutside; ++i)
+			{
+				auto* p = planes[i];
+				auto distance = centreX.getUnchecked(box) * p[0] + centreY.getUnchecked(box) * p[1]
+							  + centreZ.getUnchecked(box) * p[2] + p[3];
+				auto reach = extentX.getUnchecked(box) * std::abs(p[0]) + extentY.getUnchecked(box) * std::abs(p[1])
+						   + extentZ.getUnchecked(box) * std::abs(p[2]);
+				isOutside = distance + reach < 0.0f;
+			}
+
+			if (!isOutside)
+				visible.add(box);
+		}
+	   #endif
+	}
+
+private:
+	Array<float> centreX, centreY, centreZ;
+	Array<float> extentX, extentY, extentZ;
+	int numBoxes;
+};
+
+
+#endif  // BOXCULLER_H_INCLUDED
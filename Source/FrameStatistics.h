@@ -0,0 +1,196 @@
+/*
+==============================================================================
+
+FrameStatistics.h
+Created: 17 October 2026 10:05pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define the record of recent frames that the OpenGL view's performance
+*  overlay summarises and exports.
+*/
+
+#ifndef FRAMESTATISTICS_H_INCLUDED
+#define FRAMESTATISTICS_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <algorithm>
+
+
+
+//==============================================================================
+/**
+*  Keeps the last few thousand frames' timings and counts in a ring, and works out rolling
+*  percentiles over the newest of them.
+*
+*  The render thread adds a Sample per frame, and the message thread reads them for the
+*  overlay or to write a CSV file, so every access takes a SpinLock; each one only copies a
+*  fixed-size sample, or the samples it asked for.
+*
+*  A GPU time arrives a few frames after the frame it measured, so it's written into that
+*  frame's sample afterwards with setGpuMilliseconds(). Until then, and for any frame the GPU
+*  timer couldn't measure, the sample's GPU time stays negative.
+*/
+class FrameStatistics
+{
+public:
+	enum
+	{
+		defaultCapacity = 3600   // a minute at 60 frames a second
+	};
+
+	struct Sample
+	{
+		int64 frameNumber;
+		float frameMilliseconds;      // since the frame before; negative unless both were active
+		float renderMilliseconds;     // spent in render(), on the CPU
+		float gpuMilliseconds;        // negative where there's no GPU time
+		int drawCalls;
+		int64 triangles, bytesUploaded;
+		int modelIndex;               // which model was shown, for the CSV file to name
+		bool usedVertexArrays;
+		float levelOfDetailThreshold;
+	};
+
+	/** The value below which a fraction of the samples fall. */
+	struct Percentiles
+	{
+		float p50, p95, p99;
+		int numSamples;   // 0 if there weren't any, in which case they're all 0
+	};
+
+	explicit FrameStatistics(int capacity = defaultCapacity)
+		: numAdded(0)
+	{
+		samples.insertMultiple(-1, Sample(), jmax(1, capacity));
+	}
+
+	void add(const Sample& sample) noexcept
+	{
+		const SpinLock::ScopedLockType lock(samplesLock);
+		samples.getReference((int)(numAdded % samples.size())) = sample;
+		++numAdded;
+	}
+
+	/** Fills in the GPU time of the sample with this frame number, if it's still kept. The
+		samples must have been added in order of their frame numbers.
+	*/
+	void setGpuMilliseconds(int64 frameNumber, float milliseconds) noexcept
+	{
+		const SpinLock::ScopedLockType lock(samplesLock);
+		auto oldest = jmax((int64)0, numAdded - (int64)samples.size());
+
+		// It's only ever a few frames back, so this starts from the newest
+		for (auto i = numAdded - 1; i >= oldest; --i)
+		{
+			auto& sample = samples.getReference((int)(i % samples.size()));
+
+			if (sample.frameNumber <= frameNumber)
+			{
+				if (sample.frameNumber == frameNumber)
+					sample.gpuMilliseconds = milliseconds;
+
+				return;
+			}
+		}
+	}
+
+	void clear() noexcept
+	{
+		const SpinLock::ScopedLockType lock(samplesLock);
+		numAdded = 0;
+	}
+
+	/** Returns up to maxSamples of the newest samples, oldest first. */
+	Array<Sample> getRecent(int maxSamples) const
+	{
+		Array<Sample> recent;
+
+		const SpinLock::ScopedLockType lock(samplesLock);
+		auto numAvailable = (int)jmin(numAdded, (int64)samples.size());
+		auto count = jmin(maxSamples, numAvailable);
+		recent.ensureStorageAllocated(count);
+
+		for (auto i = numAdded - count; i < numAdded; ++i)
+			recent.add(samples.getReference((int)(i % samples.size())));
+
+		return recent;
+	}
+
+	/** Works out the percentiles of one of the samples' timings, leaving out negative values. */
+	static Percentiles getPercentiles(const Array<Sample>& fromSamples, float Sample::* field)
+	{
+		Array<float> values;
+		values.ensureStorageAllocated(fromSamples.size());
+
+		for (auto& sample : fromSamples)
+			if (sample.*field >= 0.0f)
+				values.add(sample.*field);
+
+		Percentiles result = { 0.0f, 0.0f, 0.0f, values.size() };
+
+		if (values.isEmpty())
+			return result;
+
+		std::sort(values.begin(), values.end());
+
+		// The nearest-rank percentile: the smallest value with at least that share at or below it
+		auto percentile = [&values](float fraction)
+		{
+			auto rank = (int)std::ceil(fraction * (float)values.size());
+			return values.getUnchecked(jlimit(0, values.size() - 1, rank - 1));
+		};
+
+		result.p50 = percentile(0.50f);
+		result.p95 = percentile(0.95f);
+		result.p99 = percentile(0.99f);
+		return result;
+	}
+
+	/** Writes every sample that's still kept to a CSV file, a row per frame with a header row.
+		modelNames gives the name to write for each Sample::modelIndex.
+	*/
+	Result writeCsv(const File& file, const StringArray& modelNames) const
+	{
+		auto recent = getRecent(samples.size());
+
+		String csv;
+		csv.preallocateBytes((size_t)(recent.size() + 1) * 96);
+		csv << "frame,model,vertex_arrays,lod_threshold,frame_ms,render_ms,gpu_ms,draw_calls,triangles,uploaded_bytes\n";
+
+		for (auto& s : recent)
+		{
+			// Empty cells where there's no measurement, so that a spreadsheet leaves them out too
+			csv << s.frameNumber << ","
+				<< modelNames[s.modelIndex].replace("\"", "\"\"").quoted() << ","
+				<< (s.usedVertexArrays ? 1 : 0) << ","
+				<< String(s.levelOfDetailThreshold, 2) << ","
+				<< (s.frameMilliseconds >= 0.0f ? String(s.frameMilliseconds, 3) : String()) << ","
+				<< String(s.renderMilliseconds, 3) << ","
+				<< (s.gpuMilliseconds >= 0.0f ? String(s.gpuMilliseconds, 3) : String()) << ","
+				<< s.drawCalls << ","
+				<< s.triangles << ","
+				<< s.bytesUploaded << "\n";
+		}
+
+		if (!file.replaceWithText(csv))
+			return Result::fail("Cannot write file: " + file.getFullPathName());
+
+		return Result::ok();
+	}
+
+private:
+	Array<Sample> samples;
+	int64 numAdded;
+	SpinLock samplesLock;
+
+	JUCE_DECLARE_NON_COPYABLE(FrameStatistics)
+};
+
+
+#endif  // FRAMESTATISTICS_H_INCLUDED
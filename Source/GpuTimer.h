@@ -0,0 +1,132 @@
+/*
+==============================================================================
+
+GpuTimer.h
+Created: 18 October 2026 2:05am
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define the timer queries that measure how long the GPU spends on each
+*  of the OpenGL view's frames.
+*/
+
+#ifndef GPUTIMER_H_INCLUDED
+#define GPUTIMER_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "OptionalGLFunctions.h"
+
+
+
+//==============================================================================
+/**
+*  Measures how long the GPU takes over each frame with GL_TIME_ELAPSED queries.
+*
+*  A query's result is only ready some frames after it ends, so there's a ring of them,
+*  each tagged with the number of the frame it measures, and collect() takes whichever
+*  have finished without waiting for the rest. If the next query in the ring still hasn't
+*  finished by the time it's needed again, that frame just isn't measured. Without timer
+*  queries, nothing is measured at all.
+*/
+struct GpuTimer
+{
+	enum { numQueries = 4 };
+
+	/** A finished measurement, and the frame it belongs to. */
+	struct Result
+	{
+		int64 frameNumber;
+		float milliseconds;
+	};
+
+	GpuTimer(const OptionalGLFunctions& optionalFunctions)
+		: functions(optionalFunctions), nextQuery(0), isTiming(false)
+	{
+		for (auto i = 0; i < numQueries; ++i)
+		{
+			queries[i] = 0;
+			frameNumbers[i] = 0;
+			isPending[i] = false;
+		}
+
+		if (functions.hasTimerQueries())
+			functions.genQueries(numQueries, queries);
+	}
+
+	~GpuTimer()
+	{
+		if (functions.hasTimerQueries())
+			functions.deleteQueries(numQueries, queries);
+	}
+
+	bool isAvailable() const noexcept    { return functions.hasTimerQueries(); }
+
+	/** Starts timing the frame with this number, which collect() hands back with its time. */
+	void begin(int64 frameNumber)
+	{
+		isTiming = isAvailable() && !isPending[nextQuery];
+
+		if (isTiming)
+		{
+			frameNumbers[nextQuery] = frameNumber;
+			functions.beginQuery(GL_TIME_ELAPSED, queries[nextQuery]);
+		}
+	}
+
+	void end()
+	{
+		if (!isTiming)
+			return;
+
+		functions.endQuery(GL_TIME_ELAPSED);
+		isPending[nextQuery] = true;
+		nextQuery = (nextQuery + 1) % numQueries;
+		isTiming = false;
+	}
+
+	/** Replaces results with every time that has come back since the last call, oldest first,
+		leaving it empty if none have.
+	*/
+	void collect(Array<Result>& results)
+	{
+		results.clearQuick();
+
+		// The queries finish in the order they were made, starting with the one begin() reuses next
+		for (auto i = 0; i < numQueries; ++i)
+		{
+			auto query = (nextQuery + i) % numQueries;
+
+			if (!isPending[query])
+				continue;
+
+			GLuint isReady = 0;
+			functions.getQueryObjectuiv(queries[query], GL_QUERY_RESULT_AVAILABLE, &isReady);
+
+			if (isReady == 0)
+				break;
+
+			juce::uint64 nanoseconds = 0;
+			functions.getQueryObjectui64v(queries[query], GL_QUERY_RESULT, &nanoseconds);
+			results.add({ frameNumbers[query], (float)((double)nanoseconds / 1.0e6) });
+			isPending[query] = false;
+		}
+	}
+
+private:
+	const OptionalGLFunctions& functions;
+	GLuint queries[numQueries];
+	int64 frameNumbers[numQueries];
+	bool isPending[numQueries];
+	int nextQuery;
+	bool isTiming;
+
+	JUCE_DECLARE_NON_COPYABLE(GpuTimer)
+};
+
+
+#endif  // GPUTIMER_H_INCLUDED
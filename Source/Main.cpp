@@ -10,6 +10,9 @@ Author:  Akira DeMoss
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "MainComponent.h"
+#include "Tests/ObjParserBenchmark.h"
+#include "Tests/ProjectUnitTests.h"
+#include "MeshConverter.h"
 
 
 //==============================================================================
@@ -32,10 +35,31 @@ public:
 	}
 
     //==============================================================================
-    void initialise (const String& ) override
+    void initialise (const String& commandLine) override
     {
         // This method is where you should put your application's initialisation code..
 
+        if (ObjParserBenchmark::isBenchmarkCommand (commandLine))
+        {
+            setApplicationReturnValue (ObjParserBenchmark::run (commandLine));
+            quit();
+            return;
+        }
+
+        if (MeshConverter::isConvertCommand (commandLine))
+        {
+            setApplicationReturnValue (MeshConverter::run (commandLine));
+            quit();
+            return;
+        }
+
+        if (ProjectUnitTests::isUnitTestCommand (commandLine))
+        {
+            setApplicationReturnValue (ProjectUnitTests::run (commandLine));
+            quit();
+            return;
+        }
+
         mainWindow = new MainWindow (getApplicationName());
     }
 
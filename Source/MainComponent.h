@@ -21,7 +21,13 @@ Author:  Akira DeMoss
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "JDockableWindows.h"
 #include "JAdvancedDock.h"
-#include <map>
+#include "WavefrontObjFile.h"
+#include "BoxCuller.h"
+#include "ProgramBinaryCache.h"
+#include "FrameStatistics.h"
+#include "OptionalGLFunctions.h"
+#include "StagingRing.h"
+#include "GpuTimer.h"
 
 
 
@@ -132,461 +138,577 @@ private:
 
 //==============================================================================
 /**
-*  Adding This in from the OpenGLAppTutorial so that we can incorporate an additional OpenGLView.
-*  To complete this concept, we would use a strategy similar to how we passed am object
-*  reference of the ImageView class to the FileBrowser class, so that when the
-*  listener detects an appropriate file that is selected, the the OpenGLView will change.
-*  However, this is slightly different in the respect that in the Shape struct, we are
-*  directly referencing the Resources directory.  We will leave this up to future work while
-*  observing the proof of concept with the ImageView example.
+*  This component lives inside our window, and this is where you should put all
+*  your controls and content.
 */
-class WavefrontObjFile
+class OpenGLView : public OpenGLAppComponent,
+				   private Timer
 {
 public:
-	WavefrontObjFile() {}
-
-	Result load(const String& objFileContent)
+//==============================================================================
+	OpenGLView(const String & componentName)
+		: levelOfDetailThreshold(1.0f), useVertexArrayObjects(true), renderMode(onDemandRendering),
+		  frameInvalidated(true), animationFrame(0), numActiveFrames(0), numIdleFrames(0),
+		  showStressScene(false), renderModeBeforeStressScene(onDemandRendering), lastFrameStartTime(0.0),
+		  lastFrameWasActive(false), averageFrameMilliseconds(0.0f), averageRenderMilliseconds(0.0f),
+		  shaderProgramWasCached(false), shaderMilliseconds(0.0f), shaderMillisecondsSaved(0.0f),
+		  showPerformanceOverlay(false)
 	{
-		shapes.clear();
-		return parseObjFile(StringArray::fromLines(objFileContent));
+		Component::setName(componentName);
+		//openGLContext.attachTo(*this);
+		setSize(800, 600);
+		setRenderMode(onDemandRendering);
+
+		// The model is parsed on its own thread, so neither this thread nor the GL
+		// thread has to wait for it; render() uploads it once it's ready.
+		modelLoader.startLoading(findResourceFile("humanoid_quad.obj"), getModelLoadOptions());
+		startTimerHz(10);
 	}
 
-	Result load(const File& file)
+	~OpenGLView()
 	{
-		sourceFile = file;
-		return load(file.loadFileAsString());
+		shutdownOpenGL();
+		jassertfalse;
 	}
 
-	//==============================================================================
-	typedef juce::uint32 Index;
-
-	struct Vertex { float x, y, z; };
-	struct TextureCoord { float x, y; };
-
-	struct Mesh
+	void initialise() override
 	{
-		Array<Vertex> vertices, normals;
-		Array<TextureCoord> textureCoords;
-		Array<Index> indices;
-	};
+		functions.reset(new OptionalGLFunctions());
+		stagingRing.reset(new StagingRing(openGLContext, *functions));
+		gpuTimer.reset(new GpuTimer(*functions));
+		createShaders();
+	}
 
-	struct Material
+	void shutdown() override
 	{
-		Material() noexcept  : shininess(1.0f), refractiveIndex(0.0f)
-		{
-			zerostruct(ambient);
-			zerostruct(diffuse);
-			zerostruct(specular);
-			zerostruct(transmittance);
-			zerostruct(emission);
-		}
-
-		String name;
-
-		Vertex ambient, diffuse, specular, transmittance, emission;
-		float shininess, refractiveIndex;
-
-		String ambientTextureName, diffuseTextureName,
-			specularTextureName, normalTextureName;
-
-		StringPairArray parameters;
-	};
+		shader.reset();
+		shape.reset();
+		stressSceneShape.reset();
+		attributes.reset();
+		uniforms.reset();
+		stagingRing.reset();
+		gpuTimer.reset();
+		functions.reset();
+	}
 
-	struct Shape
+	Matrix3D<float> getProjectionMatrix() const
 	{
-		String name;
-		Mesh mesh;
-		Material material;
-	};
-
-	OwnedArray<Shape> shapes;
+		auto w = 1.0f / (0.5f + 0.1f);
+		auto h = w * getLocalBounds().toFloat().getAspectRatio(false);
 
-private:
-	//==============================================================================
-	File sourceFile;
+		return Matrix3D<float>::fromFrustum(-w, w, -h, h, 4.0f, 30.0f);
+	}
 
-	struct TripleIndex
+	Matrix3D<float> getViewMatrix() const
 	{
-		TripleIndex() noexcept : vertexIndex(-1), textureIndex(-1), normalIndex(-1) {}
-
-		bool operator< (const TripleIndex& other) const noexcept
-		{
-			if (this == &other)
-				return false;
-
-			if (vertexIndex != other.vertexIndex)
-				return vertexIndex < other.vertexIndex;
+		Matrix3D<float> viewMatrix({ 0.0f, 0.0f, -10.0f });
+		Matrix3D<float> rotationMatrix = viewMatrix.rotation({ -0.3f, 5.0f * std::sin(animationFrame.load() * 0.01f), 0.0f });
 
-			if (textureIndex != other.textureIndex)
-				return textureIndex < other.textureIndex;
+		return rotationMatrix * viewMatrix;
+	}
 
-			return normalIndex < other.normalIndex;
-		}
+	void render() override
+	{
+		jassert(OpenGLHelpers::isContextActive());
 
-		int vertexIndex, textureIndex, normalIndex;
-	};
+		auto frameStartTime = Time::getMillisecondCounterHiRes();
 
-	struct IndexMap
-	{
-		std::map<TripleIndex, Index> map;
+		// In continuous mode the camera moves on every frame. Otherwise a frame only shows
+		// something new if a change asked for it; the rest just redraw the same picture.
+		auto isActiveFrame = frameInvalidated.exchange(false);
 
-		Index getIndexFor(TripleIndex i, Mesh& newMesh, const Mesh& srcMesh)
+		if (renderMode.load() == continuousRendering)
 		{
-			const std::map<TripleIndex, Index>::iterator it(map.find(i));
+			++animationFrame;
+			isActiveFrame = true;
+		}
 
-			if (it != map.end())
-				return it->second;
+		auto desktopScale = (float)openGLContext.getRenderingScale();
+		OpenGLHelpers::clear(getLookAndFeel().findColour(ResizableWindow::backgroundColourId));
 
-			auto index = (Index)newMesh.vertices.size();
+		// If the shaders have never compiled there's nothing to draw with, and neither the
+		// attributes, the uniforms nor the shapes exist. The status text says what went wrong.
+		// Such a frame isn't counted or timed.
+		if (shader == nullptr)
+			return;
 
-			if (isPositiveAndBelow(i.vertexIndex, srcMesh.vertices.size()))
-				newMesh.vertices.add(srcMesh.vertices.getReference(i.vertexIndex));
+		// The number this frame's sample gets once it's been counted, further down
+		auto frameNumber = numActiveFrames.load() + numIdleFrames.load() + 1;
 
-			if (isPositiveAndBelow(i.normalIndex, srcMesh.normals.size()))
-				newMesh.normals.add(srcMesh.normals.getReference(i.normalIndex));
+		// The timer's results come back a few frames late, so they go into earlier frames' samples
+		gpuTimer->collect(gpuTimes);
 
-			if (isPositiveAndBelow(i.textureIndex, srcMesh.textureCoords.size()))
-				newMesh.textureCoords.add(srcMesh.textureCoords.getReference(i.textureIndex));
+		for (auto& time : gpuTimes)
+			frameStatistics.setGpuMilliseconds(time.frameNumber, time.milliseconds);
 
-			map[i] = index;
-			return index;
-		}
-	};
+		gpuTimer->begin(frameNumber);
 
-	static float parseFloat(String::CharPointerType& t)
-	{
-		t = t.findEndOfWhitespace();
-		return (float)CharacterFunctions::readDoubleValue(t);
-	}
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	static Vertex parseVertex(String::CharPointerType t)
-	{
-		Vertex v;
-		v.x = parseFloat(t);
-		v.y = parseFloat(t);
-		v.z = parseFloat(t);
-		return v;
-	}
+		glViewport(0, 0, roundToInt(desktopScale * getWidth()), roundToInt(desktopScale * getHeight()));
 
-	static TextureCoord parseTextureCoord(String::CharPointerType t)
-	{
-		TextureCoord tc;
-		tc.x = parseFloat(t);
-		tc.y = parseFloat(t);
-		return tc;
-	}
+		shader->use();
 
-	static bool matchToken(String::CharPointerType& t, const char* token)
-	{
-		auto len = (int)strlen(token);
+		GLCallCounts counts;
 
-		if (CharacterFunctions::compareUpTo(CharPointer_ASCII(token), t, len) == 0)
+		if (uniforms->projectionMatrix.get() != nullptr)
 		{
-			auto end = t + len;
-
-			if (end.isEmpty() || end.isWhitespace())
-			{
-				t = end.findEndOfWhitespace();
-				return true;
-			}
+			uniforms->projectionMatrix->setMatrix4(getProjectionMatrix().mat, 1, false);
+			++counts.uniformSets;
 		}
 
-		return false;
-	}
+		if (uniforms->viewMatrix.get() != nullptr)
+		{
+			uniforms->viewMatrix->setMatrix4(getViewMatrix().mat, 1, false);
+			++counts.uniformSets;
+		}
 
-	struct Face
-	{
-		Face(String::CharPointerType t)
+		if (uniforms->sourceColour.get() != nullptr)
 		{
-			while (!t.isEmpty())
-				triples.add(parseTriple(t));
+			auto colour = Colours::green;
+			uniforms->sourceColour->set(colour.getFloatRed(), colour.getFloatGreen(), colour.getFloatBlue(), colour.getFloatAlpha());
+			++counts.uniformSets;
 		}
 
-		Array<TripleIndex> triples;
+		auto stressScene = showStressScene.load();
+		auto& shapeToDraw = stressScene ? *stressSceneShape : *shape;
 
-		void addIndices(Mesh& newMesh, const Mesh& srcMesh, IndexMap& indexMap)
+		if (!shapeToDraw.hasUploadedModel())
 		{
-			TripleIndex i0(triples[0]), i1, i2(triples[1]);
-
-			for (auto i = 2; i < triples.size(); ++i)
+			if (auto* model = getLoader().getLoadedFile())
 			{
-				i1 = i2;
-				i2 = triples.getReference(i);
-
-				newMesh.indices.add(indexMap.getIndexFor(i0, newMesh, srcMesh));
-				newMesh.indices.add(indexMap.getIndexFor(i1, newMesh, srcMesh));
-				newMesh.indices.add(indexMap.getIndexFor(i2, newMesh, srcMesh));
+				shapeToDraw.upload(openGLContext, *attributes, *model,
+								   stressScene ? createInstanceGrid(*model, stressSceneColumns, stressSceneRows) : Array<Instance>());
 			}
 		}
 
-		static TripleIndex parseTriple(String::CharPointerType& t)
+		// A model's data goes to the GPU a few megabytes a frame, and its shapes appear as
+		// they arrive, so the frames keep coming until it's all there
+		if (shapeToDraw.hasUploadedModel() && !shapeToDraw.isFullyUploaded())
 		{
-			TripleIndex i;
+			isActiveFrame = true;
 
-			t = t.findEndOfWhitespace();
-			i.vertexIndex = t.getIntValue32() - 1;
-			t = findEndOfFaceToken(t);
+			if (!shapeToDraw.continueUpload(*stagingRing, StagingRing::bytesPerFrame, counts))
+				invalidateFrame();
+		}
 
-			if (t.isEmpty() || t.getAndAdvance() != '/')
-				return i;
+		++(isActiveFrame ? numActiveFrames : numIdleFrames);
 
-			if (*t == '/')
-			{
-				++t;
-			}
-			else
-			{
-				i.textureIndex = t.getIntValue32() - 1;
-				t = findEndOfFaceToken(t);
+		// One unit at a distance of one unit in front of the camera covers this many pixels
+		auto pixelsPerUnit = getProjectionMatrix().mat[5] * 0.5f * desktopScale * (float)getHeight();
 
-				if (t.isEmpty() || t.getAndAdvance() != '/')
-					return i;
-			}
+		shapeToDraw.draw(openGLContext, *attributes, *uniforms, getProjectionMatrix(), getViewMatrix(),
+						 pixelsPerUnit, levelOfDetailThreshold.load(), useVertexArrayObjects.load(), counts);
 
-			i.normalIndex = t.getIntValue32() - 1;
-			t = findEndOfFaceToken(t);
-			return i;
-		}
+		// Reset the element buffers so child Components draw correctly
+		openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, 0);
+		openGLContext.extensions.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		counts.bufferBinds += 2;
 
-		static String::CharPointerType findEndOfFaceToken(String::CharPointerType t) noexcept
-		{
-			return CharacterFunctions::findEndOfToken(t, CharPointer_ASCII("/ \t"), String().getCharPointer());
-		}
-	};
+		gpuTimer->end();
+		updateFrameTimes(frameNumber, frameStartTime, isActiveFrame, counts);
+
+		const SpinLock::ScopedLockType lock(lastFrameCountsLock);
+		lastFrameCounts = counts;
+	}
 
-	static Shape* parseFaceGroup(const Mesh& srcMesh,
-		const Array<Face>& faceGroup,
-		const Material& material,
-		const String& name)
+	void paint(Graphics& g) override
 	{
-		if (faceGroup.size() == 0)
-			return nullptr;
+		// You can add your component specific drawing code here!
+		// This will draw over the top of the openGL background.
+		g.setColour(getLookAndFeel().findColour(Label::textColourId));
+		g.setFont(20);
+		g.drawText("OpenGL Example", 25, 20, 300, 30, Justification::left);
+		g.drawLine(20, 20, 170, 20);
+		g.drawLine(20, 50, 170, 50);
 
-		std::unique_ptr<Shape> shape(new Shape());
-		shape->name = name;
-		shape->material = material;
+		auto& loader = getLoader();
 
-		IndexMap indexMap;
+		if (!loader.isFinished())
+		{
+			auto* progress = loader.getProgress();
+			g.setFont(14);
+			g.drawText("Loading " + loader.getFile().getFileName() + ": "
+						 + String(roundToInt(100.0 * progress->getProportionComplete())) + "% ("
+						 + String(progress->linesProcessed.load()) + " lines)",
+					   25, 55, 400, 20, Justification::left);
+		}
+		else if (loader.getResult().failed())
+		{
+			g.setFont(14);
+			g.drawText(loader.getResult().getErrorMessage(), 25, 55, 400, 20, Justification::left);
+		}
+		else
+		{
+			g.setFont(14);
+			g.drawText(pickedDescription, 25, 55, getWidth() - 50, 20, Justification::left);
+
+			auto counts = getLastFrameCallCounts();
+			g.drawText("GL calls per frame: " + String(counts.getNumStateCalls()) + " state ("
+						 + String(counts.bufferBinds) + " buffer binds, "
+						 + String(counts.vertexArrayBinds) + " vertex array binds, "
+						 + String(counts.attributeCalls) + " attribute calls, "
+						 + String(counts.uniformSets) + " uniforms), "
+						 + String(counts.drawCalls) + " draws, " + String(counts.triangles) + " triangles",
+					   25, 75, getWidth() - 50, 20, Justification::left);
+
+			g.drawText("Shapes: " + String(counts.shapesSubmitted) + " submitted, "
+						 + String(counts.shapesCulled) + " culled as out of view"
+						 + (counts.shapesPending > 0 ? ", " + String(counts.shapesPending) + " still uploading" : String())
+						 + (counts.bytesStreamed > 0 ? " (" + File::descriptionOfSizeInBytes(counts.bytesStreamed) + " this frame)" : String()),
+					   25, 95, getWidth() - 50, 20, Justification::left);
+
+			g.drawText("Frames: " + String(getNumActiveFrames()) + " active, " + String(getNumIdleFrames()) + " idle ("
+						 + (getRenderMode() == continuousRendering ? "animating" : "on demand")
+						 + ", double-click to switch, right-click for more)",
+					   25, 115, getWidth() - 50, 20, Justification::left);
+
+			auto shaderError = getShaderError();
+
+			if (shaderError.isNotEmpty())
+				g.drawText("Shaders: " + shaderError, 25, 135, getWidth() - 50, 20, Justification::left);
+			else
+				g.drawText(String("Shaders: ") + (shaderProgramWasCached ? "loaded from the program binary cache in " : "compiled in ")
+							 + String(shaderMilliseconds.load(), 1) + " ms"
+							 + (shaderProgramWasCached ? ", " + String(shaderMillisecondsSaved.load(), 1) + " ms less than compiling" : String()),
+						   25, 135, getWidth() - 50, 20, Justification::left);
+
+			if (showStressScene)
+				g.drawText("Stress scene: " + String(stressSceneColumns * stressSceneRows) + " copies of "
+							 + loader.getFile().getFileName() + ", "
+							 + (functions != nullptr && functions->hasInstancing() ? "instanced" : "one draw per copy") + "; "
+							 + String(averageFrameMilliseconds.load(), 2) + " ms per frame, "
+							 + String(averageRenderMilliseconds.load(), 2) + " ms to submit",
+						   25, 155, getWidth() - 50, 20, Justification::left);
+		}
 
-		for (auto& f : faceGroup)
-			f.addIndices(shape->mesh, srcMesh, indexMap);
+		if (showPerformanceOverlay)
+			drawPerformanceOverlay(g);
+	}
 
-		return shape.release();
+	void mouseDown(const MouseEvent& e) override
+	{
+		if (e.mods.isPopupMenu())
+			showOptionsMenu();
+		else
+			pick(e.position);
 	}
 
-	Result parseObjFile(const StringArray& lines)
+	void mouseDoubleClick(const MouseEvent&) override
 	{
-		Mesh mesh;
-		Array<Face> faceGroup;
+		setRenderMode(getRenderMode() == continuousRendering ? onDemandRendering : continuousRendering);
+	}
 
-		Array<Material> knownMaterials;
-		Material lastMaterial;
-		String lastName;
+	/** Finds the triangle under a point in this component, and shows which shape, material and
+		triangle it belongs to. Does nothing until the model's TriangleBvh has been built.
 
-		for (auto lineNum = 0; lineNum < lines.size(); ++lineNum)
+		The triangle is numbered as it is in the loaded shape: faces with more than three
+		corners have been split into triangles, and MeshOptimiser and MeshletBuilder have
+		reordered them, so it isn't the number of a face in the .obj file, and it's labelled
+		that way.
+	*/
+	void pick(Point<float> position)
+	{
+		auto* model = modelLoader.getLoadedFile();
+		auto* bvh = modelLoader.getTriangleBvh();
+
+		if (model == nullptr || bvh == nullptr || showStressScene || getWidth() <= 0 || getHeight() <= 0)
+			return;
+
+		auto startTime = Time::getMillisecondCounterHiRes();
+
+		// Turn the point into a direction in the camera's space, through the projection's
+		// frustum, and then into the model's space. The view matrix is only a rotation and a
+		// translation, so its inverse is its transpose, less the translation.
+		auto projectionMatrix = getProjectionMatrix();
+		auto viewMatrix = getViewMatrix();
+		auto& p = projectionMatrix.mat;
+		auto& v = viewMatrix.mat;
+		auto ndcX = 2.0f * position.x / (float)getWidth() - 1.0f;
+		auto ndcY = 1.0f - 2.0f * position.y / (float)getHeight();
+		float cameraDirection[3] = { (ndcX + p[8]) / p[0], (ndcY + p[9]) / p[5], -1.0f };
+		float origin[3], direction[3];
+
+		for (auto i = 0; i < 3; ++i)
 		{
-			auto l = lines[lineNum].getCharPointer().findEndOfWhitespace();
+			origin[i] = -(v[i * 4] * v[12] + v[i * 4 + 1] * v[13] + v[i * 4 + 2] * v[14]) / Shape::modelScale;
+			direction[i] = v[i * 4] * cameraDirection[0] + v[i * 4 + 1] * cameraDirection[1] + v[i * 4 + 2] * cameraDirection[2];
+		}
 
-			if (matchToken(l, "v")) { mesh.vertices.add(parseVertex(l));            continue; }
-			if (matchToken(l, "vn")) { mesh.normals.add(parseVertex(l));             continue; }
-			if (matchToken(l, "vt")) { mesh.textureCoords.add(parseTextureCoord(l)); continue; }
-			if (matchToken(l, "f")) { faceGroup.add(Face(l));                       continue; }
+		auto hit = bvh->intersect({ origin[0], origin[1], origin[2] }, { direction[0], direction[1], direction[2] });
+		auto milliseconds = Time::getMillisecondCounterHiRes() - startTime;
 
-			if (matchToken(l, "usemtl"))
-			{
-				auto name = String(l).trim();
+		if (isPositiveAndBelow(hit.part, model->shapes.size()))
+		{
+			auto& shape = *model->shapes.getUnchecked(hit.part);
+			pickedDescription = "Shape \"" + shape.name + "\", material \"" + shape.material.name
+								  + "\", internal triangle " + String(hit.triangle) + " (not an .obj face number)";
+		}
+		else
+		{
+			pickedDescription = "Nothing there";
+		}
 
-				for (auto i = knownMaterials.size(); --i >= 0;)
-				{
-					if (knownMaterials.getReference(i).name == name)
-					{
-						lastMaterial = knownMaterials.getReference(i);
-						break;
-					}
-				}
+		pickedDescription << " (" << String(milliseconds, 3) << " ms)";
+		repaint();
+	}
 
-				continue;
-			}
+	void resized() override
+	{
+		// This is called when the OpenGLObj is resized.
+		// If you add any child components, this is where you should
+		// update their positions.
+		invalidateFrame();
+	}
 
-			if (matchToken(l, "mtllib"))
-			{
-				Result r = parseMaterial(knownMaterials, String(l).trim());
-				continue;
-			}
+	void timerCallback() override
+	{
+		// Keep the progress text up to date until the model has loaded. After that, there's only
+		// something to update while the frames keep coming, which is when it's animating, or
+		// while the performance overlay is shown.
+		repaint();
 
-			if (matchToken(l, "g") || matchToken(l, "o"))
-			{
-				if (Shape* shape = parseFaceGroup(mesh, faceGroup, lastMaterial, lastName))
-					shapes.add(shape);
+		if (!getLoader().isFinished())
+			return;
 
-				faceGroup.clear();
-				lastName = StringArray::fromTokens(l, " \t", "")[0];
-				continue;
-			}
+		if (getTimerInterval() < 500)
+		{
+			invalidateFrame();
+			startTimer(500);
 		}
 
-		if (auto* shape = parseFaceGroup(mesh, faceGroup, lastMaterial, lastName))
-			shapes.add(shape);
-
-		return Result::ok();
+		if (getRenderMode() == onDemandRendering && !isPerformanceOverlayShown())
+			stopTimer();
 	}
 
-	Result parseMaterial(Array<Material>& materials, const String& filename)
+	//==============================================================================
+	/** How the view decides when to draw. */
+	enum RenderMode
+	{
+		continuousRendering,    /**< Draws on every vsync, and animates the camera. */
+		onDemandRendering       /**< Draws only when the model, the viewport or a setting changes. */
+	};
+
+	/** Switches between animating and drawing on demand. Call this on the message thread. */
+	void setRenderMode(RenderMode newMode)
 	{
-		jassert(sourceFile.exists());
-		auto f = sourceFile.getSiblingFile(filename);
+		renderMode = newMode;
+		openGLContext.setContinuousRepainting(newMode == continuousRendering);
 
-		if (!f.exists())
-			return Result::fail("Cannot open file: " + filename);
+		if (newMode == continuousRendering && getLoader().isFinished())
+			startTimer(500);
 
-		auto lines = StringArray::fromLines(f.loadFileAsString());
+		invalidateFrame();
+		repaint();
+	}
 
-		materials.clear();
-		Material material;
+	RenderMode getRenderMode() const noexcept               { return renderMode.load(); }
 
-		for (auto line : lines)
-		{
-			auto l = line.getCharPointer().findEndOfWhitespace();
+	/** Asks for a new frame because something that's drawn has changed. In continuous mode
+		there'll be one anyway. This can be called from any thread.
+	*/
+	void invalidateFrame()
+	{
+		frameInvalidated = true;
+		openGLContext.triggerRepaint();
+	}
 
-			if (matchToken(l, "newmtl")) { materials.add(material); material.name = String(l).trim(); continue; }
+	/** The frames that showed something new, and the ones that were only redrawn because the
+		window asked for it, such as when the text over the view changed.
+	*/
+	int64 getNumActiveFrames() const noexcept               { return numActiveFrames.load(); }
+	int64 getNumIdleFrames() const noexcept                 { return numIdleFrames.load(); }
 
-			if (matchToken(l, "Ka")) { material.ambient = parseVertex(l); continue; }
-			if (matchToken(l, "Kd")) { material.diffuse = parseVertex(l); continue; }
-			if (matchToken(l, "Ks")) { material.specular = parseVertex(l); continue; }
-			if (matchToken(l, "Kt")) { material.transmittance = parseVertex(l); continue; }
-			if (matchToken(l, "Ke")) { material.emission = parseVertex(l); continue; }
-			if (matchToken(l, "Ni")) { material.refractiveIndex = parseFloat(l);  continue; }
-			if (matchToken(l, "Ns")) { material.shininess = parseFloat(l);  continue; }
+	//==============================================================================
+	enum
+	{
+		stressSceneColumns = 100,
+		stressSceneRows = 100
+	};
 
-			if (matchToken(l, "map_Ka")) { material.ambientTextureName = String(l).trim(); continue; }
-			if (matchToken(l, "map_Kd")) { material.diffuseTextureName = String(l).trim(); continue; }
-			if (matchToken(l, "map_Ks")) { material.specularTextureName = String(l).trim(); continue; }
-			if (matchToken(l, "map_Ns")) { material.normalTextureName = String(l).trim(); continue; }
+	/** Swaps the model for a grid of stressSceneColumns by stressSceneRows copies of
+		teapot.obj, drawn with instancing, and shows how long the frames take. The view
+		animates while it's shown, so that there's a steady stream of frames to time, and
+		goes back to the render mode it had before once it's hidden. Call this on the
+		message thread.
+	*/
+	void setStressSceneShown(bool shouldBeShown)
+	{
+		if (shouldBeShown == isStressSceneShown())
+			return;
 
-			auto tokens = StringArray::fromTokens(l, " \t", "");
+		if (shouldBeShown)
+			renderModeBeforeStressScene = getRenderMode();
 
-			if (tokens.size() >= 2)
-				material.parameters.set(tokens[0].trim(), tokens[1].trim());
+		if (shouldBeShown && stressSceneLoader.getProgress() == nullptr)
+		{
+			auto options = getModelLoadOptions();
+			options.buildTriangleBvh = false;
+			stressSceneLoader.startLoading(findResourceFile("teapot.obj"), options);
 		}
 
-		materials.add(material);
-		return Result::ok();
-	}
+		showStressScene = shouldBeShown;
+		pickedDescription.clear();
 
-	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WavefrontObjFile)
-};
+		if (!getLoader().isFinished())
+			startTimerHz(10);
 
+		setRenderMode(shouldBeShown ? continuousRendering : renderModeBeforeStressScene);
+	}
 
+	bool isStressSceneShown() const noexcept                { return showStressScene.load(); }
 
+	/** The average time between frames, and the average time render() took, over the last
+		second or so. This can be called from any thread.
+	*/
+	float getAverageFrameMilliseconds() const noexcept      { return averageFrameMilliseconds.load(); }
+	float getAverageRenderMilliseconds() const noexcept     { return averageRenderMilliseconds.load(); }
 
+	//==============================================================================
+	/** Shows or hides a box with the percentiles of the recent frame, render and GPU times,
+		the last frame's draws, triangles and uploaded bytes, and a graph of the frame times.
+		Call this on the message thread.
+	*/
+	void setPerformanceOverlayShown(bool shouldBeShown)
+	{
+		showPerformanceOverlay = shouldBeShown;
 
+		// In on-demand mode nothing else keeps the overlay's numbers moving once the model's
+		// loaded, so the timer repaints it now and then until it's hidden
+		if (shouldBeShown && getLoader().isFinished() && !isTimerRunning())
+			startTimer(500);
 
-//==============================================================================
-/**
-*  This component lives inside our window, and this is where you should put all
-*  your controls and content.
-*/
-class OpenGLView : public OpenGLAppComponent
-{
-public:
-//==============================================================================
-	OpenGLView(const String & componentName)
-	{
-		Component::setName(componentName);
-		//openGLContext.attachTo(*this);
-		setSize(800, 600);
+		repaint();
 	}
 
-	~OpenGLView()
-	{
-		shutdownOpenGL();
-		jassertfalse;
-	}
+	bool isPerformanceOverlayShown() const noexcept         { return showPerformanceOverlay.load(); }
 
-	void initialise() override
+	/** Writes the frames that are still kept (up to FrameStatistics::defaultCapacity of them) to
+		a CSV file, a row per frame, naming the model each one showed.
+	*/
+	Result exportFrameStatistics(const File& file) const
 	{
-		createShaders();
-	}
+		StringArray modelNames;
+		modelNames.add(modelLoader.getFile().getFileName());
+		modelNames.add(stressSceneLoader.getFile().getFileName() + " x" + String(stressSceneColumns * stressSceneRows));
 
-	void shutdown() override
-	{
-		shader.reset();
-		shape.reset();
-		attributes.reset();
-		uniforms.reset();
+		return frameStatistics.writeCsv(file, modelNames);
 	}
 
-	Matrix3D<float> getProjectionMatrix() const
+	/** Exports the frame times to a new file in the user's documents folder, and says where. */
+	void exportFrameStatisticsToDocuments()
 	{
-		auto w = 1.0f / (0.5f + 0.1f);
-		auto h = w * getLocalBounds().toFloat().getAspectRatio(false);
+		auto file = File::getSpecialLocation(File::userDocumentsDirectory)
+						.getNonexistentChildFile("OpenGLView frame times " + Time::getCurrentTime().formatted("%Y-%m-%d %H%M%S"), ".csv");
+		auto result = exportFrameStatistics(file);
 
-		return Matrix3D<float>::fromFrustum(-w, w, -h, h, 4.0f, 30.0f);
+		AlertWindow::showMessageBoxAsync(result.wasOk() ? AlertWindow::InfoIcon : AlertWindow::WarningIcon, "Export frame times",
+										 result.wasOk() ? "Saved to " + file.getFullPathName() : result.getErrorMessage());
 	}
 
-	Matrix3D<float> getViewMatrix() const
+	/** Sets the quality of the level of detail selection: each shape is drawn with its coarsest
+		level whose simplification error would cover no more than this many pixels on screen.
+		Zero always draws the full detail. This can be called from any thread.
+	*/
+	void setLevelOfDetailThreshold(float maxErrorInPixels)
 	{
-		Matrix3D<float> viewMatrix({ 0.0f, 0.0f, -10.0f });
-		Matrix3D<float> rotationMatrix = viewMatrix.rotation({ -0.3f, 5.0f * std::sin(getFrameCounter() * 0.01f), 0.0f });
-
-		return rotationMatrix * viewMatrix;
+		levelOfDetailThreshold = jmax(0.0f, maxErrorInPixels);
+		invalidateFrame();
 	}
 
-	void render() override
-	{
-		jassert(OpenGLHelpers::isContextActive());
+	float getLevelOfDetailThreshold() const noexcept       { return levelOfDetailThreshold.load(); }
 
-		auto desktopScale = (float)openGLContext.getRenderingScale();
-		OpenGLHelpers::clear(getLookAndFeel().findColour(ResizableWindow::backgroundColourId));
+	/** Chooses whether the vertex attributes are set up once, in a vertex array object, or on
+		every frame. The second is what happens anyway where the context has no vertex array
+		objects; this is here so the two can be compared. This can be called from any thread.
+	*/
+	void setUsesVertexArrayObjects(bool shouldUseThem)
+	{
+		useVertexArrayObjects = shouldUseThem;
+		invalidateFrame();
+	}
 
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	//==============================================================================
+	/** The number of GL calls of each kind that a frame made. The state calls are the ones the
+		driver has to validate before the next draw, which is where most of the CPU cost of
+		submitting a frame goes. It also counts the shapes that were drawn, the ones that were
+		left out because nothing of them was in view, and the ones still being uploaded.
+	*/
+	struct GLCallCounts
+	{
+		GLCallCounts() noexcept
+			: bufferBinds(0), vertexArrayBinds(0), attributeCalls(0), uniformSets(0), drawCalls(0), triangles(0),
+			  shapesSubmitted(0), shapesCulled(0), shapesPending(0), bytesStreamed(0)
+		{
+		}
 
-		glViewport(0, 0, roundToInt(desktopScale * getWidth()), roundToInt(desktopScale * getHeight()));
+		int getNumStateCalls() const noexcept    { return bufferBinds + vertexArrayBinds + attributeCalls + uniformSets; }
 
-		shader->use();
+		int bufferBinds, vertexArrayBinds, attributeCalls, uniformSets, drawCalls;
+		int64 triangles;   // counting each copy of an instanced draw
+		int shapesSubmitted, shapesCulled, shapesPending;
+		int64 bytesStreamed;   // vertex and index data sent to the GPU
+	};
 
-		if (uniforms->projectionMatrix.get() != nullptr)
-			uniforms->projectionMatrix->setMatrix4(getProjectionMatrix().mat, 1, false);
+	/** The calls that the last frame made. This can be called from any thread. */
+	GLCallCounts getLastFrameCallCounts() const
+	{
+		const SpinLock::ScopedLockType lock(lastFrameCountsLock);
+		return lastFrameCounts;
+	}
 
-		if (uniforms->viewMatrix.get() != nullptr)
-			uniforms->viewMatrix->setMatrix4(getViewMatrix().mat, 1, false);
+	/** The options the view loads its models with. MeshConverter uses them too, so that the
+		cache files it writes are the ones the view will look for.
+	*/
+	static WavefrontObjFile::LoadOptions getModelLoadOptions()
+	{
+		WavefrontObjFile::LoadOptions options;
+		options.useBinaryCache = true;
+		options.compressCache = true;
+		options.cacheDirectory = File::getSpecialLocation(File::tempDirectory).getChildFile("ModularImageViewer Mesh Cache");
+		options.optimiseMeshes = true;
+		options.buildLevelsOfDetail = true;
+		options.buildMeshlets = true;
+		options.buildTriangleBvh = true;
+
+		// generateNormals and decodeTextures are left off, since the shader doesn't light the
+		// model or draw with the materials' textures yet
+		return options;
+	}
 
-		shape->draw(openGLContext, *attributes);
+	/** Looks for a file in the Resources folder, searching upwards from the working directory. */
+	static File findResourceFile(const String& fileName)
+	{
+		auto dir = File::getCurrentWorkingDirectory();
 
-		// Reset the element buffers so child Components draw correctly
-		openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, 0);
-		openGLContext.extensions.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		int numTries = 0;
 
-	}
+		while (!dir.getChildFile("Resources").exists() && numTries++ < 15)
+			dir = dir.getParentDirectory();
 
-	void paint(Graphics& g) override
-	{
-		// You can add your component specific drawing code here!
-		// This will draw over the top of the openGL background.
-		g.setColour(getLookAndFeel().findColour(Label::textColourId));
-		g.setFont(20);
-		g.drawText("OpenGL Example", 25, 20, 300, 30, Justification::left);
-		g.drawLine(20, 20, 170, 20);
-		g.drawLine(20, 50, 170, 50);
+		return dir.getChildFile("Resources").getChildFile(fileName);
 	}
 
-	void resized() override
-	{
-		// This is called when the OpenGLObj is resized.
-		// If you add any child components, this is where you should
-		// update their positions.
-	}
-
-	void createShaders()
+	void createShaders()
 	{
+		// The positions and texture coordinates arrive as 0 to 1 within their shape's bounds
+		// (see Vertex), and the uniforms scale them back out. Each copy of an instanced model
+		// is then rotated, scaled and moved by its Instance; when there's no instance buffer,
+		// those attributes keep GL's default of (0, 0, 0, 1), which leaves the vertex alone.
 		vertexShader =
-			"attribute vec4 position;\n"
-			"attribute vec4 sourceColour;\n"
+			"attribute vec3 position;\n"
 			"attribute vec2 texureCoordIn;\n"
+			"attribute vec4 instanceTranslationAndScale;\n"
+			"attribute vec4 instanceRotation;\n"
 			"\n"
 			"uniform mat4 projectionMatrix;\n"
 			"uniform mat4 viewMatrix;\n"
+			"uniform vec3 positionOffset;\n"
+			"uniform vec3 positionScale;\n"
+			"uniform vec2 textureCoordOffset;\n"
+			"uniform vec2 textureCoordScale;\n"
+			"uniform vec4 sourceColour;\n"
 			"\n"
 			"varying vec4 destinationColour;\n"
 			"varying vec2 textureCoordOut;\n"
@@ -594,8 +716,11 @@ public:
 			"void main()\n"
 			"{\n"
 			"    destinationColour = sourceColour;\n"
-			"    textureCoordOut = texureCoordIn;\n"
-			"    gl_Position = projectionMatrix * viewMatrix * position;\n"
+			"    textureCoordOut = textureCoordOffset + texureCoordIn * textureCoordScale;\n"
+			"    vec3 p = positionOffset + position * positionScale;\n"
+			"    vec3 t = 2.0 * cross(instanceRotation.xyz, p);\n"
+			"    p += instanceRotation.w * t + cross(instanceRotation.xyz, t);\n"
+			"    gl_Position = projectionMatrix * viewMatrix * vec4(instanceTranslationAndScale.xyz + p * instanceTranslationAndScale.w, 1.0);\n"
 			"}\n";
 
 		fragmentShader =
@@ -617,90 +742,292 @@ public:
 			"    gl_FragColor = colour;\n"
 			"}\n";
 
-		std::unique_ptr<OpenGLShaderProgram> newShader(new OpenGLShaderProgram(openGLContext));
-		String statusText;
+		String error;
+		auto newShader = createProgram(OpenGLHelpers::translateVertexShaderToV3(vertexShader),
+									   OpenGLHelpers::translateFragmentShaderToV3(fragmentShader), error);
 
-		if (newShader->addVertexShader(OpenGLHelpers::translateVertexShaderToV3(vertexShader))
-			&& newShader->addFragmentShader(OpenGLHelpers::translateFragmentShaderToV3(fragmentShader))
-			&& newShader->link())
+		if (newShader != nullptr)
 		{
 			shape.reset();
+			stressSceneShape.reset();
 			attributes.reset();
 			uniforms.reset();
 
 			shader.reset(newShader.release());
 			shader->use();
 
-			shape.reset(new Shape(openGLContext));
-			attributes.reset(new Attributes(openGLContext, *shader));
+			shape.reset(new Shape(*functions));
+			stressSceneShape.reset(new Shape(*functions));
+			attributes.reset(new Attributes(openGLContext, *shader, *functions));
 			uniforms.reset(new Uniforms(openGLContext, *shader));
-
-			statusText = "GLSL: v" + String(OpenGLShaderProgram::getLanguageVersion(), 2);
 		}
 		else
 		{
-			statusText = newShader->getLastError();
+			setShaderError("didn't compile: " + error.upToFirstOccurrenceOf("\n", false, false));
+		}
+	}
+
+	/** What went wrong the last time the shaders were made, for the status text, or an
+		empty string if nothing did. This can be called from any thread.
+	*/
+	String getShaderError() const
+	{
+		const SpinLock::ScopedLockType lock(shaderErrorLock);
+		return shaderError;
+	}
+
+	/** Makes the program from the binary cache if it has one for these sources on this driver,
+		and otherwise compiles and links them, and saves the result for next time. Anything
+		wrong with a cached binary just means compiling instead. Returns nullptr, with the
+		reason in error, if the shaders don't compile.
+	*/
+	std::unique_ptr<OpenGLShaderProgram> createProgram(const String& vertexSource, const String& fragmentSource, String& error)
+	{
+		auto startTime = Time::getMillisecondCounterHiRes();
+		auto& extensions = openGLContext.extensions;
+		setShaderError({});
+
+		// A binary is only good for the same sources on the same driver
+		StringArray keyStrings;
+		keyStrings.add(vertexSource);
+		keyStrings.add(fragmentSource);
+
+		for (auto name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+			keyStrings.add(String((const char*)glGetString((GLenum)name)));
+
+		auto key = ProgramBinaryCache::createKey(keyStrings);
+
+		const ProgramBinaryCache cache(ProgramBinaryCache::getDefaultDirectory());
+		ProgramBinaryCache::Entry entry;
+
+		if (functions->hasProgramBinaries() && cache.load(key, entry))
+		{
+			std::unique_ptr<OpenGLShaderProgram> program(new OpenGLShaderProgram(openGLContext));
+			auto programID = program->getProgramID();
+			functions->programBinary(programID, (GLenum)entry.binaryFormat, entry.binary.getData(), (GLsizei)entry.binary.getSize());
+
+			GLint linked = GL_FALSE;
+			extensions.glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+
+			if (linked != GL_FALSE)
+			{
+				auto milliseconds = Time::getMillisecondCounterHiRes() - startTime;
+				shaderMilliseconds = (float)milliseconds;
+				shaderMillisecondsSaved = (float)jmax(0.0, entry.compileMilliseconds - milliseconds);
+				shaderProgramWasCached = true;
+				return program;
+			}
+
+			// A rejected binary can leave an error behind, which isn't worth reporting
+			glGetError();
+		}
+
+		std::unique_ptr<OpenGLShaderProgram> program(new OpenGLShaderProgram(openGLContext));
+
+		if (functions->hasProgramBinaries() && functions->programParameteri != nullptr)
+			functions->programParameteri(program->getProgramID(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+		if (!program->addVertexShader(vertexSource) || !program->addFragmentShader(fragmentSource) || !program->link())
+		{
+			error = program->getLastError();
+			return nullptr;
+		}
+
+		auto milliseconds = Time::getMillisecondCounterHiRes() - startTime;
+		shaderMilliseconds = (float)milliseconds;
+		shaderMillisecondsSaved = 0.0f;
+		shaderProgramWasCached = false;
+
+		if (functions->hasProgramBinaries())
+		{
+			GLint length = 0;
+			extensions.glGetProgramiv(program->getProgramID(), GL_PROGRAM_BINARY_LENGTH, &length);
+
+			if (length > 0)
+			{
+				GLenum format = 0;
+				entry.binary.setSize((size_t)length);
+				functions->getProgramBinary(program->getProgramID(), length, &length, &format, entry.binary.getData());
+				entry.binary.setSize((size_t)jmax(0, length));
+				entry.binaryFormat = (juce::uint32)format;
+				entry.compileMilliseconds = milliseconds;
+
+				auto saved = cache.save(key, entry);
+
+				// The program still works, it'll just be compiled again next time
+				if (saved.failed())
+					setShaderError("compiled in " + String(milliseconds, 1) + " ms, but couldn't be cached: "
+								   + saved.getErrorMessage());
+			}
 		}
+
+		return program;
 	}
 
 private:
+	void setShaderError(const String& newError)
+	{
+		const SpinLock::ScopedLockType lock(shaderErrorLock);
+		shaderError = newError;
+	}
+
 	//==============================================================================
+	/** The vertex format on the GPU: 16 bytes, against the 48 of a float position, normal,
+		colour and texture coordinate.
+
+		The position and texture coordinate are stored as 16-bit fractions of their shape's
+		bounds, which the vertex shader scales back out with the shape's uniforms. The normal
+		is folded onto an octahedron and stored as two signed 16-bit values. The colour is the
+		same for the whole shape, so it's a uniform.
+	*/
 	struct Vertex
 	{
-		float position[3];
-		float normal[3];
-		float colour[4];
-		float texCoord[2];
+		juce::uint16 position[4];   // x, y, z, and padding to keep the next attribute 4-byte aligned
+		juce::int16 normal[2];
+		juce::uint16 texCoord[2];
 	};
 
+	/** How one of the shader's attributes is laid out in a Vertex. */
+	struct VertexAttribute
+	{
+		const char* name;
+		GLint numComponents;
+		GLenum type;
+		size_t offset;
+	};
+
+	/** Every attribute is normalised, so the shader sees the integers as 0 to 1 (or -1 to 1). */
+	static Array<VertexAttribute> getVertexLayout()
+	{
+		Array<VertexAttribute> layout;
+		layout.add({ "position",      3, GL_UNSIGNED_SHORT, offsetof(Vertex, position) });
+		layout.add({ "normal",        2, GL_SHORT,          offsetof(Vertex, normal) });
+		layout.add({ "texureCoordIn", 2, GL_UNSIGNED_SHORT, offsetof(Vertex, texCoord) });
+		return layout;
+	}
+
+	/** Where one copy of an instanced model goes. The rotation is applied first, then the
+		scale, then the translation, all in the units the model is drawn in.
+	*/
+	struct Instance
+	{
+		float translationAndScale[4];   // x, y, z, and the scale
+		float rotation[4];              // a unit quaternion: x, y, z, w
+
+		/** The copy that leaves the model where it is, and what the attributes hold by default. */
+		static Instance identity() noexcept     { return { { 0.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } }; }
+	};
+
+	/** The per-instance attributes, which advance once per copy rather than once per vertex. */
+	static Array<VertexAttribute> getInstanceLayout()
+	{
+		Array<VertexAttribute> layout;
+		layout.add({ "instanceTranslationAndScale", 4, GL_FLOAT, offsetof(Instance, translationAndScale) });
+		layout.add({ "instanceRotation",            4, GL_FLOAT, offsetof(Instance, rotation) });
+		return layout;
+	}
+
 	//==============================================================================
-	// This class just manages the attributes that the shaders use.
+	// This class just manages the attributes that the shaders use, as described by getVertexLayout()
+	// and getInstanceLayout().
 	struct Attributes
 	{
-		Attributes(OpenGLContext& openGLContext, OpenGLShaderProgram& shaderProgram)
+		Attributes(OpenGLContext& openGLContext, OpenGLShaderProgram& shaderProgram, const OptionalGLFunctions& optionalFunctions)
+			: functions(optionalFunctions)
 		{
-			position.reset(createAttribute(openGLContext, shaderProgram, "position"));
-			normal.reset(createAttribute(openGLContext, shaderProgram, "normal"));
-			sourceColour.reset(createAttribute(openGLContext, shaderProgram, "sourceColour"));
-			texureCoordIn.reset(createAttribute(openGLContext, shaderProgram, "texureCoordIn"));
-		}
+			for (auto& attribute : getVertexLayout())
+			{
+				if (auto* a = createAttribute(openGLContext, shaderProgram, attribute.name))
+				{
+					attributes.add(a);
+					layout.add(attribute);
+				}
+			}
 
-		void enable(OpenGLContext& openGLContext)
-		{
-			if (position.get() != nullptr)
+			for (auto& attribute : getInstanceLayout())
 			{
-				openGLContext.extensions.glVertexAttribPointer(position->attributeID, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
-				openGLContext.extensions.glEnableVertexAttribArray(position->attributeID);
+				if (auto* a = createAttribute(openGLContext, shaderProgram, attribute.name))
+				{
+					instanceAttributes.add(a);
+					instanceLayout.add(attribute);
+				}
 			}
+		}
 
-			if (normal.get() != nullptr)
+		void enable(OpenGLContext& openGLContext, GLCallCounts& counts)
+		{
+			for (auto i = 0; i < attributes.size(); ++i)
 			{
-				openGLContext.extensions.glVertexAttribPointer(normal->attributeID, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(sizeof(float) * 3));
-				openGLContext.extensions.glEnableVertexAttribArray(normal->attributeID);
+				auto& attribute = layout.getReference(i);
+				auto id = attributes.getUnchecked(i)->attributeID;
+
+				openGLContext.extensions.glVertexAttribPointer(id, attribute.numComponents, attribute.type, GL_TRUE,
+															   sizeof(Vertex), (GLvoid*)attribute.offset);
+				openGLContext.extensions.glEnableVertexAttribArray(id);
 			}
 
-			if (sourceColour.get() != nullptr)
+			counts.attributeCalls += 2 * attributes.size();
+		}
+
+		void disable(OpenGLContext& openGLContext, GLCallCounts& counts)
+		{
+			for (auto* attribute : attributes)
+				openGLContext.extensions.glDisableVertexAttribArray(attribute->attributeID);
+
+			counts.attributeCalls += attributes.size();
+		}
+
+		/** Points the per-instance attributes at the buffer bound to GL_ARRAY_BUFFER, which
+			must hold Instances. Only call this if the context has instancing.
+		*/
+		void enableInstances(OpenGLContext& openGLContext, GLCallCounts& counts)
+		{
+			jassert(functions.hasInstancing());
+
+			for (auto i = 0; i < instanceAttributes.size(); ++i)
 			{
-				openGLContext.extensions.glVertexAttribPointer(sourceColour->attributeID, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(sizeof(float) * 6));
-				openGLContext.extensions.glEnableVertexAttribArray(sourceColour->attributeID);
+				auto& attribute = instanceLayout.getReference(i);
+				auto id = instanceAttributes.getUnchecked(i)->attributeID;
+
+				openGLContext.extensions.glVertexAttribPointer(id, attribute.numComponents, attribute.type, GL_FALSE,
+															   sizeof(Instance), (GLvoid*)attribute.offset);
+				openGLContext.extensions.glEnableVertexAttribArray(id);
+				functions.vertexAttribDivisor(id, 1);
 			}
 
-			if (texureCoordIn.get() != nullptr)
+			counts.attributeCalls += 3 * instanceAttributes.size();
+		}
+
+		/** Undoes enableInstances(), including the divisors, which otherwise stay with the
+			attribute slots for whatever is drawn next.
+		*/
+		void disableInstances(OpenGLContext& openGLContext, GLCallCounts& counts)
+		{
+			for (auto* attribute : instanceAttributes)
 			{
-				openGLContext.extensions.glVertexAttribPointer(texureCoordIn->attributeID, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(sizeof(float) * 10));
-				openGLContext.extensions.glEnableVertexAttribArray(texureCoordIn->attributeID);
+				functions.vertexAttribDivisor(attribute->attributeID, 0);
+				openGLContext.extensions.glDisableVertexAttribArray(attribute->attributeID);
 			}
+
+			counts.attributeCalls += 2 * instanceAttributes.size();
 		}
 
-		void disable(OpenGLContext& openGLContext)
+		/** Sets the per-instance attributes to one copy's values, for drawing instances one at a
+			time where the context can't draw them together. Instance::identity() puts them back.
+		*/
+		void setInstance(const Instance& instance, GLCallCounts& counts)
 		{
-			if (position.get() != nullptr)       openGLContext.extensions.glDisableVertexAttribArray(position->attributeID);
-			if (normal.get() != nullptr)         openGLContext.extensions.glDisableVertexAttribArray(normal->attributeID);
-			if (sourceColour.get() != nullptr)   openGLContext.extensions.glDisableVertexAttribArray(sourceColour->attributeID);
-			if (texureCoordIn.get() != nullptr)  openGLContext.extensions.glDisableVertexAttribArray(texureCoordIn->attributeID);
+			if (functions.vertexAttrib4fv == nullptr || instanceAttributes.size() != 2)
+				return;
+
+			functions.vertexAttrib4fv(instanceAttributes.getUnchecked(0)->attributeID, instance.translationAndScale);
+			functions.vertexAttrib4fv(instanceAttributes.getUnchecked(1)->attributeID, instance.rotation);
+			counts.attributeCalls += 2;
 		}
 
-		std::unique_ptr<OpenGLShaderProgram::Attribute> position, normal, sourceColour, texureCoordIn;
+		OwnedArray<OpenGLShaderProgram::Attribute> attributes, instanceAttributes;
+		Array<VertexAttribute> layout, instanceLayout;
+		const OptionalGLFunctions& functions;
 
 	private:
 		static OpenGLShaderProgram::Attribute* createAttribute(OpenGLContext& openGLContext,
@@ -722,9 +1049,16 @@ private:
 		{
 			projectionMatrix.reset(createUniform(openGLContext, shaderProgram, "projectionMatrix"));
 			viewMatrix.reset(createUniform(openGLContext, shaderProgram, "viewMatrix"));
+			positionOffset.reset(createUniform(openGLContext, shaderProgram, "positionOffset"));
+			positionScale.reset(createUniform(openGLContext, shaderProgram, "positionScale"));
+			textureCoordOffset.reset(createUniform(openGLContext, shaderProgram, "textureCoordOffset"));
+			textureCoordScale.reset(createUniform(openGLContext, shaderProgram, "textureCoordScale"));
+			sourceColour.reset(createUniform(openGLContext, shaderProgram, "sourceColour"));
 		}
 
 		std::unique_ptr<OpenGLShaderProgram::Uniform> projectionMatrix, viewMatrix;
+		std::unique_ptr<OpenGLShaderProgram::Uniform> positionOffset, positionScale, textureCoordOffset, textureCoordScale;
+		std::unique_ptr<OpenGLShaderProgram::Uniform> sourceColour;
 
 	private:
 		static OpenGLShaderProgram::Uniform* createUniform(OpenGLContext& openGLContext,
@@ -739,111 +1073,1078 @@ private:
 	};
 
 	//==============================================================================
-	/** This loads a 3D model from an OBJ file and converts it into some vertex buffers
-	that we can draw.
+	/** The six planes of the view volume, in the coordinates the vertices are drawn in, and
+		where the camera sits in those coordinates. The planes face inwards, and BoxCuller
+		tests the shapes' and meshlets' boxes against them.
+	*/
+	struct Frustum
+	{
+		Frustum(const Matrix3D<float>& projectionMatrix, const Matrix3D<float>& viewMatrix)
+		{
+			auto& p = projectionMatrix.mat;
+			auto& v = viewMatrix.mat;
+			float m[16];
+
+			// The matrices are column-major, and the shader applies the view matrix first
+			for (auto column = 0; column < 4; ++column)
+				for (auto row = 0; row < 4; ++row)
+					m[column * 4 + row] = p[row] * v[column * 4] + p[4 + row] * v[column * 4 + 1]
+										+ p[8 + row] * v[column * 4 + 2] + p[12 + row] * v[column * 4 + 3];
+
+			for (auto axis = 0; axis < 3; ++axis)
+			{
+				for (auto side = 0; side < 2; ++side)
+				{
+					auto sign = side == 0 ? 1.0f : -1.0f;
+					auto* plane = planes[axis * 2 + side];
+
+					for (auto i = 0; i < 4; ++i)
+						plane[i] = m[i * 4 + 3] + sign * m[i * 4 + axis];
+
+					auto length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+
+					if (length > 0.0f)
+						for (auto i = 0; i < 4; ++i)
+							plane[i] /= length;
+				}
+			}
+
+			// The view matrix is a rotation and a translation, so the camera is at -R^T t
+			for (auto i = 0; i < 3; ++i)
+				cameraPosition[i] = -(v[i * 4] * v[12] + v[i * 4 + 1] * v[13] + v[i * 4 + 2] * v[14]);
+		}
+
+		float planes[6][4];
+		float cameraPosition[3];
+	};
+
+	//==============================================================================
+	/** This converts a loaded OBJ model into one vertex buffer and one index buffer that we
+	can draw. Until a model has been uploaded, draw() does nothing.
+
+	Every shape's vertices go into the shared vertex buffer one after the other, and its
+	indices are offset by where its vertices start, so each shape is just a set of ranges in
+	the shared index buffer. draw() binds the buffers and sets up the attributes once, and
+	then only the dequantisation uniforms change between shapes. Where the driver has
+	glMultiDrawElements, each shape's ranges go out in one call.
+
+	Where the context has vertex array objects, the buffers and the attribute layout are
+	captured in one when the model is uploaded, so binding it is all draw() has to do.
+
+	Each frame, the shapes' bounding boxes are tested against the view frustum together (see
+	BoxCuller), and the shapes that are wholly outside it are skipped.
+
+	Each shape's levels of detail go into the index buffer after its full-detail triangles,
+	and draw() picks one per shape from how large its error would look at the shape's distance.
+
+	At full detail, a shape is drawn meshlet by meshlet (see MeshletBuilder), skipping those
+	outside the view and those whose normal cones face away from the camera. Neighbouring
+	meshlets that are both drawn become one range. Since the model is see-through, that
+	would leave holes in it unless the GPU also dropped the back faces of the meshlets that
+	are drawn, so whenever the model is drawn once (which is when the cones are tested),
+	back faces are culled at every level.
+
+	Given a list of Instances, it draws a copy of the model for each of them instead. Where
+	the context has instancing, that's one draw per range for all the copies together.
+
+	upload() only builds the vertices and indices, and makes the buffers for them. The data
+	goes up through a StagingRing over the next few frames, one part after another, as
+	continueUpload() is called, and draw() draws each part as soon as all of it is there.
 	*/
 	struct Shape
 	{
-		Shape(OpenGLContext& openGLContext)
+		Shape(const OptionalGLFunctions& optionalFunctions)
+			: functions(optionalFunctions), openGLContext(nullptr), vertexBuffer(0), indexBuffer(0), instanceBuffer(0),
+			  vertexArray(0), instanceScale(1.0f), instanceRadius(0.0f), numCopiesDone(0), numPartsReady(0), copyProgress(0)
 		{
-			auto dir = File::getCurrentWorkingDirectory();
+		}
 
-			int numTries = 0;
+		~Shape()
+		{
+			if (openGLContext != nullptr)
+			{
+				if (vertexArray != 0)
+					functions.deleteVertexArrays(1, &vertexArray);
 
-			while (!dir.getChildFile("Resources").exists() && numTries++ < 15)
-				dir = dir.getParentDirectory();
+				openGLContext->extensions.glDeleteBuffers(1, &vertexBuffer);
+				openGLContext->extensions.glDeleteBuffers(1, &indexBuffer);
 
-			if (shapeFile.load(dir.getChildFile("Resources").getChildFile("humanoid_quad.obj")).wasOk())
-				for (auto* shape : shapeFile.shapes)
-					vertexBuffers.add(new VertexBuffer(openGLContext, *shape));
+				if (instanceBuffer != 0)
+					openGLContext->extensions.glDeleteBuffers(1, &instanceBuffer);
+			}
 		}
 
-		void draw(OpenGLContext& openGLContext, Attributes& glAttributes)
+		/** The model's coordinates are shrunk by this much before they go to the GPU. */
+		static constexpr float modelScale = 0.2f;
+
+		/** Uploads the model. If any instances are given, draw() draws a copy of it for each
+			one, and otherwise it draws the model once, where it is.
+		*/
+		void upload(OpenGLContext& context, Attributes& glAttributes, const WavefrontObjFile& model,
+					const Array<Instance>& modelInstances = Array<Instance>())
 		{
-			for (auto* vertexBuffer : vertexBuffers)
+			jassert(openGLContext == nullptr);
+			openGLContext = &context;
+
+			auto& vertices = pendingVertices;
+			auto& indices = pendingIndices;
+
+			for (auto* shape : model.shapes)
+			{
+				auto firstVertex = vertices.size(), firstIndex = indices.size();
+				auto* part = parts.add(new Part(*shape, vertices, indices));
+
+				auto low = part->positionOffset, high = part->positionOffset + part->positionScale;
+				const float lowCorner[] = { low.x, low.y, low.z }, highCorner[] = { high.x, high.y, high.z };
+				partBoxes.add(lowCorner, highCorner);
+
+				// Each part's vertices and then its indices, so that the parts become drawable in order
+				pendingCopies.add({ false, (size_t)firstVertex * sizeof(Vertex), (size_t)(vertices.size() - firstVertex) * sizeof(Vertex) });
+				pendingCopies.add({ true, (size_t)firstIndex * sizeof(juce::uint32), (size_t)(indices.size() - firstIndex) * sizeof(juce::uint32) });
+			}
+
+			// The buffers start out empty, and continueUpload() fills them in
+			auto& extensions = context.extensions;
+
+			extensions.glGenBuffers(1, &vertexBuffer);
+			extensions.glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+			extensions.glBufferData(GL_ARRAY_BUFFER,
+				static_cast<GLsizeiptr> (static_cast<size_t> (vertices.size()) * sizeof(Vertex)),
+				nullptr, GL_STATIC_DRAW);
+
+			extensions.glGenBuffers(1, &indexBuffer);
+			extensions.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+			extensions.glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+				static_cast<GLsizeiptr> (static_cast<size_t> (indices.size()) * sizeof(juce::uint32)),
+				nullptr, GL_STATIC_DRAW);
+
+			setInstances(modelInstances);
+			createVertexArray(glAttributes);
+		}
+
+		bool hasUploadedModel() const noexcept   { return openGLContext != nullptr; }
+
+		/** True once every part's data is in its buffers. Until then, draw() only draws the
+			parts that are complete.
+		*/
+		bool isFullyUploaded() const noexcept    { return hasUploadedModel() && numPartsReady == parts.size(); }
+
+		/** Sends up to maxBytes more of the model to the GPU through the ring, and returns true
+			if that was the last of it.
+		*/
+		bool continueUpload(StagingRing& ring, size_t maxBytes, GLCallCounts& counts)
+		{
+			auto budget = maxBytes;
+
+			while (numCopiesDone < pendingCopies.size())
+			{
+				auto& pending = pendingCopies.getReference(numCopiesDone);
+
+				if (copyProgress < pending.numBytes)
+				{
+					if (budget == 0)
+						break;
+
+					auto* source = pending.isIndices ? (const char*)pendingIndices.begin() : (const char*)pendingVertices.begin();
+					auto copied = ring.copy(pending.isIndices ? indexBuffer : vertexBuffer, pending.offset + copyProgress,
+											source + pending.offset + copyProgress, jmin(budget, pending.numBytes - copyProgress),
+											counts.bufferBinds);
+
+					if (copied == 0)
+						break;
+
+					copyProgress += copied;
+					budget -= copied;
+					counts.bytesStreamed += (int64)copied;
+
+					if (copyProgress < pending.numBytes)
+						continue;
+				}
+
+				++numCopiesDone;
+				copyProgress = 0;
+			}
+
+			numPartsReady = numCopiesDone / 2;
+
+			if (numCopiesDone < pendingCopies.size())
+				return false;
+
+			pendingVertices.clear();
+			pendingIndices.clear();
+			return true;
+		}
+
+		/** The number of copies draw() draws, or 0 if it draws the model once without instances. */
+		int getNumInstances() const noexcept     { return instances.size(); }
+
+		void draw(OpenGLContext& context, Attributes& glAttributes, Uniforms& glUniforms,
+				  const Matrix3D<float>& projectionMatrix, const Matrix3D<float>& viewMatrix,
+				  float pixelsPerUnit, float maxPixelError, bool useVertexArray, GLCallCounts& counts)
+		{
+			if (parts.isEmpty())
+				return;
+
+			const Frustum frustum(projectionMatrix, viewMatrix);
+			findVisibleParts(frustum);
+			counts.shapesPending += parts.size() - numPartsReady;
+			counts.shapesCulled += numPartsReady - visibleParts.size();
+
+			if (visibleParts.isEmpty())
+				return;
+
+			useVertexArray = useVertexArray && vertexArray != 0;
+			auto drawInstanced = instanceBuffer != 0;
+
+			// The cone test only saves work if the back faces it drops would have been thrown
+			// away anyway; at the other levels, this keeps the model looking the same
+			auto cullsBackFaces = instances.isEmpty();
+
+			if (cullsBackFaces)
+			{
+				glEnable(GL_CULL_FACE);
+				glCullFace(GL_BACK);
+			}
+
+			if (useVertexArray)
 			{
-				vertexBuffer->bind();
+				functions.bindVertexArray(vertexArray);
+				++counts.vertexArrayBinds;
+			}
+			else
+			{
+				context.extensions.glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+				context.extensions.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+				counts.bufferBinds += 2;
+				glAttributes.enable(context, counts);
 
-				glAttributes.enable(openGLContext);
-				glDrawElements(GL_TRIANGLES, vertexBuffer->numIndices, GL_UNSIGNED_INT, 0);
-				glAttributes.disable(openGLContext);
+				if (drawInstanced)
+				{
+					context.extensions.glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+					++counts.bufferBinds;
+					glAttributes.enableInstances(context, counts);
+				}
+			}
+
+			for (auto index : visibleParts)
+			{
+				auto* part = parts.getUnchecked(index);
+
+				if (instances.isEmpty())
+				{
+					auto level = part->chooseLevel(viewMatrix, part->centre, part->radius, pixelsPerUnit, maxPixelError);
+
+					if (level == 0 && !part->meshlets.isEmpty())
+						part->addVisibleMeshlets(frustum, ranges, visibleMeshlets);
+					else
+						part->addLevel(level, ranges);
+				}
+				else
+				{
+					// The copies can't be told apart within one draw, so the meshlets aren't
+					// culled, and the level is the one the nearest possible copy would need
+					auto level = part->chooseLevel(viewMatrix, instanceCentre, instanceRadius,
+												   pixelsPerUnit * instanceScale, maxPixelError);
+					part->addLevel(level, ranges);
+				}
+
+				if (ranges.isEmpty())
+				{
+					++counts.shapesCulled;
+					continue;
+				}
+
+				++counts.shapesSubmitted;
+				part->setDequantisation(glUniforms, counts);
+
+				if (drawInstanced)
+					ranges.drawInstanced(functions, instances.size(), counts);
+				else if (instances.isEmpty())
+					ranges.draw(functions, counts);
+				else
+					drawInstancesOneByOne(glAttributes, counts);
+			}
+
+			if (!instances.isEmpty() && !drawInstanced)
+				glAttributes.setInstance(Instance::identity(), counts);
+
+			if (cullsBackFaces)
+				glDisable(GL_CULL_FACE);
+
+			if (useVertexArray)
+			{
+				// The context has a vertex array of its own bound, which it expects to get back
+				functions.bindVertexArray(functions.contextVertexArray);
+				++counts.vertexArrayBinds;
+			}
+			else
+			{
+				glAttributes.disable(context, counts);
+
+				if (drawInstanced)
+					glAttributes.disableInstances(context, counts);
 			}
 		}
 
 	private:
-		struct VertexBuffer
+		/** Fills visibleParts with the uploaded parts whose boxes are at least partly in the
+			frustum. The copies of an instanced model aren't culled, so all of its parts are kept.
+		*/
+		void findVisibleParts(const Frustum& frustum)
+		{
+			if (instances.isEmpty())
+			{
+				partBoxes.findVisible(frustum.planes, numElementsInArray(frustum.planes), visibleParts);
+
+				while (!visibleParts.isEmpty() && visibleParts.getLast() >= numPartsReady)
+					visibleParts.removeLast();
+
+				return;
+			}
+
+			visibleParts.clearQuick();
+
+			for (auto i = 0; i < numPartsReady; ++i)
+				visibleParts.add(i);
+		}
+
+		/** Copies the instances into a buffer of their own, if the context can draw them that
+			way, and finds a sphere around everywhere they put the model.
+		*/
+		void setInstances(const Array<Instance>& newInstances)
+		{
+			instances = newInstances;
+			instanceScale = 0.0f;
+			instanceRadius = 0.0f;
+
+			if (instances.isEmpty())
+				return;
+
+			auto low = Vector3D<float>(instances.getReference(0).translationAndScale[0],
+									   instances.getReference(0).translationAndScale[1],
+									   instances.getReference(0).translationAndScale[2]);
+			auto high = low;
+
+			for (auto& instance : instances)
+			{
+				auto* t = instance.translationAndScale;
+				low = { jmin(low.x, t[0]), jmin(low.y, t[1]), jmin(low.z, t[2]) };
+				high = { jmax(high.x, t[0]), jmax(high.y, t[1]), jmax(high.z, t[2]) };
+				instanceScale = jmax(instanceScale, t[3]);
+			}
+
+			// Every part is within its own sphere, and each copy scales and moves that sphere
+			auto partReach = 0.0f;
+
+			for (auto* part : parts)
+				part->extendReach(partReach);
+
+			instanceCentre = (low + high) * 0.5f;
+			instanceRadius = (high - low).length() * 0.5f + partReach * instanceScale;
+
+			if (functions.hasInstancing())
+			{
+				auto& extensions = openGLContext->extensions;
+				extensions.glGenBuffers(1, &instanceBuffer);
+				extensions.glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+				extensions.glBufferData(GL_ARRAY_BUFFER,
+					static_cast<GLsizeiptr> (static_cast<size_t> (instances.size()) * sizeof(Instance)),
+					instances.getRawDataPointer(), GL_STATIC_DRAW);
+			}
+		}
+
+		/** Where the context can't draw instances, this draws the ranges once per copy, setting
+			the per-instance attributes to each copy in turn.
+		*/
+		void drawInstancesOneByOne(Attributes& glAttributes, GLCallCounts& counts)
+		{
+			for (auto& instance : instances)
+			{
+				glAttributes.setInstance(instance, counts);
+				ranges.draw(functions, counts, false);
+			}
+
+			ranges.clear();
+		}
+
+		/** Captures the shared buffers and the attribute layout in a vertex array object, if the
+			context has them. Otherwise vertexArray stays 0, and draw() sets them up every time.
+		*/
+		void createVertexArray(Attributes& glAttributes)
 		{
-			VertexBuffer(OpenGLContext& context, WavefrontObjFile::Shape& aShape) : openGLContext(context)
+			if (!functions.hasVertexArrays())
+				return;
+
+			functions.genVertexArrays(1, &vertexArray);
+			functions.bindVertexArray(vertexArray);
+
+			GLCallCounts counts;
+			openGLContext->extensions.glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+			openGLContext->extensions.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+			glAttributes.enable(*openGLContext, counts);
+
+			if (instanceBuffer != 0)
 			{
-				numIndices = aShape.mesh.indices.size();
+				openGLContext->extensions.glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+				glAttributes.enableInstances(*openGLContext, counts);
+			}
 
-				openGLContext.extensions.glGenBuffers(1, &vertexBuffer);
-				openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+			functions.bindVertexArray(functions.contextVertexArray);
+		}
 
-				Array<Vertex> vertices;
-				createVertexListFromMesh(aShape.mesh, vertices, Colours::green);
+		/** The ranges of the index buffer that one shape draws this frame. Ranges that follow
+			on from each other are joined as they're added.
+		*/
+		struct DrawRanges
+		{
+			DrawRanges() noexcept : numTriangles(0) {}
 
-				openGLContext.extensions.glBufferData(GL_ARRAY_BUFFER,
-					static_cast<GLsizeiptr> (static_cast<size_t> (vertices.size()) * sizeof(Vertex)),
-					vertices.getRawDataPointer(), GL_STATIC_DRAW);
+			void add(int firstIndex, int numIndices)
+			{
+				if (numIndices <= 0)
+					return;
 
-				openGLContext.extensions.glGenBuffers(1, &indexBuffer);
-				openGLContext.extensions.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-				openGLContext.extensions.glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-					static_cast<GLsizeiptr> (static_cast<size_t> (numIndices) * sizeof(juce::uint32)),
-					aShape.mesh.indices.getRawDataPointer(), GL_STATIC_DRAW);
+				auto offset = (const GLvoid*)(sizeof(juce::uint32) * (size_t)firstIndex);
+
+				if (!counts.isEmpty() && (const char*)offsets.getLast() + sizeof(juce::uint32) * (size_t)counts.getLast() == offset)
+				{
+					counts.getReference(counts.size() - 1) += numIndices;
+				}
+				else
+				{
+					counts.add(numIndices);
+					offsets.add(offset);
+				}
+
+				numTriangles += numIndices / 3;
 			}
 
-			~VertexBuffer()
+			bool isEmpty() const noexcept    { return counts.isEmpty(); }
+
+			void clear() noexcept
 			{
-				openGLContext.extensions.glDeleteBuffers(1, &vertexBuffer);
-				openGLContext.extensions.glDeleteBuffers(1, &indexBuffer);
+				counts.clearQuick();
+				offsets.clearQuick();
+				numTriangles = 0;
 			}
 
-			void bind()
+			/** Draws the ranges, in one call if the driver can, and empties the list unless told not to. */
+			void draw(const OptionalGLFunctions& functions, GLCallCounts& callCounts, bool thenClear = true)
 			{
-				openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-				openGLContext.extensions.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+				if (functions.multiDrawElements != nullptr && counts.size() > 1)
+				{
+					functions.multiDrawElements(GL_TRIANGLES, counts.getRawDataPointer(), GL_UNSIGNED_INT,
+												offsets.getRawDataPointer(), counts.size());
+					++callCounts.drawCalls;
+				}
+				else
+				{
+					for (auto i = 0; i < counts.size(); ++i)
+						glDrawElements(GL_TRIANGLES, counts.getUnchecked(i), GL_UNSIGNED_INT, offsets.getUnchecked(i));
+
+					callCounts.drawCalls += counts.size();
+				}
+
+				callCounts.triangles += numTriangles;
+
+				if (thenClear)
+					clear();
 			}
 
-			GLuint vertexBuffer, indexBuffer;
-			int numIndices;
-			OpenGLContext& openGLContext;
+			/** Draws every range numInstances times, with one call per range, and empties the list. */
+			void drawInstanced(const OptionalGLFunctions& functions, int numInstances, GLCallCounts& callCounts)
+			{
+				for (auto i = 0; i < counts.size(); ++i)
+					functions.drawElementsInstanced(GL_TRIANGLES, counts.getUnchecked(i), GL_UNSIGNED_INT,
+													offsets.getUnchecked(i), numInstances);
+
+				callCounts.drawCalls += counts.size();
+				callCounts.triangles += numTriangles * numInstances;
+				clear();
+			}
 
-			JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VertexBuffer)
+			Array<GLsizei> counts;
+			Array<const GLvoid*> offsets;
+			int64 numTriangles;
 		};
 
-		WavefrontObjFile shapeFile;
-		OwnedArray<VertexBuffer> vertexBuffers;
+		/** One of the model's shapes: where its triangles are in the shared buffers, and how to
+			turn its quantised vertices back into model coordinates.
+		*/
+		struct Part
+		{
+			/** Appends the shape's vertices and indices to the shared lists. */
+			Part(const WavefrontObjFile::Shape& aShape, Array<Vertex>& vertices, Array<juce::uint32>& indices)
+			{
+				auto& mesh = aShape.mesh;
+				auto baseVertex = (juce::uint32)vertices.size();
+				auto firstIndex = indices.size();
+
+				findBounds(mesh);
+				createVertexListFromMesh(mesh, vertices);
+
+				addIndices(mesh.indices, baseVertex, indices);
+				levels.add({ firstIndex, mesh.indices.size(), 0.0f });
+
+				for (auto& m : mesh.meshlets)
+				{
+					auto meshlet = scaled(m);
+					meshlet.firstIndex += (juce::uint32)firstIndex;
+					meshlets.add(meshlet);
+					meshletBoxes.add(meshlet.boundsMin, meshlet.boundsMax);
+				}
+
+				for (auto& lod : mesh.levelsOfDetail)
+				{
+					levels.add({ indices.size(), lod.indices.size(), lod.error * modelScale });
+					addIndices(lod.indices, baseVertex, indices);
+				}
+			}
+
+			/** Sets the uniforms that turn this shape's quantised vertices back into model coordinates. */
+			void setDequantisation(Uniforms& glUniforms, GLCallCounts& counts) const
+			{
+				if (auto* u = glUniforms.positionOffset.get())
+				{
+					u->set(positionOffset.x, positionOffset.y, positionOffset.z);
+					++counts.uniformSets;
+				}
+
+				if (auto* u = glUniforms.positionScale.get())
+				{
+					u->set(positionScale.x, positionScale.y, positionScale.z);
+					++counts.uniformSets;
+				}
+
+				if (auto* u = glUniforms.textureCoordOffset.get())
+				{
+					u->set(textureCoordOffset.x, textureCoordOffset.y);
+					++counts.uniformSets;
+				}
+
+				if (auto* u = glUniforms.textureCoordScale.get())
+				{
+					u->set(textureCoordScale.x, textureCoordScale.y);
+					++counts.uniformSets;
+				}
+			}
+
+			void addLevel(int level, DrawRanges& ranges) const
+			{
+				auto& l = levels.getReference(level);
+				ranges.add(l.firstIndex, l.numIndices);
+			}
+
+			/** Grows reach to cover this part's bounding sphere, measured from the model's origin. */
+			void extendReach(float& reach) const noexcept
+			{
+				reach = jmax(reach, centre.length() + radius);
+			}
+
+			/** Adds the full-detail triangles to the ranges, leaving out the meshlets that are
+				outside the frustum or face away from the camera. visibleMeshlets is just somewhere
+				to keep the list of the ones in the frustum between frames.
+			*/
+			void addVisibleMeshlets(const Frustum& frustum, DrawRanges& ranges, Array<int>& visibleMeshlets) const
+			{
+				meshletBoxes.findVisible(frustum.planes, numElementsInArray(frustum.planes), visibleMeshlets);
+
+				for (auto index : visibleMeshlets)
+				{
+					auto& m = meshlets.getReference(index);
+
+					if (facesCamera(m, frustum))
+						ranges.add((int)m.firstIndex, (int)m.numIndices);
+				}
+			}
+
+			static bool facesCamera(const WavefrontObjFile::Meshlet& m, const Frustum& frustum) noexcept
+			{
+				if (m.coneCutoff >= 1.0f)
+					return true;
+
+				float toApex[3];
+
+				for (auto i = 0; i < 3; ++i)
+					toApex[i] = m.coneApex[i] - frustum.cameraPosition[i];
+
+				auto distance = std::sqrt(toApex[0] * toApex[0] + toApex[1] * toApex[1] + toApex[2] * toApex[2]);
+				auto facing = toApex[0] * m.coneAxis[0] + toApex[1] * m.coneAxis[1] + toApex[2] * m.coneAxis[2];
+
+				return facing < m.coneCutoff * distance;
+			}
+
+			/** A range of the shared index buffer, and its error in the same units as the vertices. */
+			struct Level
+			{
+				int firstIndex, numIndices;
+				float error;
+			};
+
+			/** Returns the index of the coarsest level whose error, projected at the nearest
+				point of a sphere around what's drawn, stays within maxPixelError.
+			*/
+			int chooseLevel(const Matrix3D<float>& viewMatrix, Vector3D<float> sphereCentre, float sphereRadius,
+							float pixelsPerUnit, float maxPixelError) const
+			{
+				auto& m = viewMatrix.mat;
+				auto depth = -(m[2] * sphereCentre.x + m[6] * sphereCentre.y + m[10] * sphereCentre.z + m[14]);
+				auto distance = depth - sphereRadius;
+
+				if (distance <= 0.0f)
+					return 0;
+
+				auto maxError = maxPixelError * distance / pixelsPerUnit;
+				auto chosen = 0;
+
+				while (chosen + 1 < levels.size() && levels.getReference(chosen + 1).error <= maxError)
+					++chosen;
+
+				return chosen;
+			}
+
+			Array<Level> levels;
+			Array<WavefrontObjFile::Meshlet> meshlets;   // in the same units as the vertices, and the shared index buffer
+			BoxCuller meshletBoxes;                      // the meshlets' bounds, in the same order
+			Vector3D<float> centre;
+			float radius;
+			Vector3D<float> positionOffset, positionScale;
+			Point<float> textureCoordOffset, textureCoordScale;
+
+
+		private:
+			/** Finds the box that the vertices are quantised within, and the bounding sphere
+				that chooseLevel() uses, both in the scaled coordinates that get drawn.
+			*/
+			void findBounds(const WavefrontObjFile::Mesh& mesh)
+			{
+				centre = {};
+				radius = 0.0f;
+				positionOffset = {};
+				positionScale = {};
+				textureCoordOffset = {};
+				textureCoordScale = {};
+
+				if (mesh.vertices.isEmpty())
+					return;
+
+				auto low = mesh.vertices.getReference(0), high = low;
+
+				for (auto& v : mesh.vertices)
+				{
+					low = { jmin(low.x, v.x), jmin(low.y, v.y), jmin(low.z, v.z) };
+					high = { jmax(high.x, v.x), jmax(high.y, v.y), jmax(high.z, v.z) };
+				}
+
+				positionOffset = { modelScale * low.x, modelScale * low.y, modelScale * low.z };
+				positionScale = { modelScale * (high.x - low.x), modelScale * (high.y - low.y), modelScale * (high.z - low.z) };
+
+				centre = positionOffset + positionScale * 0.5f;
+
+				for (auto& v : mesh.vertices)
+					radius = jmax(radius, (Vector3D<float>(modelScale * v.x, modelScale * v.y, modelScale * v.z) - centre).length());
+
+				if (mesh.textureCoords.size() == mesh.vertices.size())
+				{
+					auto lowUV = mesh.textureCoords.getReference(0), highUV = lowUV;
+
+					for (auto& tc : mesh.textureCoords)
+					{
+						lowUV = { jmin(lowUV.x, tc.x), jmin(lowUV.y, tc.y) };
+						highUV = { jmax(highUV.x, tc.x), jmax(highUV.y, tc.y) };
+					}
+
+					textureCoordOffset = { lowUV.x, lowUV.y };
+					textureCoordScale = { highUV.x - lowUV.x, highUV.y - lowUV.y };
+				}
+				else
+				{
+					textureCoordOffset = { 0.5f, 0.5f };
+				}
+			}
+
+			static WavefrontObjFile::Meshlet scaled(WavefrontObjFile::Meshlet m) noexcept
+			{
+				for (auto i = 0; i < 3; ++i)
+				{
+					m.centre[i] *= modelScale;
+					m.boundsMin[i] *= modelScale;
+					m.boundsMax[i] *= modelScale;
+					m.coneApex[i] *= modelScale;
+				}
 
-		static void createVertexListFromMesh(const WavefrontObjFile::Mesh& mesh, Array<Vertex>& list, Colour colour)
+				m.radius *= modelScale;
+				return m;
+			}
+
+			static juce::uint16 quantise(float value, float low, float extent) noexcept
+			{
+				if (extent <= 0.0f)
+					return 0;
+
+				return (juce::uint16)roundToInt(jlimit(0.0f, 1.0f, (value - low) / extent) * 65535.0f);
+			}
+
+			static juce::int16 quantiseSigned(float value) noexcept
+			{
+				return (juce::int16)roundToInt(jlimit(-1.0f, 1.0f, value) * 32767.0f);
+			}
+
+			/** Folds a normal onto the faces of an octahedron, and unfolds the lower half over the
+				upper so that the whole sphere maps onto the square -1 to 1.
+			*/
+			static void encodeNormal(float x, float y, float z, juce::int16* result) noexcept
+			{
+				auto sum = std::abs(x) + std::abs(y) + std::abs(z);
+
+				if (sum <= 0.0f)
+				{
+					result[0] = result[1] = 0;
+					return;
+				}
+
+				auto u = x / sum, v = y / sum;
+
+				if (z < 0.0f)
+				{
+					auto foldedU = (1.0f - std::abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+					auto foldedV = (1.0f - std::abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+					u = foldedU;
+					v = foldedV;
+				}
+
+				result[0] = quantiseSigned(u);
+				result[1] = quantiseSigned(v);
+			}
+
+			void createVertexListFromMesh(const WavefrontObjFile::Mesh& mesh, Array<Vertex>& list) const
+			{
+				WavefrontObjFile::TextureCoord defaultTexCoord{ 0.5f, 0.5f };
+				WavefrontObjFile::Vertex defaultNormal{ 0.5f, 0.5f, 0.5f };
+
+				auto low = positionOffset / modelScale, extent = positionScale / modelScale;
+				list.ensureStorageAllocated(list.size() + mesh.vertices.size());
+
+				for (auto i = 0; i < mesh.vertices.size(); ++i)
+				{
+					const auto& v = mesh.vertices.getReference(i);
+					const auto& n = i < mesh.normals.size() ? mesh.normals.getReference(i) : defaultNormal;
+					const auto& tc = i < mesh.textureCoords.size() ? mesh.textureCoords.getReference(i) : defaultTexCoord;
+
+					Vertex vertex;
+					vertex.position[0] = quantise(v.x, low.x, extent.x);
+					vertex.position[1] = quantise(v.y, low.y, extent.y);
+					vertex.position[2] = quantise(v.z, low.z, extent.z);
+					vertex.position[3] = 0;
+					encodeNormal(n.x, n.y, n.z, vertex.normal);
+					vertex.texCoord[0] = quantise(tc.x, textureCoordOffset.x, textureCoordScale.x);
+					vertex.texCoord[1] = quantise(tc.y, textureCoordOffset.y, textureCoordScale.y);
+
+					list.add(vertex);
+				}
+			}
+
+			static void addIndices(const Array<juce::uint32>& source, juce::uint32 baseVertex, Array<juce::uint32>& indices)
+			{
+				auto start = indices.size();
+				indices.insertMultiple(-1, 0, source.size());
+
+				for (auto i = 0; i < source.size(); ++i)
+					indices.setUnchecked(start + i, source.getUnchecked(i) + baseVertex);
+			}
+
+			JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Part)
+		};
+
+		const OptionalGLFunctions& functions;
+		OwnedArray<Part> parts;
+		BoxCuller partBoxes;        // one for each part, in the same order
+		Array<int> visibleParts, visibleMeshlets;
+		DrawRanges ranges;
+		OpenGLContext* openGLContext;
+		GLuint vertexBuffer, indexBuffer, instanceBuffer, vertexArray;
+		Array<Instance> instances;
+		Vector3D<float> instanceCentre;
+		float instanceScale, instanceRadius;
+
+		/** A part's vertices or indices, as a range of bytes in the pending arrays and in the buffer. */
+		struct PendingCopy
+		{
+			bool isIndices;
+			size_t offset, numBytes;
+		};
+
+		Array<Vertex> pendingVertices;          // what's still to go up, until it's all gone
+		Array<juce::uint32> pendingIndices;
+		Array<PendingCopy> pendingCopies;
+		int numCopiesDone, numPartsReady;
+		size_t copyProgress;                    // into pendingCopies[numCopiesDone]
+
+		JUCE_DECLARE_NON_COPYABLE(Shape)
+	};
+
+	//==============================================================================
+	/** The loader for whichever model is being shown. */
+	WavefrontObjFile::AsyncLoader& getLoader() noexcept
+	{
+		return showStressScene ? stressSceneLoader : modelLoader;
+	}
+
+	/** Lays copies of a model out in a grid across the floor, each turned a different way and
+		scaled to fit its cell, with its centre on the cell's centre.
+	*/
+	static Array<Instance> createInstanceGrid(const WavefrontObjFile& model, int numColumns, int numRows)
+	{
+		Array<Instance> grid;
+
+		auto first = true;
+		Vector3D<float> low, high;
+
+		for (auto* shape : model.shapes)
 		{
-			auto scale = 0.2f;
-			WavefrontObjFile::TextureCoord defaultTexCoord{ 0.5f, 0.5f };
-			WavefrontObjFile::Vertex defaultNormal{ 0.5f, 0.5f, 0.5f };
+			for (auto& v : shape->mesh.vertices)
+			{
+				low = first ? Vector3D<float>(v.x, v.y, v.z) : Vector3D<float>(jmin(low.x, v.x), jmin(low.y, v.y), jmin(low.z, v.z));
+				high = first ? Vector3D<float>(v.x, v.y, v.z) : Vector3D<float>(jmax(high.x, v.x), jmax(high.y, v.y), jmax(high.z, v.z));
+				first = false;
+			}
+		}
+
+		if (first || numColumns <= 0 || numRows <= 0)
+			return grid;
+
+		// The instances work in the units the model is drawn in, which Shape has already scaled
+		auto centre = (low + high) * (0.5f * Shape::modelScale);
+		auto radius = jmax(1.0e-6f, (high - low).length() * (0.5f * Shape::modelScale));
+
+		const auto gridWidth = 8.0f;
+		auto spacing = gridWidth / (float)jmax(numColumns, numRows);
+		auto scale = 0.4f * spacing / radius;
 
-			for (auto i = 0; i < mesh.vertices.size(); ++i)
+		grid.ensureStorageAllocated(numColumns * numRows);
+
+		for (auto row = 0; row < numRows; ++row)
+		{
+			for (auto column = 0; column < numColumns; ++column)
 			{
-				const auto& v = mesh.vertices.getReference(i);
-				const auto& n = i < mesh.normals.size() ? mesh.normals.getReference(i) : defaultNormal;
-				const auto& tc = i < mesh.textureCoords.size() ? mesh.textureCoords.getReference(i) : defaultTexCoord;
+				// A turn about the vertical axis, by the golden ratio so that neighbours differ
+				auto angle = (float)(row * numColumns + column) * 0.618034f * 2.0f * float_Pi;
+				auto c = std::cos(angle), s = std::sin(angle);
 
-				list.add({ { scale * v.x, scale * v.y, scale * v.z, },
-					{ scale * n.x, scale * n.y, scale * n.z, },
-					{ colour.getFloatRed(), colour.getFloatGreen(), colour.getFloatBlue(), colour.getFloatAlpha() },
-					{ tc.x, tc.y } });
+				Vector3D<float> cellCentre((column - (numColumns - 1) * 0.5f) * spacing, 0.0f,
+										   (row - (numRows - 1) * 0.5f) * spacing);
+				Vector3D<float> turnedCentre(centre.x * c + centre.z * s, centre.y, centre.z * c - centre.x * s);
+				auto translation = cellCentre - turnedCentre * scale;
+
+				grid.add({ { translation.x, translation.y, translation.z, scale },
+						   { 0.0f, std::sin(angle * 0.5f), 0.0f, std::cos(angle * 0.5f) } });
 			}
 		}
+
+		return grid;
+	}
+
+	/** Folds this frame into the running averages of the time between frames and the time
+		render() takes, each weighted towards roughly the last second, and records it in
+		frameStatistics. Its GPU time is filled in when the timer's result comes back.
+
+		The time between frames only counts when this frame and the one before were both
+		active. Otherwise the gap is however long the view sat waiting for something to
+		change, which says nothing about how fast it draws.
+	*/
+	void updateFrameTimes(int64 frameNumber, double frameStartTime, bool isActiveFrame, const GLCallCounts& counts)
+	{
+		auto now = Time::getMillisecondCounterHiRes();
+		auto renderTime = (float)(now - frameStartTime);
+		auto frameTime = isActiveFrame && lastFrameWasActive ? (float)(frameStartTime - lastFrameStartTime) : -1.0f;
+		const auto weight = 0.05f;
+
+		if (frameTime >= 0.0f)
+			averageFrameMilliseconds = averageFrameMilliseconds.load() + weight * (frameTime - averageFrameMilliseconds.load());
+
+		averageRenderMilliseconds = averageRenderMilliseconds.load() + weight * (renderTime - averageRenderMilliseconds.load());
+		lastFrameStartTime = frameStartTime;
+		lastFrameWasActive = isActiveFrame;
+
+		FrameStatistics::Sample sample;
+		sample.frameNumber = frameNumber;
+		sample.frameMilliseconds = frameTime;
+		sample.renderMilliseconds = renderTime;
+		sample.gpuMilliseconds = -1.0f;
+		sample.drawCalls = counts.drawCalls;
+		sample.triangles = counts.triangles;
+		sample.bytesUploaded = counts.bytesStreamed;
+		sample.modelIndex = showStressScene ? 1 : 0;
+		sample.usedVertexArrays = useVertexArrayObjects.load();
+		sample.levelOfDetailThreshold = levelOfDetailThreshold.load();
+		frameStatistics.add(sample);
+	}
+
+	/** Draws the percentiles of the recent frame times, the last frame's counts, and a graph
+		of the frame times, in a box in the bottom right corner.
+	*/
+	void drawPerformanceOverlay(Graphics& g)
+	{
+		enum { numGraphedFrames = 240, numSummarisedFrames = 600 };
+
+		auto recent = frameStatistics.getRecent(numSummarisedFrames);
+		auto bounds = getLocalBounds().removeFromBottom(190).removeFromRight(440).reduced(10);
+
+		g.setColour(Colours::black.withAlpha(0.6f));
+		g.fillRoundedRectangle(bounds.toFloat(), 4.0f);
+
+		auto area = bounds.reduced(8);
+		g.setColour(Colours::white);
+		g.setFont(Font(Font::getDefaultMonospacedFontName(), 12.0f, Font::plain));
+
+		auto describe = [&recent](const String& name, float FrameStatistics::Sample::* field)
+		{
+			auto p = FrameStatistics::getPercentiles(recent, field);
+
+			if (p.numSamples == 0)
+				return name + "n/a";
+
+			return name + String(p.p50, 2) + " / " + String(p.p95, 2) + " / " + String(p.p99, 2) + " ms";
+		};
+
+		auto drawLine = [&g, &area](const String& text)
+		{
+			g.drawText(text, area.removeFromTop(16), Justification::left);
+		};
+
+		drawLine("                p50 / p95 / p99 of " + String(recent.size()) + " frames");
+		drawLine(describe("Frame:          ", &FrameStatistics::Sample::frameMilliseconds));
+		drawLine(describe("CPU in render:  ", &FrameStatistics::Sample::renderMilliseconds));
+		drawLine(gpuTimer == nullptr || !gpuTimer->isAvailable() ? String("GPU:            no timer queries on this context")
+																 : describe("GPU:            ", &FrameStatistics::Sample::gpuMilliseconds));
+
+		if (!recent.isEmpty())
+		{
+			auto& last = recent.getReference(recent.size() - 1);
+			drawLine("Last frame:     " + String(last.drawCalls) + " draws, " + String(last.triangles) + " triangles, "
+					 + File::descriptionOfSizeInBytes(last.bytesUploaded) + " uploaded");
+		}
+
+		// The graph's scale goes up in steps of a 60 Hz frame, so it doesn't jump about
+		area.removeFromTop(6);
+		auto graph = area.toFloat();
+		auto numGraphed = jmin(recent.size(), (int)numGraphedFrames);
+		auto maxMilliseconds = 1000.0f / 60.0f;
+
+		for (auto i = recent.size() - numGraphed; i < recent.size(); ++i)
+			while (recent.getReference(i).frameMilliseconds > maxMilliseconds && maxMilliseconds < 1000.0f)
+				maxMilliseconds += 1000.0f / 60.0f;
+
+		g.setColour(Colours::white.withAlpha(0.3f));
+		g.drawRect(graph);
+
+		for (auto line = 1000.0f / 60.0f; line < maxMilliseconds; line += 1000.0f / 60.0f)
+			g.drawHorizontalLine(roundToInt(graph.getBottom() - graph.getHeight() * line / maxMilliseconds), graph.getX(), graph.getRight());
+
+		g.setColour(Colours::limegreen);
+		auto barWidth = graph.getWidth() / (float)numGraphedFrames;
+
+		for (auto i = 0; i < numGraphed; ++i)
+		{
+			auto milliseconds = recent.getReference(recent.size() - numGraphed + i).frameMilliseconds;
+
+			if (milliseconds < 0.0f)
+				continue;
+
+			auto height = graph.getHeight() * jmin(1.0f, milliseconds / maxMilliseconds);
+			g.fillRect(graph.getX() + barWidth * (float)i, graph.getBottom() - height, jmax(1.0f, barWidth), height);
+		}
+
+		g.setColour(Colours::white.withAlpha(0.6f));
+		g.drawText(String(maxMilliseconds, 1) + " ms", graph.reduced(2.0f), Justification::topRight);
+	}
+
+	enum MenuItems
+	{
+		animateItem = 1,
+		stressSceneItem,
+		vertexArraysItem,
+		overlayItem,
+		exportItem
 	};
 
+	void showOptionsMenu()
+	{
+		PopupMenu menu;
+		menu.addItem(animateItem, "Animate", true, getRenderMode() == continuousRendering);
+		menu.addItem(stressSceneItem, "Stress scene (" + String(stressSceneColumns * stressSceneRows) + " teapots)",
+					 true, isStressSceneShown());
+		menu.addItem(vertexArraysItem, "Use vertex array objects", true, useVertexArrayObjects.load());
+		menu.addSeparator();
+		menu.addItem(overlayItem, "Show performance overlay", true, isPerformanceOverlayShown());
+		menu.addItem(exportItem, "Export frame times as CSV");
+
+		menu.showMenuAsync(PopupMenu::Options(), ModalCallbackFunction::forComponent(menuItemChosen, this));
+	}
+
+	static void menuItemChosen(int result, OpenGLView* view)
+	{
+		if (view == nullptr)
+			return;
+
+		switch (result)
+		{
+			case animateItem:
+				view->setRenderMode(view->getRenderMode() == continuousRendering ? onDemandRendering : continuousRendering);
+				break;
+			case stressSceneItem:
+				view->setStressSceneShown(!view->isStressSceneShown());
+				break;
+			case vertexArraysItem:
+				view->setUsesVertexArrayObjects(!view->useVertexArrayObjects.load());
+				break;
+			case overlayItem:
+				view->setPerformanceOverlayShown(!view->isPerformanceOverlayShown());
+				break;
+			case exportItem:
+				view->exportFrameStatisticsToDocuments();
+				break;
+			default:
+				break;
+		}
+	}
+
 	const char* vertexShader;
 	const char* fragmentShader;
 
 	std::unique_ptr<OpenGLShaderProgram> shader;
-	std::unique_ptr<Shape> shape;
+	std::unique_ptr<OptionalGLFunctions> functions;
+	std::unique_ptr<StagingRing> stagingRing;
+	std::unique_ptr<GpuTimer> gpuTimer;
+	std::unique_ptr<Shape> shape, stressSceneShape;
 	std::unique_ptr<Attributes> attributes;
 	std::unique_ptr<Uniforms> uniforms;
 
+	WavefrontObjFile::AsyncLoader modelLoader;
+	std::atomic<float> levelOfDetailThreshold;
+	std::atomic<bool> useVertexArrayObjects;
+	std::atomic<RenderMode> renderMode;
+	std::atomic<bool> frameInvalidated;
+	std::atomic<int> animationFrame;
+	std::atomic<int64> numActiveFrames, numIdleFrames;
+	WavefrontObjFile::AsyncLoader stressSceneLoader;
+	std::atomic<bool> showStressScene;
+	RenderMode renderModeBeforeStressScene;   // only used on the message thread
+	double lastFrameStartTime;
+	bool lastFrameWasActive;   // both of these are only used on the GL thread
+	std::atomic<float> averageFrameMilliseconds, averageRenderMilliseconds;
+	std::atomic<bool> shaderProgramWasCached;
+	std::atomic<float> shaderMilliseconds, shaderMillisecondsSaved;
+	String shaderError;
+	SpinLock shaderErrorLock;
+	Array<GpuTimer::Result> gpuTimes;   // only used on the GL thread
+	std::atomic<bool> showPerformanceOverlay;
+	FrameStatistics frameStatistics;
+	String pickedDescription;
+
+	GLCallCounts lastFrameCounts;
+	SpinLock lastFrameCountsLock;
+
 	String newVertexShader, newFragmentShader;
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OpenGLView)
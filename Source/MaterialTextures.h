@@ -0,0 +1,158 @@
+/*
+==============================================================================
+
+MaterialTextures.h
+Created: 16 October 2026 8:45pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define the background decoder for the texture maps that .mtl
+*  materials refer to.
+*/
+
+#ifndef MATERIALTEXTURES_H_INCLUDED
+#define MATERIALTEXTURES_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+
+//==============================================================================
+/**
+*  Decodes image files on a pool of background threads. Each file is only decoded once, no
+*  matter how many materials ask for it, and the images can be fetched from any thread once
+*  they're ready. Files that can't be read or decoded end up as null Images.
+*/
+class MaterialTextures
+{
+public:
+	explicit MaterialTextures(int numThreads = jmin(4, SystemStats::getNumCpus()))
+		: numDecoding(0), waitingStopped(false), finishedEvent(true), pool(jmax(1, numThreads))
+	{
+		finishedEvent.signal();
+	}
+
+	~MaterialTextures()
+	{
+		pool.removeAllJobs(true, -1);
+	}
+
+	/** Starts decoding a file, unless it has already been added. */
+	void addTexture(const File& file)
+	{
+		const ScopedLock sl(lock);
+		auto path = file.getFullPathName();
+
+		if (textures.contains(path))
+			return;
+
+		auto* texture = ownedTextures.add(new Texture(file));
+		textures.set(path, texture);
+
+		++numDecoding;
+
+		if (!waitingStopped)
+			finishedEvent.reset();
+
+		pool.addJob(new DecodeJob(*this, *texture), true);
+	}
+
+	/** Returns the decoded image for a file, or a null Image if it hasn't been added, hasn't
+		finished decoding, or couldn't be decoded.
+	*/
+	Image getTexture(const File& file) const
+	{
+		const ScopedLock sl(lock);
+		auto* texture = textures[file.getFullPathName()];
+		return texture != nullptr && texture->isReady ? texture->image : Image();
+	}
+
+	int getNumTextures() const
+	{
+		const ScopedLock sl(lock);
+		return textures.size();
+	}
+
+	/** True once every texture that has been added so far has been decoded. */
+	bool isFinished() const
+	{
+		const ScopedLock sl(lock);
+		return numDecoding == 0;
+	}
+
+	/** Blocks until every texture that has been added so far has been decoded, or until
+		stopWaiting() is called. Returns true if every texture was decoded.
+	*/
+	bool waitUntilFinished() const
+	{
+		finishedEvent.wait(-1);
+		return isFinished();
+	}
+
+	/** Wakes up waitUntilFinished(), and makes any later calls to it return straight away.
+		This can be called from any thread, e.g. to cancel the load that's waiting.
+	*/
+	void stopWaiting()
+	{
+		const ScopedLock sl(lock);
+		waitingStopped = true;
+		finishedEvent.signal();
+	}
+
+private:
+	//==============================================================================
+	struct Texture
+	{
+		Texture(const File& f) : file(f), isReady(false) {}
+
+		const File file;
+		Image image;
+		std::atomic<bool> isReady;
+
+		JUCE_DECLARE_NON_COPYABLE(Texture)
+	};
+
+	struct DecodeJob : public ThreadPoolJob
+	{
+		DecodeJob(MaterialTextures& o, Texture& t) : ThreadPoolJob("Texture Decoder"), owner(o), texture(t) {}
+
+		JobStatus runJob() override
+		{
+			texture.image = ImageFileFormat::loadFrom(texture.file);
+			texture.isReady = true;
+			owner.decodeFinished();
+			return jobHasFinished;
+		}
+
+		MaterialTextures& owner;
+		Texture& texture;
+	};
+
+	/** Called by each DecodeJob when it's done; the last one wakes up waitUntilFinished(). */
+	void decodeFinished()
+	{
+		const ScopedLock sl(lock);
+
+		if (--numDecoding == 0)
+			finishedEvent.signal();
+	}
+
+	// The textures and the event must outlive the pool's jobs, so they're declared first
+	HashMap<String, Texture*> textures;
+	OwnedArray<Texture> ownedTextures;
+	CriticalSection lock;
+	int numDecoding;
+	bool waitingStopped;
+	WaitableEvent finishedEvent;   // manual-reset: signalled whenever nothing is decoding
+	ThreadPool pool;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MaterialTextures)
+};
+
+
+#endif  // MATERIALTEXTURES_H_INCLUDED
@@ -0,0 +1,568 @@
+/*
+==============================================================================
+
+MeshCodec.h
+Created: 17 October 2026 5:25pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define the compressed encoding of a mesh that the cache files and the
+*  mesh converter use.
+*/
+
+#ifndef MESHCODEC_H_INCLUDED
+#define MESHCODEC_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+// The SSSE3 decoder is compiled into every x86 build, whatever the compiler's target, and
+// used when the processor has SSSE3. GCC and Clang need to be told that the one function
+// that uses it may; MSVC lets any function use the intrinsics.
+#if JUCE_INTEL
+ #include <tmmintrin.h>
+ #define MESHCODEC_USE_SSSE3 1
+
+ #if JUCE_GCC || JUCE_CLANG
+  #define MESHCODEC_SSSE3_FUNCTION __attribute__ ((target ("ssse3")))
+ #else
+  #define MESHCODEC_SSSE3_FUNCTION
+ #endif
+#else
+ #define MESHCODEC_USE_SSSE3 0
+#endif
+
+
+
+//==============================================================================
+/**
+*  Encodes a mesh's attributes, indices, levels of detail and meshlets into a compact block of
+*  bytes, and decodes it again.
+*
+*  Every array is turned into a sequence of 32-bit integers, each is replaced by the zigzagged
+*  difference from the one before, and the differences are packed with Lemire's Stream VByte:
+*  one to four bytes each, with their lengths held two bits at a time in a separate run of
+*  control bytes. Decoding then needs no branches per value; with SSSE3 each control byte picks
+*  a shuffle that unpacks four values at once, which are un-zigzagged and summed in registers.
+*
+*  - Indices are encoded exactly. After MeshOptimiser, most of them are close to the one before.
+*  - Each component of an attribute (x, y and z of the positions, say) is encoded on its own,
+*    predicted from the same component of the vertex before, so it relies on the vertices being
+*    in fetch order too. By default the floats' bit patterns are encoded, which is lossless; an
+*    attribute can instead be quantised to a number of bits over its range, which is much smaller
+*    and loses at most half a step.
+*  - Meshlets are small, so they're stored as they are.
+*
+*  The encoding is little-endian whatever the machine, so it can be moved between machines.
+*/
+struct MeshCodec
+{
+	enum
+	{
+		formatVersion = 1,
+		maxQuantisationBits = 24
+	};
+
+	/** How many bits each attribute is quantised to: 0 keeps its floats exactly, and anything
+		from 1 to maxQuantisationBits spreads that many bits evenly over the range of each of its
+		components. Components that aren't finite are always kept exactly.
+	*/
+	struct Options
+	{
+		Options() noexcept : positionBits(0), normalBits(0), textureCoordBits(0) {}
+
+		int positionBits, normalBits, textureCoordBits;
+	};
+
+	//==============================================================================
+	/** Appends the encoding of a mesh to dest. The mesh is anything with vertices, normals,
+		textureCoords and indices arrays, levelsOfDetail (each with indices and an error) and
+		meshlets, like WavefrontObjFile::Mesh.
+	*/
+	template <typename MeshType>
+	static void encode(const MeshType& mesh, const Options& options, MemoryBlock& dest)
+	{
+		MemoryOutputStream out(dest, true);
+
+		out.write("MSHC", 4);
+		out.writeInt(formatVersion);
+		out.writeInt(mesh.vertices.size());
+		out.writeInt(mesh.normals.size());
+		out.writeInt(mesh.textureCoords.size());
+		out.writeInt(mesh.indices.size());
+		out.writeInt(mesh.levelsOfDetail.size());
+		out.writeInt(mesh.meshlets.size());
+		out.writeInt((int)sizeof(typename std::decay<decltype(*mesh.meshlets.begin())>::type));
+
+		encodeAttribute(mesh.vertices, options.positionBits, out);
+		encodeAttribute(mesh.normals, options.normalBits, out);
+		encodeAttribute(mesh.textureCoords, options.textureCoordBits, out);
+		encodeValues(mesh.indices.begin(), mesh.indices.size(), out);
+
+		for (auto& level : mesh.levelsOfDetail)
+		{
+			out.writeFloat(level.error);
+			out.writeInt(level.indices.size());
+			encodeValues(level.indices.begin(), level.indices.size(), out);
+		}
+
+		for (auto& meshlet : mesh.meshlets)
+			writeLittleEndianWords(&meshlet, sizeof(meshlet), out);
+	}
+
+	/** Replaces a mesh's arrays with the ones encoded in a block. Returns false, leaving the
+		mesh in an unspecified state, if the block is truncated or isn't a valid encoding, or if
+		any index (at full detail or in a level of detail) isn't below the number of vertices,
+		or any meshlet's range runs past the indices. A mesh that decodes can go straight into
+		a GL index buffer.
+	*/
+	template <typename MeshType>
+	static bool decode(const void* data, size_t numBytes, MeshType& mesh)
+	{
+		typedef typename std::decay<decltype(*mesh.meshlets.begin())>::type MeshletType;
+		typedef typename std::decay<decltype(*mesh.levelsOfDetail.begin())>::type LevelType;
+		static_assert(sizeof(MeshletType) % 4 == 0, "Meshlets must be made of 32-bit fields");
+
+		ByteReader in(data, numBytes);
+		auto* magic = in.take(4);
+
+		if (magic == nullptr || memcmp(magic, "MSHC", 4) != 0 || in.readInt() != formatVersion)
+			return false;
+
+		auto numVertices = in.readInt(), numNormals = in.readInt(), numTextureCoords = in.readInt();
+		auto numIndices = in.readInt(), numLevels = in.readInt(), numMeshlets = in.readInt();
+		auto meshletSize = in.readInt();
+
+		// Every value takes at least a byte, so no honest count can be bigger than the block
+		for (auto count : { numVertices, numNormals, numTextureCoords, numIndices, numLevels, numMeshlets })
+			if (count < 0 || (size_t)count > numBytes)
+				return false;
+
+		if (in.failed() || meshletSize != (int)sizeof(MeshletType))
+			return false;
+
+		HeapBlock<juce::uint32> scratch((size_t)jmax(1, numVertices, numNormals, numTextureCoords));
+
+		if (!(decodeAttribute(in, numVertices, mesh.vertices, scratch)
+			   && decodeAttribute(in, numNormals, mesh.normals, scratch)
+			   && decodeAttribute(in, numTextureCoords, mesh.textureCoords, scratch)
+			   && decodeIndices(in, numIndices, numVertices, mesh.indices)))
+			return false;
+
+		mesh.levelsOfDetail.clearQuick();
+
+		for (auto l = 0; l < numLevels; ++l)
+		{
+			LevelType level;
+			level.error = in.readFloat();
+			auto numLevelIndices = in.readInt();
+
+			if (in.failed() || numLevelIndices < 0 || (size_t)numLevelIndices > numBytes
+				 || !decodeIndices(in, numLevelIndices, numVertices, level.indices))
+				return false;
+
+			mesh.levelsOfDetail.add(std::move(level));
+		}
+
+		auto* meshlets = in.take((size_t)numMeshlets * sizeof(MeshletType));
+
+		if (meshlets == nullptr)
+			return false;
+
+		mesh.meshlets.clearQuick();
+		mesh.meshlets.insertMultiple(0, MeshletType(), numMeshlets);
+
+		for (auto i = 0; i < numMeshlets; ++i)
+		{
+			auto& meshlet = mesh.meshlets.getReference(i);
+			readLittleEndianWords(meshlets + (size_t)i * sizeof(MeshletType), &meshlet, sizeof(MeshletType));
+
+			if ((juce::uint64)meshlet.firstIndex + meshlet.numIndices > (juce::uint64)numIndices)
+				return false;
+		}
+
+		return in.isAtEnd();
+	}
+
+	//==============================================================================
+	/** Writes a run of 32-bit values as zigzagged differences, packed with Stream VByte: the
+		number of data bytes, then a control byte for every four values, then the data bytes.
+	*/
+	static void encodeValues(const juce::uint32* values, int numValues, OutputStream& out)
+	{
+		auto numControlBytes = (numValues + 3) / 4;
+		HeapBlock<juce::uint8> control((size_t)jmax(1, numControlBytes), true);
+		HeapBlock<juce::uint8> bytes((size_t)jmax(1, numValues * 4));
+
+		juce::uint32 previous = 0;
+		auto numDataBytes = 0;
+
+		for (auto i = 0; i < numValues; ++i)
+		{
+			auto z = zigzag(values[i] - previous);
+			previous = values[i];
+
+			auto length = z < (1u << 8) ? 1 : (z < (1u << 16) ? 2 : (z < (1u << 24) ? 3 : 4));
+			control[i / 4] |= (juce::uint8)((length - 1) << ((i % 4) * 2));
+
+			for (auto b = 0; b < length; ++b)
+				bytes[numDataBytes++] = (juce::uint8)(z >> (b * 8));
+		}
+
+		out.writeInt(numDataBytes);
+		out.write(control, (size_t)numControlBytes);
+		out.write(bytes, (size_t)numDataBytes);
+	}
+
+	/** Reads what encodeValues() wrote, for numValues values. Returns false if the block
+		doesn't hold exactly that many. Passing false for allowSSSE3 makes it use only the
+		scalar loop, so that the two can be checked against each other.
+	*/
+	static bool decodeValues(const juce::uint8*& position, const juce::uint8* end, int numValues, juce::uint32* dest,
+							 bool allowSSSE3 = true)
+	{
+		ByteReader in(position, (size_t)(end - position));
+		auto numDataBytes = in.readInt();
+		auto* control = in.take((size_t)(numValues + 3) / 4);
+		auto* p = in.take((size_t)jmax(0, numDataBytes));
+
+		if (in.failed() || numDataBytes < 0)
+			return false;
+
+		auto* dataEnd = p + numDataBytes;
+		juce::uint32 previous = 0;
+		auto i = 0;
+
+	   #if MESHCODEC_USE_SSSE3
+		if (allowSSSE3 && canUseSSSE3())
+			i = decodeGroupsWithSSSE3(control, p, dataEnd, numValues, dest, previous);
+	   #else
+		ignoreUnused(allowSSSE3);
+	   #endif
+
+		for (; i < numValues; ++i)
+		{
+			auto length = ((control[i / 4] >> ((i % 4) * 2)) & 3) + 1;
+
+			if (dataEnd - p < length)
+				return false;
+
+			juce::uint32 z = p[0];
+
+			for (auto b = 1; b < length; ++b)
+				z |= (juce::uint32)p[b] << (b * 8);
+
+			p += length;
+			previous += unzigzag(z);
+			dest[i] = previous;
+		}
+
+		position = dataEnd;
+		return p == dataEnd;
+	}
+
+	/** True if decodeValues() uses SSSE3 on this machine. */
+	static bool canUseSSSE3() noexcept
+	{
+	   #if MESHCODEC_USE_SSSE3 && (defined (__SSSE3__) || defined (__AVX__))
+		return true;
+	   #elif MESHCODEC_USE_SSSE3
+		static const bool hasSSSE3 = SystemStats::hasSSSE3();
+		return hasSSSE3;
+	   #else
+		return false;
+	   #endif
+	}
+
+private:
+   #if MESHCODEC_USE_SSSE3
+	//==============================================================================
+	/** Decodes whole groups of four values while there are 16 bytes left to read, and returns
+		how many values it decoded, leaving p and previous where the scalar loop carries on.
+	*/
+	MESHCODEC_SSSE3_FUNCTION
+	static int decodeGroupsWithSSSE3(const juce::uint8* control, const juce::uint8*& position, const juce::uint8* dataEnd,
+									 int numValues, juce::uint32* dest, juce::uint32& previous) noexcept
+	{
+		// A local copy, so the stores to dest can't be taken to change it
+		auto* p = position;
+		auto& tables = getShuffleTables();
+		const auto one = _mm_set1_epi32(1);
+		auto last = _mm_setzero_si128();
+		auto i = 0;
+
+		// A group of four reads 16 bytes whatever their lengths, so the last few are left to
+		// the scalar loop
+		for (; i + 4 <= numValues && dataEnd - p >= 16; i += 4)
+		{
+			auto c = control[i / 4];
+			auto v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*> (p)),
+									  _mm_loadu_si128(reinterpret_cast<const __m128i*> (tables.shuffles[c])));
+			p += tables.lengths[c];
+
+			v = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, one)));
+			v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+			v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+			v = _mm_add_epi32(v, last);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*> (dest + i), v);
+			last = _mm_shuffle_epi32(v, 0xff);
+		}
+
+		position = p;
+		previous = (juce::uint32)_mm_cvtsi128_si32(last);
+		return i;
+	}
+   #endif
+
+	//==============================================================================
+	/** Reads little-endian values from a block, and remembers if it ever ran off the end. */
+	struct ByteReader
+	{
+		ByteReader(const void* data, size_t numBytes) noexcept
+			: position(static_cast<const juce::uint8*> (data)), end(position + numBytes), overrun(false)
+		{
+		}
+
+		const juce::uint8* take(size_t numBytes) noexcept
+		{
+			if (overrun || (size_t)(end - position) < numBytes)
+			{
+				overrun = true;
+				return nullptr;
+			}
+
+			auto* start = position;
+			position += numBytes;
+			return start;
+		}
+
+		int readInt() noexcept
+		{
+			auto* p = take(4);
+			return p != nullptr ? (int)ByteOrder::littleEndianInt(p) : 0;
+		}
+
+		float readFloat() noexcept
+		{
+			auto bits = (juce::uint32)readInt();
+			float f;
+			memcpy(&f, &bits, sizeof(f));
+			return f;
+		}
+
+		bool failed() const noexcept      { return overrun; }
+		bool isAtEnd() const noexcept     { return !overrun && position == end; }
+
+		const juce::uint8* position;
+		const juce::uint8* end;
+		bool overrun;
+	};
+
+	/** For each control byte, the shuffle that moves its four values' bytes into four 32-bit
+		lanes, and how many data bytes they take up.
+	*/
+	struct ShuffleTables
+	{
+		ShuffleTables() noexcept
+		{
+			for (auto c = 0; c < 256; ++c)
+			{
+				auto source = 0;
+
+				for (auto lane = 0; lane < 4; ++lane)
+				{
+					auto length = ((c >> (lane * 2)) & 3) + 1;
+
+					for (auto b = 0; b < 4; ++b)
+						shuffles[c][lane * 4 + b] = (juce::int8)(b < length ? source + b : -1);
+
+					source += length;
+				}
+
+				lengths[c] = (juce::uint8)source;
+			}
+		}
+
+		juce::int8 shuffles[256][16];
+		juce::uint8 lengths[256];
+	};
+
+	static const ShuffleTables& getShuffleTables() noexcept
+	{
+		static const ShuffleTables tables;
+		return tables;
+	}
+
+	static juce::uint32 zigzag(juce::uint32 delta) noexcept
+	{
+		return (delta << 1) ^ (juce::uint32)((juce::int32)delta >> 31);
+	}
+
+	static juce::uint32 unzigzag(juce::uint32 z) noexcept
+	{
+		return (z >> 1) ^ (0u - (z & 1));
+	}
+
+	/** Maps a float's bits to an integer that goes up with the float, so that nearby values
+		have nearby codes whatever their sign.
+	*/
+	static juce::uint32 toOrderedBits(float f) noexcept
+	{
+		juce::uint32 bits;
+		memcpy(&bits, &f, sizeof(bits));
+		return (bits & 0x80000000u) != 0 ? ~bits : (bits | 0x80000000u);
+	}
+
+	static float fromOrderedBits(juce::uint32 bits) noexcept
+	{
+		bits = (bits & 0x80000000u) != 0 ? (bits & 0x7fffffffu) : ~bits;
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+		return f;
+	}
+
+	//==============================================================================
+	/** Writes each component of an array of float structs (Vertex or TextureCoord) on its own:
+		a byte for the number of bits it was quantised to, then its minimum and step if it was,
+		then its values.
+	*/
+	template <typename ElementType>
+	static void encodeAttribute(const Array<ElementType>& array, int bits, OutputStream& out)
+	{
+		const int numComponents = sizeof(ElementType) / sizeof(float);
+		auto* values = reinterpret_cast<const float*> (array.begin());
+		auto numElements = array.size();
+		HeapBlock<juce::uint32> codes((size_t)jmax(1, numElements));
+
+		bits = jlimit(0, (int)maxQuantisationBits, bits);
+
+		for (auto c = 0; c < numComponents; ++c)
+		{
+			auto low = std::numeric_limits<float>::max(), high = -low;
+
+			for (auto i = 0; i < numElements; ++i)
+			{
+				low = jmin(low, values[i * numComponents + c]);
+				high = jmax(high, values[i * numComponents + c]);
+			}
+
+			auto componentBits = (numElements > 0 && std::isfinite(low) && std::isfinite(high) && std::isfinite(high - low)) ? bits : 0;
+			out.writeByte((char)componentBits);
+
+			if (componentBits > 0)
+			{
+				auto maxCode = (juce::uint32)((1 << componentBits) - 1);
+				auto step = (high - low) / (float)maxCode;
+
+				out.writeFloat(low);
+				out.writeFloat(step);
+
+				for (auto i = 0; i < numElements; ++i)
+				{
+					auto q = step > 0.0f ? std::floor((values[i * numComponents + c] - low) / step + 0.5f) : 0.0f;
+					codes[i] = (juce::uint32)jlimit(0.0f, (float)maxCode, q);
+				}
+			}
+			else
+			{
+				for (auto i = 0; i < numElements; ++i)
+					codes[i] = toOrderedBits(values[i * numComponents + c]);
+			}
+
+			encodeValues(codes, numElements, out);
+		}
+	}
+
+	template <typename ElementType>
+	static bool decodeAttribute(ByteReader& in, int numElements, Array<ElementType>& array, juce::uint32* codes)
+	{
+		const int numComponents = sizeof(ElementType) / sizeof(float);
+
+		array.clearQuick();
+		array.insertMultiple(0, ElementType(), numElements);
+		auto* values = reinterpret_cast<float*> (array.begin());
+
+		for (auto c = 0; c < numComponents; ++c)
+		{
+			auto* bitsByte = in.take(1);
+
+			if (bitsByte == nullptr || *bitsByte > maxQuantisationBits)
+				return false;
+
+			auto bits = (int)*bitsByte;
+			auto low = bits > 0 ? in.readFloat() : 0.0f;
+			auto step = bits > 0 ? in.readFloat() : 0.0f;
+
+			if (in.failed() || !decodeValues(in.position, in.end, numElements, codes))
+				return false;
+
+			auto* dest = values + c;
+
+			if (bits > 0)
+			{
+				for (auto i = 0; i < numElements; ++i)
+					dest[i * numComponents] = low + (float)codes[i] * step;
+			}
+			else
+			{
+				for (auto i = 0; i < numElements; ++i)
+					dest[i * numComponents] = fromOrderedBits(codes[i]);
+			}
+		}
+
+		return true;
+	}
+
+	template <typename IndexType>
+	static bool decodeIndices(ByteReader& in, int numIndices, int numVertices, Array<IndexType>& indices)
+	{
+		static_assert(sizeof(IndexType) == sizeof(juce::uint32), "Indices must be 32-bit");
+
+		indices.clearQuick();
+		indices.insertMultiple(0, IndexType(), numIndices);
+
+		if (!decodeValues(in.position, in.end, numIndices, reinterpret_cast<juce::uint32*> (indices.begin())))
+			return false;
+
+		// The deltas can add up to anything, so the indices are only checked once they're decoded
+		juce::uint32 highest = 0;
+
+		for (auto index : indices)
+			highest = jmax(highest, (juce::uint32)index);
+
+		return numIndices == 0 || highest < (juce::uint32)numVertices;
+	}
+
+	/** Meshlets are made of 32-bit fields, so they're written a word at a time to keep the
+		block little-endian.
+	*/
+	static void writeLittleEndianWords(const void* source, size_t numBytes, OutputStream& out)
+	{
+		for (size_t i = 0; i < numBytes; i += 4)
+		{
+			juce::uint32 word;
+			memcpy(&word, static_cast<const char*> (source) + i, sizeof(word));
+			out.writeInt((int)word);
+		}
+	}
+
+	static void readLittleEndianWords(const juce::uint8* source, void* dest, size_t numBytes) noexcept
+	{
+		for (size_t i = 0; i < numBytes; i += 4)
+		{
+			auto word = ByteOrder::littleEndianInt(source + i);
+			memcpy(static_cast<char*> (dest) + i, &word, sizeof(word));
+		}
+	}
+};
+
+
+#endif  // MESHCODEC_H_INCLUDED
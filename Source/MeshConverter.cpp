@@ -0,0 +1,208 @@
+/*
+==============================================================================
+
+MeshConverter.cpp
+Created: 17 October 2026 6:10pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+#include "MeshConverter.h"
+#include "MainComponent.h"
+#include <iostream>
+#include <limits>
+
+
+namespace
+{
+	String getArgumentValue(const StringArray& args, const String& name, const String& defaultValue)
+	{
+		auto index = args.indexOf(name);
+		return index >= 0 && isPositiveAndBelow(index + 1, args.size()) ? args[index + 1] : defaultValue;
+	}
+
+	void log(const String& message)
+	{
+		std::cerr << message.toRawUTF8() << std::endl;
+	}
+
+	String toMegabytes(int64 numBytes)
+	{
+		return String((double)numBytes / (1000.0 * 1000.0), 2) + " MB";
+	}
+
+	/** The number of bytes a mesh's arrays take in memory, which is what a decode produces. */
+	int64 getMeshBytes(const WavefrontObjFile::Mesh& mesh)
+	{
+		auto numBytes = (int64)mesh.vertices.size() * (int64)sizeof(WavefrontObjFile::Vertex)
+					  + (int64)mesh.normals.size() * (int64)sizeof(WavefrontObjFile::Vertex)
+					  + (int64)mesh.textureCoords.size() * (int64)sizeof(WavefrontObjFile::TextureCoord)
+					  + (int64)mesh.indices.size() * (int64)sizeof(WavefrontObjFile::Index)
+					  + (int64)mesh.meshlets.size() * (int64)sizeof(WavefrontObjFile::Meshlet);
+
+		for (auto& level : mesh.levelsOfDetail)
+			numBytes += (int64)level.indices.size() * (int64)sizeof(WavefrontObjFile::Index);
+
+		return numBytes;
+	}
+
+	/** Encodes each shape and times the fastest of a few decodes of it, on this thread. Returns
+		the total decode time, or a negative number if a shape didn't decode to what was encoded.
+	*/
+	double timeDecoding(const WavefrontObjFile& model, const MeshCodec::Options& options)
+	{
+		const auto numRuns = 5;
+		auto totalSeconds = 0.0;
+
+		for (auto* shape : model.shapes)
+		{
+			MemoryBlock encoded;
+			MeshCodec::encode(shape->mesh, options, encoded);
+
+			WavefrontObjFile::Mesh decoded;
+			auto bestSeconds = std::numeric_limits<double>::max();
+
+			for (auto run = 0; run < numRuns; ++run)
+			{
+				auto start = Time::getHighResolutionTicks();
+
+				if (!MeshCodec::decode(encoded.getData(), encoded.getSize(), decoded))
+					return -1.0;
+
+				bestSeconds = jmin(bestSeconds, Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start));
+			}
+
+			if (decoded.indices != shape->mesh.indices || decoded.vertices.size() != shape->mesh.vertices.size())
+				return -1.0;
+
+			totalSeconds += bestSeconds;
+		}
+
+		return totalSeconds;
+	}
+
+	bool convertFile(const File& file, const WavefrontObjFile::LoadOptions& options)
+	{
+		// An existing cache would just be read back, so it's removed to make the load parse the file
+		auto cacheFile = ObjMeshCache::getCacheFileFor(file, options.cacheDirectory);
+		cacheFile.deleteFile();
+
+		WavefrontObjFile model;
+		auto result = model.load(file, options);
+
+		if (result.failed())
+		{
+			log(file.getFileName() + ": " + result.getErrorMessage());
+			return false;
+		}
+
+		if (!cacheFile.existsAsFile())
+		{
+			log(file.getFileName() + ": couldn't write " + cacheFile.getFullPathName());
+			return false;
+		}
+
+		int64 meshBytes = 0;
+
+		for (auto* shape : model.shapes)
+			meshBytes += getMeshBytes(shape->mesh);
+
+		auto decodeSeconds = timeDecoding(model, options.cacheCodecOptions);
+
+		if (decodeSeconds < 0.0)
+		{
+			log(file.getFileName() + ": the encoded shapes didn't decode correctly");
+			return false;
+		}
+
+		// Reading it back checks that the cache file is one a load with these options accepts
+		WavefrontObjFile reloaded;
+		auto start = Time::getHighResolutionTicks();
+
+		if (reloaded.load(file, options).failed() || !reloaded.wasLoadedFromCache())
+		{
+			log(file.getFileName() + ": the cache file wasn't accepted when read back");
+			return false;
+		}
+
+		auto reloadSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+		log(file.getFileName() + ": " + toMegabytes(file.getSize()) + " .obj, "
+			+ toMegabytes(meshBytes) + " in memory, "
+			+ toMegabytes(cacheFile.getSize()) + " cached ("
+			+ String((double)meshBytes / (double)jmax((int64)1, cacheFile.getSize()), 2) + "x); decodes at "
+			+ String((double)meshBytes / (1000.0 * 1000.0 * 1000.0) / jmax(1.0e-9, decodeSeconds), 2) + " GB/s, loads from the cache in "
+			+ String(reloadSeconds * 1000.0, 1) + " ms");
+
+		return true;
+	}
+}
+
+//==============================================================================
+bool MeshConverter::isConvertCommand(const String& commandLine)
+{
+	return StringArray::fromTokens(commandLine, true).contains("--convert-meshes");
+}
+
+int MeshConverter::run(const String& commandLine)
+{
+	auto args = StringArray::fromTokens(commandLine, true);
+	args.trim();
+	args.removeEmptyStrings();
+
+	auto input = getArgumentValue(args, "--convert-meshes", String()).unquoted();
+
+	if (input.isEmpty())
+	{
+		log("Usage: --convert-meshes <file.obj or folder> [--output-dir folder] [--threads N]\n"
+			"                        [--position-bits N] [--normal-bits N] [--texcoord-bits N]");
+		return 1;
+	}
+
+	// The viewer's options, so that it finds the cache files, less what doesn't go in them
+	auto options = OpenGLView::getModelLoadOptions();
+	options.useBinaryCache = true;
+	options.compressCache = true;
+	options.buildTriangleBvh = false;
+	options.numThreads = getArgumentValue(args, "--threads", "0").getIntValue();
+
+	auto& codec = options.cacheCodecOptions;
+	codec.positionBits = jlimit(0, (int)MeshCodec::maxQuantisationBits, getArgumentValue(args, "--position-bits", "0").getIntValue());
+	codec.normalBits = jlimit(0, (int)MeshCodec::maxQuantisationBits, getArgumentValue(args, "--normal-bits", "0").getIntValue());
+	codec.textureCoordBits = jlimit(0, (int)MeshCodec::maxQuantisationBits, getArgumentValue(args, "--texcoord-bits", "0").getIntValue());
+
+	auto outputDir = getArgumentValue(args, "--output-dir", String()).unquoted();
+
+	if (outputDir.isNotEmpty())
+	{
+		options.cacheDirectory = File::getCurrentWorkingDirectory().getChildFile(outputDir);
+
+		if (!options.cacheDirectory.createDirectory())
+		{
+			log("Couldn't create " + options.cacheDirectory.getFullPathName());
+			return 1;
+		}
+	}
+
+	auto source = File::getCurrentWorkingDirectory().getChildFile(input);
+	Array<File> files;
+
+	if (source.isDirectory())
+		source.findChildFiles(files, File::findFiles, false, "*.obj");
+	else if (source.existsAsFile())
+		files.add(source);
+
+	if (files.isEmpty())
+	{
+		log("No .obj files found at " + source.getFullPathName());
+		return 1;
+	}
+
+	auto allConverted = true;
+
+	for (auto& file : files)
+		allConverted = convertFile(file, options) && allConverted;
+
+	return allConverted ? 0 : 1;
+}
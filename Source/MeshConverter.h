@@ -0,0 +1,52 @@
+/*
+==============================================================================
+
+MeshConverter.h
+Created: 17 October 2026 6:10pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we declare the headless converter that turns .obj files into compressed
+*  mesh cache files.
+*/
+
+#ifndef MESHCONVERTER_H_INCLUDED
+#define MESHCONVERTER_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+
+//==============================================================================
+/**
+*  Loads .obj files the way the viewer does, and writes their cache files with the shapes
+*  encoded by MeshCodec, so that the viewer can open them without parsing anything. It's
+*  started by launching the app with:
+*
+*      --convert-meshes <file.obj or folder> [--output-dir folder] [--threads N]
+*                       [--position-bits N] [--normal-bits N] [--texcoord-bits N]
+*
+*  in which case no window is created and the app quits when the conversion is done,
+*  returning 0 if every file was converted. A folder converts each .obj file in it. The
+*  cache files go where the viewer looks for them unless --output-dir is given. The bit
+*  counts quantise the attributes (see MeshCodec::Options); they default to 0, which keeps
+*  them exactly, and the viewer only uses caches written with the options it loads with.
+*
+*  For each file, it prints the size of the .obj file, of its shapes in memory, and of the
+*  cache file, and how fast the encoded shapes decode.
+*/
+struct MeshConverter
+{
+	static bool isConvertCommand(const String& commandLine);
+
+	/** Runs the conversion and returns the process exit code. */
+	static int run(const String& commandLine);
+};
+
+
+#endif  // MESHCONVERTER_H_INCLUDED
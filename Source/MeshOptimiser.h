@@ -0,0 +1,474 @@
+/*
+==============================================================================
+
+MeshOptimiser.h
+Created: 16 October 2026 11:20pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define the post-load pass that reorders a mesh's triangles and vertices
+*  so that the GPU draws it with fewer vertex shader runs, less overdraw and fewer fetches.
+*/
+
+#ifndef MESHOPTIMISER_H_INCLUDED
+#define MESHOPTIMISER_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <algorithm>
+#include <cmath>
+
+
+
+//==============================================================================
+/**
+*  Reorders an indexed triangle list in three steps, each of which leaves the mesh looking
+*  exactly the same:
+*
+*  1. optimiseVertexCache() sorts the triangles with Sander, Nehab and Barczak's Tipsify
+*     algorithm, so that each one reuses as many recently transformed vertices as possible.
+*  2. optimiseOverdraw() follows the same paper: it cuts that order into clusters wherever the
+*     cache would have been cold anyway (or where the cluster's own hit rate is already good
+*     enough), and draws the clusters that face outwards first, so that the depth test rejects
+*     more of what's behind them. The threshold limits how much cache efficiency it may give
+*     up for that.
+*  3. optimiseVertexFetch() renumbers the vertices in the order the triangles first use them,
+*     so the vertex arrays are read from front to back.
+*
+*  The efficiency of an order is measured as its ACMR (average cache miss ratio): the number
+*  of vertices a FIFO post-transform cache of a typical size misses, per triangle. It ranges
+*  from 3 (no reuse at all) down to about 0.5 for a regular grid.
+*/
+struct MeshOptimiser
+{
+	typedef juce::uint32 Index;
+
+	/** The FIFO size that getACMR() and optimiseVertexCache() model, which is about what
+		current GPUs have.
+	*/
+	enum { fifoCacheSize = 16 };
+
+	/** What optimise() did to one mesh. */
+	struct Report
+	{
+		int numTriangles;
+		double acmrBefore, acmrAfter;
+	};
+
+	//==============================================================================
+	/** Returns the number of FIFO cache misses per triangle for an index list. */
+	static double getACMR(const Index* indices, int numIndices, int numVertices, int cacheSize = fifoCacheSize)
+	{
+		auto numTriangles = numIndices / 3;
+
+		if (numTriangles == 0)
+			return 0.0;
+
+		FifoCache cache(numVertices, cacheSize);
+		int64 misses = 0;
+
+		for (auto i = 0; i < numTriangles * 3; ++i)
+			misses += cache.access(indices[i]) ? 0 : 1;
+
+		return (double)misses / (double)numTriangles;
+	}
+
+	/** Runs all three steps on a mesh that has indices, vertices and optionally normals and
+		texture coordinates, all indexed by the same vertex index. Returns false and leaves the
+		mesh alone if its indices aren't whole triangles that all refer to existing vertices.
+
+		Meshes whose triangles are already in a better order than the first two steps find (a
+		tessellated patch, say) keep their original order. The vertex renumbering is skipped if
+		the normal or texture coordinate arrays aren't the same length as the vertex array, since
+		they couldn't be moved along with the vertices.
+	*/
+	template <typename MeshType>
+	static bool optimise(MeshType& mesh, Report& report, float overdrawThreshold = 1.05f)
+	{
+		auto numIndices = mesh.indices.size();
+		auto numVertices = mesh.vertices.size();
+
+		report.numTriangles = numIndices / 3;
+		report.acmrBefore = report.acmrAfter = 0.0;
+
+		if (numIndices % 3 != 0)
+			return false;
+
+		auto* indices = mesh.indices.begin();
+
+		for (auto i = 0; i < numIndices; ++i)
+			if (indices[i] >= (Index)numVertices)
+				return false;
+
+		report.acmrBefore = getACMR(indices, numIndices, numVertices);
+
+		Array<Index> originalOrder(indices, numIndices);
+		optimiseVertexCache(indices, numIndices, numVertices);
+		optimiseOverdraw(indices, numIndices, mesh.vertices.begin(), numVertices, overdrawThreshold);
+
+		if (getACMR(indices, numIndices, numVertices) >= report.acmrBefore)
+			mesh.indices.swapWith(originalOrder);
+
+		auto hasMatchingArray = [numVertices] (int size) { return size == 0 || size == numVertices; };
+
+		if (hasMatchingArray(mesh.normals.size()) && hasMatchingArray(mesh.textureCoords.size()))
+			optimiseVertexFetch(mesh);
+
+		report.acmrAfter = getACMR(mesh.indices.begin(), numIndices, mesh.vertices.size());
+		return true;
+	}
+
+	//==============================================================================
+	/** Reorders the triangles for a FIFO post-transform cache of the given size, with the
+		Tipsify algorithm: it draws every remaining triangle around one vertex, then moves on to
+		the vertex from that fan which will still be in the cache by the time its own fan is
+		drawn, backtracking through recently used vertices when there isn't one.
+
+		Every index must be below numVertices.
+	*/
+	static void optimiseVertexCache(Index* indices, int numIndices, int numVertices, int cacheSize = fifoCacheSize)
+	{
+		auto numTriangles = numIndices / 3;
+
+		if (numTriangles < 2)
+			return;
+
+		// For each vertex, the triangles that use it, and how many of them are still to be drawn
+		HeapBlock<int> firstTriangle((size_t)numVertices + 1, true), vertexTriangles((size_t)numIndices);
+		HeapBlock<int> liveTriangles((size_t)numVertices, true);
+
+		for (auto i = 0; i < numIndices; ++i)
+			++liveTriangles[indices[i]];
+
+		for (auto v = 0; v < numVertices; ++v)
+			firstTriangle[v + 1] = firstTriangle[v] + liveTriangles[v];
+
+		{
+			HeapBlock<int> fill((size_t)numVertices, true);
+
+			for (auto i = 0; i < numIndices; ++i)
+			{
+				auto v = indices[i];
+				vertexTriangles[firstTriangle[v] + fill[v]++] = i / 3;
+			}
+		}
+
+		HeapBlock<int> timestamps((size_t)numVertices, true);
+		HeapBlock<bool> emitted((size_t)numTriangles, true);
+		HeapBlock<Index> result((size_t)numIndices), deadEnds((size_t)numIndices);
+		Array<Index> fanVertices;
+
+		auto numEmitted = 0, numDeadEnds = 0, nextInputVertex = 0;
+		auto now = cacheSize + 1;
+		auto fanVertex = (int)indices[0];
+
+		while (fanVertex >= 0)
+		{
+			fanVertices.clearQuick();
+
+			for (auto j = firstTriangle[fanVertex]; j < firstTriangle[fanVertex + 1]; ++j)
+			{
+				auto t = vertexTriangles[j];
+
+				if (emitted[t])
+					continue;
+
+				emitted[t] = true;
+
+				for (auto k = 0; k < 3; ++k)
+				{
+					auto v = indices[t * 3 + k];
+					result[numEmitted++] = v;
+					deadEnds[numDeadEnds++] = v;
+					fanVertices.add(v);
+					--liveTriangles[v];
+
+					if (now - timestamps[v] > cacheSize)
+						timestamps[v] = now++;
+				}
+			}
+
+			// Prefer the vertex that has been in the cache longest, as long as drawing its fan
+			// (at most two new vertices per triangle) won't push it out first
+			fanVertex = -1;
+			auto bestPriority = -1;
+
+			for (auto v : fanVertices)
+			{
+				if (liveTriangles[v] > 0)
+				{
+					auto age = now - timestamps[v];
+					auto priority = age + 2 * liveTriangles[v] <= cacheSize ? age : 0;
+
+					if (priority > bestPriority)
+					{
+						bestPriority = priority;
+						fanVertex = (int)v;
+					}
+				}
+			}
+
+			if (fanVertex < 0)
+			{
+				while (numDeadEnds > 0 && fanVertex < 0)
+				{
+					auto v = deadEnds[--numDeadEnds];
+
+					if (liveTriangles[v] > 0)
+						fanVertex = (int)v;
+				}
+
+				while (fanVertex < 0 && nextInputVertex < numVertices)
+				{
+					if (liveTriangles[nextInputVertex] > 0)
+						fanVertex = nextInputVertex;
+					else
+						++nextInputVertex;
+				}
+			}
+		}
+
+		jassert(numEmitted == numTriangles * 3);
+		memcpy(indices, result, (size_t)numIndices * sizeof(Index));
+	}
+
+	//==============================================================================
+	/** Reorders clusters of triangles so that the outward-facing ones come first. The triangles
+		should already be in vertex cache order; the result's ACMR is kept within threshold times
+		that of the input. Positions are anything with x, y and z members.
+	*/
+	template <typename PositionType>
+	static void optimiseOverdraw(Index* indices, int numIndices, const PositionType* positions, int numVertices,
+								 float threshold)
+	{
+		auto numTriangles = numIndices / 3;
+
+		if (numTriangles < 2)
+			return;
+
+		auto clusters = findClusters(indices, numTriangles, numVertices, threshold);
+		auto numClusters = clusters.size() - 1;
+
+		if (numClusters < 2)
+			return;
+
+		// Each cluster is sorted on how far its area-weighted centre lies outside the middle of
+		// the mesh, along its average normal
+		double meshCentre[3] = {};
+
+		for (auto v = 0; v < numVertices; ++v)
+		{
+			meshCentre[0] += positions[v].x;
+			meshCentre[1] += positions[v].y;
+			meshCentre[2] += positions[v].z;
+		}
+
+		for (auto& c : meshCentre)
+			c /= jmax(1, numVertices);
+
+		Array<ClusterOrder> order;
+		order.ensureStorageAllocated(numClusters);
+
+		for (auto c = 0; c < numClusters; ++c)
+		{
+			double centre[3] = {}, normal[3] = {}, totalArea = 0.0;
+
+			for (auto t = clusters.getUnchecked(c); t < clusters.getUnchecked(c + 1); ++t)
+			{
+				auto& p0 = positions[indices[t * 3]];
+				auto& p1 = positions[indices[t * 3 + 1]];
+				auto& p2 = positions[indices[t * 3 + 2]];
+
+				double e1[3] = { (double)p1.x - p0.x, (double)p1.y - p0.y, (double)p1.z - p0.z };
+				double e2[3] = { (double)p2.x - p0.x, (double)p2.y - p0.y, (double)p2.z - p0.z };
+				double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				auto area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+				centre[0] += area * ((double)p0.x + p1.x + p2.x) / 3.0;
+				centre[1] += area * ((double)p0.y + p1.y + p2.y) / 3.0;
+				centre[2] += area * ((double)p0.z + p1.z + p2.z) / 3.0;
+
+				for (auto k = 0; k < 3; ++k)
+					normal[k] += n[k];
+
+				totalArea += area;
+			}
+
+			auto normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			auto sortKey = 0.0;
+
+			if (totalArea > 0.0 && normalLength > 0.0)
+				for (auto k = 0; k < 3; ++k)
+					sortKey += (centre[k] / totalArea - meshCentre[k]) * normal[k] / normalLength;
+
+			order.add({ sortKey, c });
+		}
+
+		std::stable_sort(order.begin(), order.end(),
+						 [] (const ClusterOrder& a, const ClusterOrder& b) { return a.sortKey > b.sortKey; });
+
+		HeapBlock<Index> result((size_t)numIndices);
+		auto* out = result.get();
+
+		for (auto& o : order)
+		{
+			auto start = clusters.getUnchecked(o.cluster) * 3;
+			auto end = clusters.getUnchecked(o.cluster + 1) * 3;
+
+			memcpy(out, indices + start, (size_t)(end - start) * sizeof(Index));
+			out += end - start;
+		}
+
+		memcpy(indices, result, (size_t)numIndices * sizeof(Index));
+	}
+
+	//==============================================================================
+	/** Renumbers the vertices in the order the indices first refer to them, and moves the
+		vertices, normals and texture coordinates to match. Vertices that no triangle uses are
+		dropped. Normals and texture coordinates must either be empty or the same length as the
+		vertices.
+	*/
+	template <typename MeshType>
+	static void optimiseVertexFetch(MeshType& mesh)
+	{
+		auto numVertices = mesh.vertices.size();
+		HeapBlock<Index> newIndexOf((size_t)numVertices);
+
+		for (auto v = 0; v < numVertices; ++v)
+			newIndexOf[v] = (Index)-1;
+
+		Index numUsed = 0;
+
+		for (auto& index : mesh.indices)
+		{
+			if (newIndexOf[index] == (Index)-1)
+				newIndexOf[index] = numUsed++;
+
+			index = newIndexOf[index];
+		}
+
+		remapArray(mesh.vertices, newIndexOf, (int)numUsed);
+		remapArray(mesh.normals, newIndexOf, (int)numUsed);
+		remapArray(mesh.textureCoords, newIndexOf, (int)numUsed);
+	}
+
+private:
+	//==============================================================================
+	/** Models a FIFO cache with a timestamp per vertex, so a lookup is a single comparison. */
+	struct FifoCache
+	{
+		FifoCache(int numVertices, int size)
+			: timestamps((size_t)numVertices, true), cacheSize((juce::uint32)size), now((juce::uint32)size + 1)
+		{
+		}
+
+		/** Returns true on a hit; on a miss, the vertex is pushed into the cache. */
+		bool access(Index v) noexcept
+		{
+			if (now - timestamps[v] <= cacheSize)
+				return true;
+
+			timestamps[v] = now++;
+			return false;
+		}
+
+		/** Empties the cache. */
+		void flush() noexcept
+		{
+			now += cacheSize + 1;
+		}
+
+		HeapBlock<juce::uint32> timestamps;
+		const juce::uint32 cacheSize;
+		juce::uint32 now;
+	};
+
+	struct ClusterOrder
+	{
+		double sortKey;
+		int cluster;
+	};
+
+	/** Returns the triangle index at which each cluster starts, followed by numTriangles. A
+		cluster starts wherever a triangle misses on all three of its vertices (the cache order
+		jumped somewhere new), and within those, wherever the triangles since the last start have
+		already reached the whole cluster's miss ratio times the threshold.
+	*/
+	static Array<int> findClusters(const Index* indices, int numTriangles, int numVertices, float threshold)
+	{
+		Array<int> hardStarts, clusters;
+		FifoCache cache(numVertices, fifoCacheSize);
+
+		for (auto t = 0; t < numTriangles; ++t)
+		{
+			auto misses = 0;
+
+			for (auto k = 0; k < 3; ++k)
+				misses += cache.access(indices[t * 3 + k]) ? 0 : 1;
+
+			if (t == 0 || misses == 3)
+				hardStarts.add(t);
+		}
+
+		hardStarts.add(numTriangles);
+
+		for (auto h = 0; h + 1 < hardStarts.size(); ++h)
+		{
+			auto start = hardStarts.getUnchecked(h);
+			auto end = hardStarts.getUnchecked(h + 1);
+
+			cache.flush();
+			auto clusterMisses = 0;
+
+			for (auto i = start * 3; i < end * 3; ++i)
+				clusterMisses += cache.access(indices[i]) ? 0 : 1;
+
+			auto target = threshold * (double)clusterMisses / (double)(end - start);
+
+			cache.flush();
+			clusters.add(start);
+			auto subClusterStart = start;
+			auto misses = 0;
+
+			for (auto t = start; t < end - 1; ++t)
+			{
+				for (auto k = 0; k < 3; ++k)
+					misses += cache.access(indices[t * 3 + k]) ? 0 : 1;
+
+				if ((double)misses <= target * (double)(t + 1 - subClusterStart))
+				{
+					subClusterStart = t + 1;
+					clusters.add(subClusterStart);
+					cache.flush();
+					misses = 0;
+				}
+			}
+		}
+
+		clusters.add(numTriangles);
+		return clusters;
+	}
+
+	template <typename ElementType>
+	static void remapArray(Array<ElementType>& array, const Index* newIndexOf, int numUsed)
+	{
+		if (array.isEmpty())
+			return;
+
+		Array<ElementType> remapped;
+		remapped.insertMultiple(0, ElementType(), numUsed);
+
+		for (auto v = 0; v < array.size(); ++v)
+			if (newIndexOf[v] != (Index)-1)
+				remapped.setUnchecked((int)newIndexOf[v], array.getReference(v));
+
+		array.swapWith(remapped);
+	}
+};
+
+
+#endif  // MESHOPTIMISER_H_INCLUDED
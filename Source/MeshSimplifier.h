@@ -0,0 +1,444 @@
+/*
+==============================================================================
+
+MeshSimplifier.h
+Created: 17 October 2026 9:40am
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define the quadric error edge collapse that the loader uses to build
+*  coarser levels of detail for each shape.
+*/
+
+#ifndef MESHSIMPLIFIER_H_INCLUDED
+#define MESHSIMPLIFIER_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <algorithm>
+#include <cmath>
+
+
+
+//==============================================================================
+/**
+*  Reduces an indexed triangle list by collapsing edges, choosing each time the collapse that
+*  moves the surface least, as measured by Garland and Heckbert's quadric error metric.
+*
+*  Each collapse moves one end of an edge onto the other, so the simplified triangles only
+*  ever refer to vertices that were already there: a level of detail is just another index
+*  list over the same vertex arrays, and its normals and texture coordinates stay valid.
+*
+*  Edges that only belong to one triangle (the edge of an open surface, or a seam where the
+*  normals or texture coordinates are split) get extra quadrics that keep them in place, and
+*  their vertices may only slide along them. Collapses that would flip a triangle over are
+*  skipped.
+*
+*  Collapses are made in passes. Each pass scores every edge, then works through them from the
+*  cheapest, taking any collapse whose neighbourhood hasn't already been changed by that pass,
+*  so every decision is made against up-to-date geometry without keeping a priority queue.
+*/
+struct MeshSimplifier
+{
+	typedef juce::uint32 Index;
+
+	/** Returns a simplified copy of a triangle list with no more than targetNumIndices indices
+		(or as close to that as it could get), and sets resultError to the largest distance,
+		in the positions' units, that a collapse moved the surface. Every index must be below
+		numVertices; positions are anything with x, y and z members.
+	*/
+	template <typename PositionType>
+	static Array<Index> simplify(const Index* indices, int numIndices, const PositionType* positions, int numVertices,
+								 int targetNumIndices, float& resultError)
+	{
+		Array<Index> result(indices, numIndices - numIndices % 3);
+		resultError = 0.0f;
+
+		HeapBlock<Quadric> faceQuadrics((size_t)numVertices, true), borderQuadrics((size_t)numVertices, true);
+		addFaceQuadrics(result, positions, faceQuadrics);
+
+		Array<Edge> edges;
+		HeapBlock<bool> isBorderVertex((size_t)numVertices);
+		findEdges(result, edges, isBorderVertex, numVertices);
+		addBorderQuadrics(result, edges, positions, borderQuadrics);
+
+		HeapBlock<Index> collapsedInto((size_t)numVertices);
+		HeapBlock<bool> isLocked((size_t)numVertices);
+		HeapBlock<int> firstTriangle((size_t)numVertices + 1), vertexTriangles;
+		Array<Collapse> collapses;
+
+		const auto notAllowed = 1.0e300;
+		auto worstError = 0.0;
+
+		for (auto pass = 0; pass < maxPasses && result.size() > targetNumIndices; ++pass)
+		{
+			if (pass > 0)
+				findEdges(result, edges, isBorderVertex, numVertices);
+
+			// Score both directions of every edge that's allowed to collapse
+			collapses.clearQuick();
+
+			for (auto& edge : edges)
+			{
+				auto forwards = canCollapse(edge.a, edge, isBorderVertex);
+				auto backwards = canCollapse(edge.b, edge, isBorderVertex);
+
+				if (!(forwards || backwards))
+					continue;
+
+				auto face = faceQuadrics[edge.a] + faceQuadrics[edge.b];
+				auto border = borderQuadrics[edge.a] + borderQuadrics[edge.b];
+				auto errorAtB = forwards ? getError(face, border, positions[edge.b]) : Error { notAllowed, 0.0 };
+				auto errorAtA = backwards ? getError(face, border, positions[edge.a]) : Error { notAllowed, 0.0 };
+
+				if (errorAtB.cost <= errorAtA.cost)
+					collapses.add({ errorAtB.cost, errorAtB.distanceSquared, edge.a, edge.b });
+				else
+					collapses.add({ errorAtA.cost, errorAtA.distanceSquared, edge.b, edge.a });
+			}
+
+			if (collapses.isEmpty())
+				break;
+
+			std::sort(collapses.begin(), collapses.end());
+
+			buildAdjacency(result, numVertices, firstTriangle, vertexTriangles);
+
+			for (auto v = 0; v < numVertices; ++v)
+			{
+				collapsedInto[v] = (Index)v;
+				isLocked[v] = false;
+			}
+
+			// Each interior collapse removes two triangles, so aim for half the excess
+			auto numTrianglesToRemove = (result.size() - targetNumIndices) / 3;
+			auto numRemoved = 0;
+
+			for (auto& collapse : collapses)
+			{
+				if (numRemoved >= numTrianglesToRemove)
+					break;
+
+				auto from = collapse.from, to = collapse.to;
+
+				if (isLocked[from] || isLocked[to])
+					continue;
+
+				auto* triangles = vertexTriangles + firstTriangle[from];
+				auto numTriangles = firstTriangle[from + 1] - firstTriangle[from];
+
+				if (wouldFlip(result.begin(), triangles, numTriangles, from, to, positions))
+					continue;
+
+				// Nothing around this collapse may move again in this pass, or the flip test
+				// above would be out of date
+				for (auto i = 0; i < numTriangles; ++i)
+				{
+					auto* t = result.begin() + triangles[i] * 3;
+
+					for (auto k = 0; k < 3; ++k)
+					{
+						isLocked[t[k]] = true;
+
+						if (t[k] == to)
+							++numRemoved;
+					}
+				}
+
+				isLocked[to] = true;
+				collapsedInto[from] = to;
+				faceQuadrics[to] = faceQuadrics[to] + faceQuadrics[from];
+				borderQuadrics[to] = borderQuadrics[to] + borderQuadrics[from];
+				worstError = jmax(worstError, collapse.distanceSquared);
+			}
+
+			auto sizeBefore = result.size();
+			removeCollapsedTriangles(result, collapsedInto);
+
+			if (result.size() == sizeBefore)
+				break;
+		}
+
+		resultError = (float)std::sqrt(worstError);
+		return result;
+	}
+
+private:
+	//==============================================================================
+	enum { maxPasses = 64 };
+
+	/** A symmetric 4x4 matrix that sums the weighted squared distances to a set of planes,
+		with the total weight kept alongside so the error can be normalised.
+	*/
+	struct Quadric
+	{
+		double a00, a01, a02, a11, a12, a22, b0, b1, b2, c, weight;
+
+		static Quadric fromPlane(double nx, double ny, double nz, double d, double w) noexcept
+		{
+			return { w * nx * nx, w * nx * ny, w * nx * nz, w * ny * ny, w * ny * nz, w * nz * nz,
+					 w * nx * d, w * ny * d, w * nz * d, w * d * d, w };
+		}
+
+		Quadric operator+ (const Quadric& o) const noexcept
+		{
+			return { a00 + o.a00, a01 + o.a01, a02 + o.a02, a11 + o.a11, a12 + o.a12, a22 + o.a22,
+					 b0 + o.b0, b1 + o.b1, b2 + o.b2, c + o.c, weight + o.weight };
+		}
+
+		/** Returns the weighted mean squared distance from a point to the planes. */
+		template <typename PositionType>
+		double getError(const PositionType& p) const noexcept
+		{
+			double x = p.x, y = p.y, z = p.z;
+
+			auto e = x * (a00 * x + 2.0 * (a01 * y + a02 * z + b0))
+				   + y * (a11 * y + 2.0 * (a12 * z + b1))
+				   + z * (a22 * z + 2.0 * b2)
+				   + c;
+
+			return std::abs(e) / jmax(weight, 1.0e-20);
+		}
+	};
+
+	struct Edge
+	{
+		Index a, b;
+		int triangle;       // one of the triangles the edge belongs to
+		bool isBorder;      // true if it only belongs to that one
+	};
+
+	struct Collapse
+	{
+		double cost, distanceSquared;
+		Index from, to;
+
+		bool operator< (const Collapse& other) const noexcept    { return cost < other.cost; }
+	};
+
+	struct Vector
+	{
+		double x, y, z;
+
+		template <typename PositionType>
+		static Vector of(const PositionType& p) noexcept          { return { p.x, p.y, p.z }; }
+
+		Vector operator- (const Vector& o) const noexcept         { return { x - o.x, y - o.y, z - o.z }; }
+		Vector cross(const Vector& o) const noexcept              { return { y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x }; }
+		double dot(const Vector& o) const noexcept                { return x * o.x + y * o.y + z * o.z; }
+		double length() const noexcept                            { return std::sqrt(dot(*this)); }
+	};
+
+	/** The cost of a collapse weighs moving off a border far above moving off a face, but
+		its distance is the plain distance from whichever of the two it moved further from.
+	*/
+	struct Error
+	{
+		double cost, distanceSquared;
+	};
+
+	template <typename PositionType>
+	static Error getError(const Quadric& face, const Quadric& border, const PositionType& p) noexcept
+	{
+		const auto borderWeight = 100.0;
+
+		auto faceError = face.getError(p);
+		auto borderError = border.weight > 0.0 ? border.getError(p) : 0.0;
+
+		return { faceError + borderWeight * borderError, jmax(faceError, borderError) };
+	}
+
+	//==============================================================================
+	template <typename PositionType>
+	static Vector getNormal(const PositionType& p0, const PositionType& p1, const PositionType& p2) noexcept
+	{
+		auto v0 = Vector::of(p0);
+		return (Vector::of(p1) - v0).cross(Vector::of(p2) - v0);
+	}
+
+	template <typename PositionType>
+	static void addFaceQuadrics(const Array<Index>& indices, const PositionType* positions, Quadric* quadrics)
+	{
+		for (auto i = 0; i < indices.size(); i += 3)
+		{
+			auto& p0 = positions[indices.getUnchecked(i)];
+			auto n = getNormal(p0, positions[indices.getUnchecked(i + 1)], positions[indices.getUnchecked(i + 2)]);
+			auto length = n.length();
+
+			if (length <= 0.0)
+				continue;
+
+			auto area = 0.5 * length;
+			n = { n.x / length, n.y / length, n.z / length };
+
+			auto q = Quadric::fromPlane(n.x, n.y, n.z, -n.dot(Vector::of(p0)), area);
+
+			for (auto k = 0; k < 3; ++k)
+			{
+				auto& target = quadrics[indices.getUnchecked(i + k)];
+				target = target + q;
+			}
+		}
+	}
+
+	/** Adds a plane through each border edge, at right angles to its triangle. */
+	template <typename PositionType>
+	static void addBorderQuadrics(const Array<Index>& indices, const Array<Edge>& edges,
+								  const PositionType* positions, Quadric* quadrics)
+	{
+		for (auto& edge : edges)
+		{
+			if (!edge.isBorder)
+				continue;
+
+			auto* t = indices.begin() + edge.triangle * 3;
+			auto faceNormal = getNormal(positions[t[0]], positions[t[1]], positions[t[2]]);
+			auto pa = Vector::of(positions[edge.a]);
+			auto along = Vector::of(positions[edge.b]) - pa;
+			auto n = along.cross(faceNormal);
+			auto length = n.length();
+
+			if (length <= 0.0)
+				continue;
+
+			n = { n.x / length, n.y / length, n.z / length };
+
+			auto q = Quadric::fromPlane(n.x, n.y, n.z, -n.dot(pa), along.length());
+
+			quadrics[edge.a] = quadrics[edge.a] + q;
+			quadrics[edge.b] = quadrics[edge.b] + q;
+		}
+	}
+
+	/** Lists every distinct edge, and marks the vertices that are on a border. */
+	static void findEdges(const Array<Index>& indices, Array<Edge>& edges, bool* isBorderVertex, int numVertices)
+	{
+		// Each key packs the edge's vertices, lowest first, so that sorting the keys brings all
+		// the uses of an edge together
+		struct EdgeUse
+		{
+			juce::uint64 key;
+			int triangle;
+
+			bool operator< (const EdgeUse& other) const noexcept    { return key < other.key; }
+		};
+
+		Array<EdgeUse> uses;
+		uses.ensureStorageAllocated(indices.size());
+
+		for (auto i = 0; i < indices.size(); i += 3)
+		{
+			for (auto k = 0; k < 3; ++k)
+			{
+				auto a = indices.getUnchecked(i + k);
+				auto b = indices.getUnchecked(i + (k + 1) % 3);
+
+				if (a != b)
+					uses.add({ (juce::uint64)jmin(a, b) << 32 | jmax(a, b), i / 3 });
+			}
+		}
+
+		std::sort(uses.begin(), uses.end());
+
+		edges.clearQuick();
+
+		for (auto v = 0; v < numVertices; ++v)
+			isBorderVertex[v] = false;
+
+		for (auto i = 0; i < uses.size();)
+		{
+			auto& use = uses.getReference(i);
+			auto end = i + 1;
+
+			while (end < uses.size() && uses.getReference(end).key == use.key)
+				++end;
+
+			Edge edge = { (Index)(use.key >> 32), (Index)(use.key & 0xffffffff), use.triangle, end - i == 1 };
+			edges.add(edge);
+
+			if (edge.isBorder)
+				isBorderVertex[edge.a] = isBorderVertex[edge.b] = true;
+
+			i = end;
+		}
+	}
+
+	/** A border vertex may only move along a border edge, or the outline would change. */
+	static bool canCollapse(Index from, const Edge& edge, const bool* isBorderVertex) noexcept
+	{
+		return !isBorderVertex[from] || edge.isBorder;
+	}
+
+	static void buildAdjacency(const Array<Index>& indices, int numVertices, HeapBlock<int>& firstTriangle,
+							   HeapBlock<int>& vertexTriangles)
+	{
+		for (auto v = 0; v <= numVertices; ++v)
+			firstTriangle[v] = 0;
+
+		for (auto index : indices)
+			++firstTriangle[index + 1];
+
+		for (auto v = 0; v < numVertices; ++v)
+			firstTriangle[v + 1] += firstTriangle[v];
+
+		vertexTriangles.malloc((size_t)jmax(1, indices.size()));
+		HeapBlock<int> fill((size_t)numVertices, true);
+
+		for (auto i = 0; i < indices.size(); ++i)
+		{
+			auto v = indices.getUnchecked(i);
+			vertexTriangles[firstTriangle[v] + fill[v]++] = i / 3;
+		}
+	}
+
+	/** Returns true if moving from onto to would turn any of from's other triangles over. */
+	template <typename PositionType>
+	static bool wouldFlip(const Index* indices, const int* triangles, int numTriangles, Index from, Index to,
+						  const PositionType* positions) noexcept
+	{
+		for (auto i = 0; i < numTriangles; ++i)
+		{
+			auto* t = indices + triangles[i] * 3;
+
+			if (t[0] == to || t[1] == to || t[2] == to)
+				continue;
+
+			auto before = getNormal(positions[t[0]], positions[t[1]], positions[t[2]]);
+			auto after = getNormal(positions[t[0] == from ? to : t[0]],
+								   positions[t[1] == from ? to : t[1]],
+								   positions[t[2] == from ? to : t[2]]);
+
+			if (before.dot(after) <= 0.0)
+				return true;
+		}
+
+		return false;
+	}
+
+	static void removeCollapsedTriangles(Array<Index>& indices, const Index* collapsedInto)
+	{
+		auto* data = indices.begin();
+		auto numKept = 0;
+
+		for (auto i = 0; i < indices.size(); i += 3)
+		{
+			auto a = collapsedInto[data[i]], b = collapsedInto[data[i + 1]], c = collapsedInto[data[i + 2]];
+
+			if (a != b && b != c && a != c)
+			{
+				data[numKept++] = a;
+				data[numKept++] = b;
+				data[numKept++] = c;
+			}
+		}
+
+		indices.removeRange(numKept, indices.size() - numKept);
+	}
+};
+
+
+#endif  // MESHSIMPLIFIER_H_INCLUDED
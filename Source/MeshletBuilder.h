@@ -0,0 +1,394 @@
+/*
+==============================================================================
+
+MeshletBuilder.h
+Created: 17 October 2026 1:15pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define how the loader splits each shape into meshlets: small runs of
+*  triangles with bounds that the renderer can cull as a unit.
+*/
+
+#ifndef MESHLETBUILDER_H_INCLUDED
+#define MESHLETBUILDER_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MeshOptimiser.h"
+#include <algorithm>
+#include <cmath>
+
+
+
+//==============================================================================
+/**
+*  Splits a triangle list into meshlets of up to maxVertices distinct vertices and
+*  maxTriangles triangles, and works out for each one a bounding box, a bounding sphere and a
+*  normal cone.
+*
+*  The triangles are reordered so that each meshlet is a range of the index buffer, which can
+*  be drawn on its own. A meshlet is grown from a seed triangle by adding, each time, the
+*  neighbouring triangle that brings in the fewest new vertices and faces most nearly the same
+*  way as the triangles it already has, so the meshlets come out as compact patches with
+*  narrow normal cones. A meshlet is closed early when the only triangles left next to it face
+*  too far away from it, or when it has no neighbours left.
+*
+*  Seeds are taken in the triangles' original order, and once a meshlet is complete, its own
+*  triangles are put back into vertex cache order with MeshOptimiser, so the cost of cutting a
+*  mesh into meshlets is mostly in the vertices that are shared along their edges.
+*
+*  The normal cone gives a test in the spirit of Shirman and Abi-Ezzi's cone of normals: if the
+*  direction from the camera to the cone's apex is within the cone's cutoff of its axis, every
+*  triangle in the meshlet faces away from the camera.
+*/
+struct MeshletBuilder
+{
+	typedef juce::uint32 Index;
+
+	enum
+	{
+		defaultMaxVertices = 64,
+		defaultMaxTriangles = 124
+	};
+
+	struct Meshlet
+	{
+		juce::uint32 firstIndex, numIndices;   // a range of the mesh's indices
+		juce::uint32 numVertices;              // the distinct vertices those indices use
+
+		float centre[3], radius;
+		float boundsMin[3], boundsMax[3];
+
+		/** The meshlet faces away from a camera at c if
+			dot(normalise(coneApex - c), coneAxis) >= coneCutoff. A cutoff of 1 or more means
+			its triangles face too many ways for it ever to be culled like that.
+		*/
+		float coneApex[3], coneAxis[3], coneCutoff;
+	};
+
+	/** Reorders a triangle list into meshlets and returns them. Leaves the indices alone and
+		returns nothing if they aren't whole triangles that all refer to existing vertices;
+		positions are anything with x, y and z members.
+	*/
+	template <typename PositionType>
+	static Array<Meshlet> build(Index* indices, int numIndices, const PositionType* positions, int numVertices,
+								int maxVertices = defaultMaxVertices, int maxTriangles = defaultMaxTriangles)
+	{
+		Array<Meshlet> meshlets;
+
+		if (numIndices % 3 != 0 || maxVertices < 3 || maxTriangles < 1)
+			return meshlets;
+
+		for (auto i = 0; i < numIndices; ++i)
+			if (indices[i] >= (Index)numVertices)
+				return meshlets;
+
+		auto numTriangles = numIndices / 3;
+
+		// For each vertex, the triangles that use it, and how many of them are still to be placed
+		HeapBlock<int> firstTriangle((size_t)numVertices + 1, true), vertexTriangles((size_t)numIndices);
+		HeapBlock<int> liveTriangles((size_t)numVertices, true);
+
+		for (auto i = 0; i < numIndices; ++i)
+			++liveTriangles[indices[i]];
+
+		for (auto v = 0; v < numVertices; ++v)
+			firstTriangle[v + 1] = firstTriangle[v] + liveTriangles[v];
+
+		{
+			HeapBlock<int> fill((size_t)numVertices, true);
+
+			for (auto i = 0; i < numIndices; ++i)
+			{
+				auto v = indices[i];
+				vertexTriangles[firstTriangle[v] + fill[v]++] = i / 3;
+			}
+		}
+
+		HeapBlock<Vec3> normals((size_t)numTriangles), centroids((size_t)numTriangles);
+
+		for (auto t = 0; t < numTriangles; ++t)
+		{
+			auto* corners = indices + t * 3;
+			normals[t] = getUnitNormal(positions, corners);
+			centroids[t] = (Vec3::of(positions[corners[0]]) + Vec3::of(positions[corners[1]]) + Vec3::of(positions[corners[2]])) * (1.0f / 3.0f);
+		}
+
+
+		// Which meshlet each vertex was last counted in, plus one
+		HeapBlock<juce::uint32> lastMeshlet((size_t)numVertices, true);
+		HeapBlock<Index> result((size_t)numIndices), localIndices((size_t)maxTriangles * 3);
+		HeapBlock<int> localIndexOf((size_t)numVertices);
+		Array<Index> meshletVertices;
+
+		HeapBlock<bool> placed((size_t)numTriangles, true);
+		const Adjacency adjacency = { indices, normals, centroids, firstTriangle, vertexTriangles, liveTriangles, placed };
+
+		auto numPlaced = 0, nextSeed = 0;
+
+		while (numPlaced < numTriangles)
+		{
+			while (placed[nextSeed])
+				++nextSeed;
+
+			auto stamp = (juce::uint32)meshlets.size() + 1;
+			auto start = numPlaced;
+			Vec3 normalSum, centroidSum;
+			auto spread = 0.0f;
+			meshletVertices.clearQuick();
+
+			for (auto t = nextSeed; t >= 0;)
+			{
+				auto* corners = indices + t * 3;
+
+				for (auto k = 0; k < 3; ++k)
+				{
+					auto v = corners[k];
+					result[numPlaced * 3 + k] = v;
+					--liveTriangles[v];
+
+					if (lastMeshlet[v] != stamp)
+					{
+						lastMeshlet[v] = stamp;
+						localIndexOf[v] = meshletVertices.size();
+						meshletVertices.add(v);
+					}
+				}
+
+				placed[t] = true;
+				normalSum = normalSum + normals[t];
+				centroidSum = centroidSum + centroids[t];
+
+				auto numMeshletTriangles = ++numPlaced - start;
+
+				if (numMeshletTriangles >= maxTriangles)
+					break;
+
+				auto centre = centroidSum * (1.0f / (float)numMeshletTriangles);
+				spread = jmax(spread, (centroids[t] - centre).length());
+
+				t = findNextTriangle(adjacency, meshletVertices, lastMeshlet, stamp, maxVertices, numMeshletTriangles,
+									 normalSum.normalised(), centre, spread);
+			}
+
+			// Reorder the meshlet's triangles over its own small set of vertices
+			auto* meshletIndices = result + start * 3;
+			auto numMeshletIndices = (numPlaced - start) * 3;
+
+			for (auto i = 0; i < numMeshletIndices; ++i)
+				localIndices[i] = (Index)localIndexOf[meshletIndices[i]];
+
+			MeshOptimiser::optimiseVertexCache(localIndices, numMeshletIndices, meshletVertices.size());
+
+			for (auto i = 0; i < numMeshletIndices; ++i)
+				meshletIndices[i] = meshletVertices.getUnchecked((int)localIndices[i]);
+
+			meshlets.add(createMeshlet(result.get(), start, numPlaced, (juce::uint32)meshletVertices.size(), positions));
+		}
+
+		memcpy(indices, result, sizeof(Index) * (size_t)numIndices);
+		return meshlets;
+	}
+
+private:
+	/** A meshlet isn't closed for its normals until it has this many triangles, so that a noisy
+		surface doesn't turn into a swarm of tiny meshlets.
+	*/
+	enum { minTrianglesBeforeConeSplit = 8 };
+
+	struct Vec3
+	{
+		Vec3() noexcept : x(0.0f), y(0.0f), z(0.0f) {}
+		Vec3(float xx, float yy, float zz) noexcept : x(xx), y(yy), z(zz) {}
+
+		template <typename PositionType>
+		static Vec3 of(const PositionType& p) noexcept    { return { p.x, p.y, p.z }; }
+
+		Vec3 operator+ (Vec3 other) const noexcept        { return { x + other.x, y + other.y, z + other.z }; }
+		Vec3 operator- (Vec3 other) const noexcept        { return { x - other.x, y - other.y, z - other.z }; }
+		Vec3 operator* (float scale) const noexcept       { return { x * scale, y * scale, z * scale }; }
+
+		float dot(Vec3 other) const noexcept              { return x * other.x + y * other.y + z * other.z; }
+		float length() const noexcept                     { return std::sqrt(dot(*this)); }
+
+		Vec3 cross(Vec3 other) const noexcept
+		{
+			return { y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x };
+		}
+
+		/** Returns a zero vector if this one has no length. */
+		Vec3 normalised() const noexcept
+		{
+			auto l = length();
+			return l > 0.0f ? *this * (1.0f / l) : Vec3();
+		}
+
+		void copyTo(float* dest) const noexcept           { dest[0] = x; dest[1] = y; dest[2] = z; }
+
+		float x, y, z;
+	};
+
+	/** Which triangles each vertex belongs to, and the triangles' normals and centres. */
+	struct Adjacency
+	{
+		const Index* indices;
+		const Vec3* normals;
+		const Vec3* centroids;
+		const int* firstTriangle;
+		const int* vertexTriangles;
+		const int* liveTriangles;
+		const bool* placed;
+	};
+
+	/** Returns the unplaced triangle next to the meshlet that fits it best, or -1 if the
+		meshlet should be closed. The meshlet's triangles are centred on centre, and the
+		furthest of them is about spread from it.
+	*/
+	static int findNextTriangle(const Adjacency& adjacency, const Array<Index>& meshletVertices, const juce::uint32* lastMeshlet,
+								juce::uint32 stamp, int maxVertices, int numMeshletTriangles, Vec3 axis, Vec3 centre, float spread)
+	{
+		// Each new vertex costs as much as a triangle facing 90 degrees away from the meshlet, or
+		// one four times as far out as the meshlet's furthest triangle so far
+		const auto coneWeight = 1.0f, distanceWeight = 0.25f;
+		// Past about 37 degrees, a neighbour isn't worth widening the cone for
+		const auto coneSplitDot = 0.8f;
+
+		auto best = -1;
+		auto bestScore = 0.0f, bestFacing = 0.0f;
+		auto distanceScale = spread > 0.0f ? distanceWeight / spread : 0.0f;
+
+		for (auto v : meshletVertices)
+		{
+			if (adjacency.liveTriangles[v] == 0)
+				continue;
+
+			for (auto j = adjacency.firstTriangle[v]; j < adjacency.firstTriangle[v + 1]; ++j)
+			{
+				auto t = adjacency.vertexTriangles[j];
+
+				if (adjacency.placed[t])
+					continue;
+
+				auto* corners = adjacency.indices + t * 3;
+				auto numNew = 0;
+
+				for (auto k = 0; k < 3; ++k)
+					if (lastMeshlet[corners[k]] != stamp && (k == 0 || corners[k] != corners[0]) && (k < 2 || corners[k] != corners[1]))
+						++numNew;
+
+				if (meshletVertices.size() + numNew > maxVertices)
+					continue;
+
+				auto facing = adjacency.normals[t].dot(axis);
+				auto score = (float)numNew + coneWeight * (1.0f - facing)
+							   + distanceScale * (adjacency.centroids[t] - centre).length();
+
+				if (best < 0 || score < bestScore)
+				{
+					best = t;
+					bestScore = score;
+					bestFacing = facing;
+				}
+			}
+		}
+
+		if (best >= 0 && numMeshletTriangles >= minTrianglesBeforeConeSplit && bestFacing < coneSplitDot)
+			return -1;
+
+		return best;
+	}
+
+	template <typename PositionType>
+	static Vec3 getUnitNormal(const PositionType* positions, const Index* t) noexcept
+	{
+		auto p0 = Vec3::of(positions[t[0]]);
+		return (Vec3::of(positions[t[1]]) - p0).cross(Vec3::of(positions[t[2]]) - p0).normalised();
+	}
+
+	template <typename PositionType>
+	static Meshlet createMeshlet(const Index* indices, int startTriangle, int endTriangle, juce::uint32 numVertices,
+								 const PositionType* positions)
+	{
+		Meshlet m;
+		m.firstIndex = (juce::uint32)startTriangle * 3;
+		m.numIndices = (juce::uint32)(endTriangle - startTriangle) * 3;
+		m.numVertices = numVertices;
+
+		auto* first = indices + m.firstIndex;
+		auto* last = first + m.numIndices;
+
+		// The box, and a sphere around its middle
+		auto low = Vec3::of(positions[*first]), high = low;
+
+		for (auto* i = first; i != last; ++i)
+		{
+			auto p = Vec3::of(positions[*i]);
+			low = { jmin(low.x, p.x), jmin(low.y, p.y), jmin(low.z, p.z) };
+			high = { jmax(high.x, p.x), jmax(high.y, p.y), jmax(high.z, p.z) };
+		}
+
+		auto centre = (low + high) * 0.5f;
+		auto radius = 0.0f;
+
+		for (auto* i = first; i != last; ++i)
+			radius = jmax(radius, (Vec3::of(positions[*i]) - centre).length());
+
+		low.copyTo(m.boundsMin);
+		high.copyTo(m.boundsMax);
+		centre.copyTo(m.centre);
+		m.radius = radius;
+
+		// The cone's axis is the average of the triangles' normals, and its cutoff comes from
+		// the triangle that strays furthest from it. Degenerate triangles face nowhere, so they
+		// don't count.
+		Vec3 axis;
+
+		for (auto* t = first; t != last; t += 3)
+			axis = axis + getUnitNormal(positions, t);
+
+		axis = axis.normalised();
+
+		auto minDot = 1.0f;
+
+		for (auto* t = first; t != last; t += 3)
+		{
+			auto normal = getUnitNormal(positions, t);
+
+			if (normal.dot(normal) > 0.0f)
+				minDot = jmin(minDot, normal.dot(axis));
+		}
+
+		axis.copyTo(m.coneAxis);
+		centre.copyTo(m.coneApex);
+		m.coneCutoff = 1.0f;
+
+		// Past about 84 degrees either side, the cone would hardly ever cull anything
+		if (axis.dot(axis) == 0.0f || minDot <= 0.1f)
+			return m;
+
+		// Move the apex back along the axis until it's behind every triangle's plane, so that
+		// the test holds for the whole meshlet and not just for its centre
+		auto maxT = 0.0f;
+
+		for (auto* t = first; t != last; t += 3)
+		{
+			auto normal = getUnitNormal(positions, t);
+			auto facing = normal.dot(axis);
+
+			if (facing > 0.0f)
+				maxT = jmax(maxT, (centre - Vec3::of(positions[t[0]])).dot(normal) / facing);
+		}
+
+		(centre - axis * maxT).copyTo(m.coneApex);
+		m.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		return m;
+	}
+};
+
+
+#endif  // MESHLETBUILDER_H_INCLUDED
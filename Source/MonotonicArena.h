@@ -0,0 +1,187 @@
+/*
+==============================================================================
+
+MonotonicArena.h
+Created: 16 October 2026 6:20pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define a simple region allocator for short-lived parser data.
+*/
+
+#ifndef MONOTONICARENA_H_INCLUDED
+#define MONOTONICARENA_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <type_traits>
+
+
+
+//==============================================================================
+/**
+*  Hands out memory by bumping a pointer through large blocks, and never frees anything
+*  until the whole arena is destroyed, at which point every block goes back to the heap in
+*  one go. Requests bigger than a block get a block of their own.
+*
+*  Allocation takes a SpinLock, so several threads can share an arena; since each thread
+*  normally only allocates when one of its arrays needs to grow, the lock is almost never
+*  contended.
+*/
+class MonotonicArena
+{
+public:
+	explicit MonotonicArena(size_t blockSizeToUse = 1024 * 1024)
+		: blockSize(blockSizeToUse), current(nullptr), remaining(0)
+	{
+		zerostruct(statistics);
+	}
+
+	/** Counts of what the arena has been asked for, and what it had to get from the heap. */
+	struct Statistics
+	{
+		int64 numAllocations;       // requests served by the arena
+		int64 numBytesAllocated;    // bytes requested, including alignment padding
+		int64 numBlocks;            // allocations made on the heap
+		int64 numBytesReserved;     // total size of those heap blocks
+	};
+
+	void* allocate(size_t numBytes, size_t alignment)
+	{
+		jassert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+		const SpinLock::ScopedLockType sl(lock);
+
+		auto padding = (size_t)(-(pointer_sized_int)current) & (alignment - 1);
+
+		if (current == nullptr || padding + numBytes > remaining)
+		{
+			auto size = jmax(blockSize, numBytes + alignment);
+			auto* block = blocks.add(new HeapBlock<char>(size));
+
+			current = block->get();
+			remaining = size;
+			padding = (size_t)(-(pointer_sized_int)current) & (alignment - 1);
+
+			++statistics.numBlocks;
+			statistics.numBytesReserved += (int64)size;
+		}
+
+		auto* result = current + padding;
+		current += padding + numBytes;
+		remaining -= padding + numBytes;
+
+		++statistics.numAllocations;
+		statistics.numBytesAllocated += (int64)(padding + numBytes);
+		return result;
+	}
+
+	template <typename ElementType>
+	ElementType* allocateArray(size_t numElements)
+	{
+		static_assert(std::is_trivially_destructible<ElementType>::value,
+					  "The arena never runs destructors, so it can only hold trivial types");
+
+		return static_cast<ElementType*> (allocate(numElements * sizeof(ElementType), alignof(ElementType)));
+	}
+
+	/** Constructs an object in the arena. Its destructor will never be called. */
+	template <typename ObjectType, typename... Args>
+	ObjectType* create(Args&&... args)
+	{
+		return new (allocateArray<ObjectType>(1)) ObjectType(std::forward<Args>(args)...);
+	}
+
+	/** Copies a range of bytes into the arena, followed by a null terminator. */
+	const char* copyString(const char* start, const char* end)
+	{
+		auto length = (size_t)(end - start);
+		auto* copy = allocateArray<char>(length + 1);
+		memcpy(copy, start, length);
+		copy[length] = 0;
+		return copy;
+	}
+
+	Statistics getStatistics() const noexcept
+	{
+		const SpinLock::ScopedLockType sl(lock);
+		return statistics;
+	}
+
+private:
+	const size_t blockSize;
+	OwnedArray<HeapBlock<char>> blocks;
+	char* current;
+	size_t remaining;
+	Statistics statistics;
+	mutable SpinLock lock;
+
+	JUCE_DECLARE_NON_COPYABLE(MonotonicArena)
+};
+
+//==============================================================================
+/**
+*  A growable array of trivially copyable elements whose storage comes from a MonotonicArena.
+*  When it outgrows its space it moves to a new, larger allocation, and the old one is just
+*  left in the arena, so it's best to size it with ensureStorageAllocated() first.
+*/
+template <typename ElementType>
+class ArenaArray
+{
+public:
+	explicit ArenaArray(MonotonicArena& arenaToUse) noexcept
+		: arena(arenaToUse), elements(nullptr), numUsed(0), numAllocated(0)
+	{
+		static_assert(std::is_trivially_copyable<ElementType>::value,
+					  "ArenaArray moves its elements with memcpy");
+	}
+
+	int size() const noexcept                                   { return numUsed; }
+	ElementType* begin() const noexcept                         { return elements; }
+	ElementType* end() const noexcept                           { return elements + numUsed; }
+
+	ElementType& getReference(int index) const noexcept
+	{
+		jassert(isPositiveAndBelow(index, numUsed));
+		return elements[index];
+	}
+
+	ElementType getUnchecked(int index) const noexcept          { return getReference(index); }
+	ElementType getLast() const noexcept                        { return getReference(numUsed - 1); }
+
+	void add(const ElementType& newElement)
+	{
+		if (numUsed == numAllocated)
+			ensureStorageAllocated(jmax(8, numAllocated + numAllocated / 2));
+
+		elements[numUsed++] = newElement;
+	}
+
+	void ensureStorageAllocated(int minNumElements)
+	{
+		if (minNumElements > numAllocated)
+		{
+			auto* newElements = arena.allocateArray<ElementType>((size_t)minNumElements);
+
+			if (numUsed > 0)
+				memcpy(newElements, elements, (size_t)numUsed * sizeof(ElementType));
+
+			elements = newElements;
+			numAllocated = minNumElements;
+		}
+	}
+
+private:
+	MonotonicArena& arena;
+	ElementType* elements;
+	int numUsed, numAllocated;
+
+	JUCE_DECLARE_NON_COPYABLE(ArenaArray)
+};
+
+
+#endif  // MONOTONICARENA_H_INCLUDED
@@ -0,0 +1,367 @@
+/*
+==============================================================================
+
+NormalGenerator.h
+Created: 17 October 2026 4:40pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define how the loader gives vertex normals to shapes whose file has no
+*  vn records of its own.
+*/
+
+#ifndef NORMALGENERATOR_H_INCLUDED
+#define NORMALGENERATOR_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ParallelFor.h"
+#include <cmath>
+
+
+
+//==============================================================================
+/**
+*  Works out a normal for every corner of an indexed triangle list, from the triangles that
+*  share its vertex, and splits the vertices wherever their corners end up with different
+*  normals.
+*
+*  Each triangle belongs to a smoothing group, as set by an OBJ file's s records. A corner's
+*  normal is the weighted sum of the face normals of the triangles around its vertex that are
+*  in the same group and, if there's a crease angle, whose face normal is within that angle of
+*  the corner's own triangle's. Triangles in flatGroup ("s off") aren't smoothed at all. The
+*  weight is either the triangle's corner angle at the vertex, which doesn't depend on how
+*  finely the surface around it was cut up, or the triangle's area.
+*
+*  The work is split into blocks of triangles and blocks of vertices, which are shared out
+*  over the threads. Nothing is ever scattered into a vertex from two triangles at once: each
+*  vertex gathers from a list of its own corners instead, so no atomics or locks are needed.
+*/
+struct NormalGenerator
+{
+	typedef juce::uint32 Index;
+
+	/** The smoothing group whose triangles each keep their own flat normal. */
+	enum { flatGroup = 0 };
+
+	/** Below this many triangles, a mesh isn't worth splitting over several threads. */
+	enum { minTrianglesPerThread = 65536 };
+
+	enum Weighting
+	{
+		weightByAngle,
+		weightByArea
+	};
+
+	struct Options
+	{
+		Options() noexcept : creaseAngle(180.0f), weighting(weightByAngle), numThreads(1) {}
+
+		/** In degrees. Neighbouring triangles that meet at a sharper angle than this get a hard
+			edge even when they're in the same smoothing group; 180 turns the crease test off.
+		*/
+		float creaseAngle;
+
+		Weighting weighting;
+		int numThreads;
+	};
+
+	/** Fills in the normals of a mesh that has indices, vertices and optionally texture
+		coordinates, duplicating vertices (and their texture coordinates) where needed, and
+		renumbering the indices to match. triangleGroups holds a smoothing group for each
+		triangle, or may be null to smooth all of them together.
+
+		Returns false and leaves the mesh alone if it already has normals, if its indices aren't
+		whole triangles that all refer to existing vertices, or if its texture coordinates don't
+		match its vertices. This has to run before anything that refers to the vertices by index,
+		such as levels of detail or meshlets, is built.
+	*/
+	template <typename MeshType>
+	static bool generate(MeshType& mesh, const juce::uint32* triangleGroups, const Options& options)
+	{
+		auto numIndices = mesh.indices.size();
+		auto numVertices = mesh.vertices.size();
+		auto numTriangles = numIndices / 3;
+
+		if (numIndices % 3 != 0 || mesh.normals.size() > 0
+			 || (mesh.textureCoords.size() > 0 && mesh.textureCoords.size() != numVertices))
+			return false;
+
+		auto* indices = mesh.indices.begin();
+
+		// Sort the corners by vertex, which also checks that every index is in range. Filling the
+		// list from the back leaves each vertex's corners in their original order.
+		HeapBlock<int> firstCorner((size_t)numVertices + 1, true);
+
+		for (auto i = 0; i < numIndices; ++i)
+		{
+			if (indices[i] >= (Index)numVertices)
+				return false;
+
+			++firstCorner[indices[i]];
+		}
+
+		for (auto v = 1; v <= numVertices; ++v)
+			firstCorner[v] += firstCorner[v - 1];
+
+		HeapBlock<int> vertexCorners((size_t)jmax(1, numIndices));
+
+		for (auto i = numIndices; --i >= 0;)
+			vertexCorners[--firstCorner[indices[i]]] = i;
+
+		// Each triangle's unit normal, and the weight of each of its corners
+		HeapBlock<Vec3> faceNormals((size_t)jmax(1, numTriangles));
+		HeapBlock<float> cornerWeights((size_t)jmax(1, numIndices));
+		auto* positions = mesh.vertices.begin();
+		auto byArea = options.weighting == weightByArea;
+
+		forEachBlock(numTriangles, options.numThreads, [&] (int start, int end)
+		{
+			for (auto t = start; t < end; ++t)
+			{
+				auto* triangle = indices + t * 3;
+				const Vec3 p[] = { Vec3::of(positions[triangle[0]]), Vec3::of(positions[triangle[1]]), Vec3::of(positions[triangle[2]]) };
+				const Vec3 edges[] = { p[1] - p[0], p[2] - p[1], p[0] - p[2] };
+
+				auto normal = edges[0].cross(p[2] - p[0]);
+				auto doubleArea = normal.length();
+				faceNormals[t] = doubleArea > 0.0f ? normal * (1.0f / doubleArea) : Vec3();
+
+				if (byArea)
+				{
+					for (auto k = 0; k < 3; ++k)
+						cornerWeights[t * 3 + k] = doubleArea;
+				}
+				else
+				{
+					float inverseLengths[3];
+
+					for (auto k = 0; k < 3; ++k)
+					{
+						auto length = edges[k].length();
+						inverseLengths[k] = length > 0.0f ? 1.0f / length : 0.0f;
+					}
+
+					// The corner at p[k] lies between the edge leaving it and the one arriving at it
+					for (auto k = 0; k < 3; ++k)
+					{
+						auto prev = (k + 2) % 3;
+						cornerWeights[t * 3 + k] = approximateAcos(-edges[k].dot(edges[prev]) * inverseLengths[k] * inverseLengths[prev]);
+					}
+				}
+			}
+		});
+
+		// Each vertex gathers the normals of its own corners. Corners of a vertex that come out
+		// with exactly the same normal share a slot, and each slot becomes a vertex. The normals
+		// are kept in the same order as vertexCorners.
+		HeapBlock<Vec3> cornerNormals((size_t)jmax(1, numIndices));
+		HeapBlock<Index> cornerSlots((size_t)jmax(1, numIndices));
+		HeapBlock<Index> firstSlot((size_t)numVertices + 1);
+
+		auto hasCrease = options.creaseAngle < 180.0f;
+		auto minCreaseDot = std::cos(degreesToRadians(jlimit(0.0f, 180.0f, options.creaseAngle)));
+
+		auto getGroup = [triangleGroups] (int corner) noexcept
+		{
+			return triangleGroups != nullptr ? triangleGroups[corner / 3] : (juce::uint32)1;
+		};
+
+		forEachBlock(numVertices, options.numThreads, [&] (int start, int end)
+		{
+			for (auto v = start; v < end; ++v)
+			{
+				auto first = firstCorner[v];
+				auto* corners = vertexCorners + first;
+				auto* normals = cornerNormals + first;
+				auto numCorners = firstCorner[v + 1] - first;
+				Index numSlots = 0;
+
+				for (auto i = 0; i < numCorners; ++i)
+				{
+					auto corner = corners[i];
+					auto group = getGroup(corner);
+					auto reused = -1;
+
+					// Without a crease test, every corner in a group gets the same normal
+					if (!hasCrease && group != (juce::uint32)flatGroup)
+					{
+						for (auto j = 0; j < i && reused < 0; ++j)
+							if (getGroup(corners[j]) == group)
+								reused = j;
+					}
+
+					if (reused >= 0)
+					{
+						normals[i] = normals[reused];
+						cornerSlots[corner] = cornerSlots[corners[reused]];
+						continue;
+					}
+
+					auto& faceNormal = faceNormals[corner / 3];
+					Vec3 sum;
+
+					if (group == (juce::uint32)flatGroup)
+					{
+						sum = faceNormal;
+					}
+					else
+					{
+						for (auto j = 0; j < numCorners; ++j)
+						{
+							auto other = corners[j];
+							auto& otherNormal = faceNormals[other / 3];
+
+							if (getGroup(other) == group && (!hasCrease || faceNormal.dot(otherNormal) >= minCreaseDot))
+								sum = sum + otherNormal * cornerWeights[other];
+						}
+					}
+
+					auto normal = sum.normalised();
+
+					// A corner of a degenerate triangle has nothing to go on
+					if (normal.dot(normal) == 0.0f)
+						normal = Vec3(0.0f, 0.0f, 1.0f);
+
+					normals[i] = normal;
+
+					auto slot = numSlots;
+
+					for (auto j = 0; j < i; ++j)
+					{
+						if (normals[j] == normal)
+						{
+							slot = cornerSlots[corners[j]];
+							break;
+						}
+					}
+
+					if (slot == numSlots)
+						++numSlots;
+
+					cornerSlots[corner] = slot;
+				}
+
+				firstSlot[v] = numSlots;
+			}
+		});
+
+		Index numNewVertices = 0;
+
+		for (auto v = 0; v < numVertices; ++v)
+		{
+			auto numSlots = firstSlot[v];
+			firstSlot[v] = numNewVertices;
+			numNewVertices += numSlots;
+		}
+
+		// Write each vertex's slots out next to each other, and then point the corners at them
+		auto newVertices = createArrayLike(mesh.vertices, (int)numNewVertices);
+		auto newNormals = createArrayLike(mesh.normals, (int)numNewVertices);
+		auto newTextureCoords = createArrayLike(mesh.textureCoords, mesh.textureCoords.size() > 0 ? (int)numNewVertices : 0);
+		auto hasTextureCoords = newTextureCoords.size() > 0;
+
+		forEachBlock(numVertices, options.numThreads, [&] (int start, int end)
+		{
+			for (auto v = start; v < end; ++v)
+			{
+				for (auto i = firstCorner[v]; i < firstCorner[v + 1]; ++i)
+				{
+					auto newIndex = (int)(firstSlot[v] + cornerSlots[vertexCorners[i]]);
+					auto& normal = newNormals.getReference(newIndex);
+
+					newVertices.getReference(newIndex) = mesh.vertices.getReference(v);
+					normal.x = cornerNormals[i].x;
+					normal.y = cornerNormals[i].y;
+					normal.z = cornerNormals[i].z;
+
+					if (hasTextureCoords)
+						newTextureCoords.getReference(newIndex) = mesh.textureCoords.getReference(v);
+				}
+			}
+		});
+
+		forEachBlock(numIndices, options.numThreads, [&] (int start, int end)
+		{
+			for (auto i = start; i < end; ++i)
+				indices[i] = firstSlot[indices[i]] + cornerSlots[i];
+		});
+
+		mesh.vertices.swapWith(newVertices);
+		mesh.normals.swapWith(newNormals);
+		mesh.textureCoords.swapWith(newTextureCoords);
+		return true;
+	}
+
+private:
+	//==============================================================================
+	enum { blockSize = 16384 };
+
+	struct Vec3
+	{
+		Vec3() noexcept : x(0.0f), y(0.0f), z(0.0f) {}
+		Vec3(float xx, float yy, float zz) noexcept : x(xx), y(yy), z(zz) {}
+
+		template <typename PositionType>
+		static Vec3 of(const PositionType& p) noexcept    { return { p.x, p.y, p.z }; }
+
+		Vec3 operator+ (Vec3 other) const noexcept        { return { x + other.x, y + other.y, z + other.z }; }
+		Vec3 operator- (Vec3 other) const noexcept        { return { x - other.x, y - other.y, z - other.z }; }
+		Vec3 operator* (float scale) const noexcept       { return { x * scale, y * scale, z * scale }; }
+		bool operator== (Vec3 other) const noexcept       { return x == other.x && y == other.y && z == other.z; }
+
+		float dot(Vec3 other) const noexcept              { return x * other.x + y * other.y + z * other.z; }
+		float length() const noexcept                     { return std::sqrt(dot(*this)); }
+
+		Vec3 cross(Vec3 other) const noexcept
+		{
+			return { y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x };
+		}
+
+		/** Returns a zero vector if this one has no length. */
+		Vec3 normalised() const noexcept
+		{
+			auto l = length();
+			return l > 0.0f ? *this * (1.0f / l) : Vec3();
+		}
+
+		float x, y, z;
+	};
+
+	/** Abramowitz and Stegun's 4.4.45, which is within 0.0001 radians of std::acos() - plenty for
+		a weight, and much quicker.
+	*/
+	static float approximateAcos(float x) noexcept
+	{
+		auto a = std::abs(jlimit(-1.0f, 1.0f, x));
+		auto r = std::sqrt(1.0f - a) * (1.5707288f + a * (-0.2121144f + a * (0.0742610f - 0.0187293f * a)));
+		return x < 0.0f ? float_Pi - r : r;
+	}
+
+	/** Calls function (start, end) for consecutive ranges of [0, numItems), on up to numThreads threads. */
+	template <typename Function>
+	static void forEachBlock(int numItems, int numThreads, const Function& function)
+	{
+		auto numBlocks = (numItems + (int)blockSize - 1) / (int)blockSize;
+
+		parallelFor(numBlocks, numThreads, [&] (int block)
+		{
+			function(block * (int)blockSize, jmin(numItems, (block + 1) * (int)blockSize));
+		});
+	}
+
+	template <typename ElementType>
+	static Array<ElementType> createArrayLike(const Array<ElementType>&, int size)
+	{
+		Array<ElementType> array;
+		array.insertMultiple(0, ElementType(), size);
+		return array;
+	}
+};
+
+
+#endif  // NORMALGENERATOR_H_INCLUDED
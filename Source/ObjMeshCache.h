@@ -0,0 +1,432 @@
+/*
+==============================================================================
+
+ObjMeshCache.h
+Created: 16 October 2026 4:05pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define the binary cache file format that the WavefrontObjFile loader
+*  uses to skip parsing files it has already seen.
+*/
+
+#ifndef OBJMESHCACHE_H_INCLUDED
+#define OBJMESHCACHE_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+
+//==============================================================================
+/**
+*  A cache file holds the de-duplicated shapes of one .obj file, laid out so that it can be
+*  memory-mapped and read without any parsing: a fixed Header, followed by 16-byte aligned
+*  blocks of strings, element arrays and record tables. Records refer to blocks by their
+*  offset from the start of the file, and the Reader turns those offsets back into pointers
+*  into the mapped file, so the vertex and index arrays can be handed straight to the GPU.
+*
+*  Each cache file remembers the full path, size and modification time of the .obj file and of
+*  every .mtl library it read, along with the parser version that produced it and the load
+*  options that changed its shapes. If any of those don't match, the Reader refuses it and the
+*  file gets parsed again.
+*
+*  The data is written in the machine's own byte order, and a cache written on a machine with a
+*  different byte order is simply treated as out of date.
+*/
+struct ObjMeshCache
+{
+	enum
+	{
+		formatVersion = 5,
+		byteOrderMark = 0x01020304,
+		blockAlignment = 16
+	};
+
+	struct StringRecord     { juce::uint64 offset; juce::uint32 numBytes, reserved; };
+	struct ArrayRecord      { juce::uint64 offset; juce::uint32 numElements, elementSize; };
+
+	struct Header
+	{
+		char magic[8];
+		juce::uint32 formatVersion, parserVersion, byteOrderMark;
+		juce::uint32 loadFlags;   // the load options that changed the shapes, as the loader defines them
+		juce::int64 sourceSize, sourceModificationTime;
+		StringRecord sourcePath;
+		ArrayRecord dependencies, shapes;
+		juce::uint64 totalSize;
+	};
+
+	struct DependencyRecord
+	{
+		StringRecord path;
+		juce::int64 size, modificationTime;
+	};
+
+	struct Float3 { float x, y, z; };
+
+	struct MaterialRecord
+	{
+		StringRecord name;
+		Float3 ambient, diffuse, specular, transmittance, emission;
+		float shininess, refractiveIndex;
+		StringRecord ambientTextureName, diffuseTextureName, specularTextureName, normalTextureName;
+		ArrayRecord parameters;   // pairs of StringRecords: key, value
+	};
+
+	/** One level of detail: a range of its shape's levelIndices array. */
+	struct LevelRecord
+	{
+		juce::uint32 firstIndex, numIndices;
+		float error;
+		juce::uint32 reserved;
+	};
+
+	/** One meshlet: a range of its shape's indices, with the bounds it's culled by. */
+	struct MeshletRecord
+	{
+		juce::uint32 firstIndex, numIndices, numVertices, reserved;
+		Float3 centre;
+		float radius;
+		Float3 boundsMin, boundsMax, coneApex, coneAxis;
+		float coneCutoff;
+	};
+
+	struct ShapeRecord
+	{
+		StringRecord name;
+		ArrayRecord vertices, normals, textureCoords, indices;
+		ArrayRecord levelIndices, levels;
+		ArrayRecord meshlets;
+		ArrayRecord encodedMesh;   // bytes: if this isn't empty, it holds the MeshCodec encoding of
+								   // the arrays above, which are then all empty
+		MaterialRecord material;
+	};
+
+	//==============================================================================
+	/** The details of a file that a cache depends on. A file that doesn't exist has a size of -1. */
+	struct SourceInfo
+	{
+		String path;
+		int64 size, modificationTime;
+
+		static SourceInfo of(const File& file)
+		{
+			auto exists = file.existsAsFile();
+			return { file.getFullPathName(),
+					 exists ? file.getSize() : -1,
+					 exists ? file.getLastModificationTime().toMilliseconds() : 0 };
+		}
+
+		bool operator== (const SourceInfo& other) const noexcept
+		{
+			return size == other.size && modificationTime == other.modificationTime && path == other.path;
+		}
+	};
+
+	/** Returns where the cache for a source file lives. If cacheDirectory is File(), it goes next
+		to the source file. The name includes a hash of the full path, so files with the same
+		name in different folders can share a cache directory.
+	*/
+	static File getCacheFileFor(const File& sourceFile, const File& cacheDirectory)
+	{
+		auto directory = cacheDirectory == File() ? sourceFile.getParentDirectory() : cacheDirectory;
+
+		return directory.getChildFile(sourceFile.getFileName() + "."
+									  + String::toHexString(sourceFile.getFullPathName().hashCode64())
+									  + ".meshcache");
+	}
+
+	//==============================================================================
+	/**
+	*  Lays out a cache file. Arrays are added by pointer and only copied when writeTo() is
+	*  called, so they must stay alive until then; strings are copied straight away.
+	*/
+	class Writer
+	{
+	public:
+		Writer() : nextOffset(roundUp(sizeof(Header))) {}
+
+		ArrayRecord addArray(const void* data, int numElements, size_t elementSize)
+		{
+			auto numBytes = (size_t)numElements * elementSize;
+			ArrayRecord record = { addBlock(data, numBytes), (juce::uint32)numElements, (juce::uint32)elementSize };
+			return record;
+		}
+
+		template <typename ElementType>
+		ArrayRecord addArray(const Array<ElementType>& array)
+		{
+			return addArray(array.begin(), array.size(), sizeof(ElementType));
+		}
+
+		StringRecord addString(const String& s)
+		{
+			auto numBytes = s.getNumBytesAsUTF8();
+			auto* copy = strings.add(new MemoryBlock(s.toRawUTF8(), numBytes + 1));
+
+			StringRecord record = { addBlock(copy->getData(), numBytes + 1), (juce::uint32)numBytes, 0 };
+			return record;
+		}
+
+		/** Writes the header and every block that was added. The file is written to a temporary
+			file first and then moved into place, so a reader never sees half of one.
+		*/
+		Result writeTo(const File& cacheFile, Header header)
+		{
+			memcpy(header.magic, "OBJCACHE", sizeof(header.magic));
+			header.formatVersion = formatVersion;
+			header.byteOrderMark = byteOrderMark;
+			header.totalSize = nextOffset;
+
+			auto directoryCreated = cacheFile.getParentDirectory().createDirectory();
+
+			if (directoryCreated.failed())
+				return directoryCreated;
+
+			TemporaryFile temp(cacheFile);
+
+			{
+				FileOutputStream out(temp.getFile());
+
+				if (out.failedToOpen())
+					return out.getStatus();
+
+				auto ok = out.write(&header, sizeof(header));
+
+				for (auto& block : blocks)
+				{
+					ok = ok && writePadding(out, block.offset)
+							&& out.write(block.data, block.numBytes);
+				}
+
+				ok = ok && writePadding(out, nextOffset);
+				out.flush();
+
+				if (!ok || out.getStatus().failed())
+					return Result::fail("Cannot write file: " + temp.getFile().getFullPathName());
+			}
+
+			if (!temp.overwriteTargetFileWithTemporary())
+				return Result::fail("Cannot write file: " + cacheFile.getFullPathName());
+
+			return Result::ok();
+		}
+
+	private:
+		struct Block
+		{
+			const void* data;
+			size_t numBytes;
+			juce::uint64 offset;
+		};
+
+		Array<Block> blocks;
+		OwnedArray<MemoryBlock> strings;
+		juce::uint64 nextOffset;
+
+		static juce::uint64 roundUp(juce::uint64 n) noexcept
+		{
+			return (n + blockAlignment - 1) & ~(juce::uint64)(blockAlignment - 1);
+		}
+
+		juce::uint64 addBlock(const void* data, size_t numBytes)
+		{
+			auto offset = nextOffset;
+
+			if (numBytes > 0)
+			{
+				blocks.add({ data, numBytes, offset });
+				nextOffset = roundUp(offset + numBytes);
+			}
+
+			return offset;
+		}
+
+		static bool writePadding(OutputStream& out, juce::uint64 position)
+		{
+			auto padding = (int)(position - (juce::uint64)out.getPosition());
+			jassert(padding >= 0 && padding < blockAlignment);
+
+			return padding == 0 || out.writeRepeatedByte(0, (size_t)padding);
+		}
+
+		JUCE_DECLARE_NON_COPYABLE(Writer)
+	};
+
+	//==============================================================================
+	/**
+	*  Maps a cache file into memory and checks that it's complete, intact, and still matches
+	*  its source files. Once open() has succeeded, every record in the file has been bounds
+	*  checked, and the arrays it returns point straight into the mapped file, so they stay
+	*  valid for as long as the Reader does.
+	*/
+	class Reader
+	{
+	public:
+		Reader() : data(nullptr), numBytes(0), header(nullptr) {}
+
+		/** Returns true if the cache file is valid and was made from this source file by this
+			version of the parser, with the same load flags.
+		*/
+		bool open(const File& cacheFile, const SourceInfo& source, int parserVersion, juce::uint32 loadFlags)
+		{
+			close();
+
+			if (!cacheFile.existsAsFile())
+				return false;
+
+			mappedFile.reset(new MemoryMappedFile(cacheFile, MemoryMappedFile::readOnly));
+			data = static_cast<const char*> (mappedFile->getData());
+			numBytes = mappedFile->getSize();
+
+			if (data != nullptr && numBytes >= sizeof(Header))
+			{
+				header = reinterpret_cast<const Header*> (data);
+
+				if (isValid(source, parserVersion, loadFlags))
+					return true;
+			}
+
+			close();
+			return false;
+		}
+
+		void close()
+		{
+			mappedFile.reset();
+			data = nullptr;
+			numBytes = 0;
+			header = nullptr;
+		}
+
+		int getNumShapes() const noexcept                          { return header != nullptr ? (int)header->shapes.numElements : 0; }
+		const ShapeRecord& getShape(int index) const noexcept      { return getArray<ShapeRecord>(header->shapes)[index]; }
+
+		int getNumDependencies() const noexcept                    { return header != nullptr ? (int)header->dependencies.numElements : 0; }
+
+		SourceInfo getDependency(int index) const
+		{
+			auto& d = getArray<DependencyRecord>(header->dependencies)[index];
+			return { getString(d.path), d.size, d.modificationTime };
+		}
+
+		/** Returns a pointer into the mapped file for an array record. */
+		template <typename ElementType>
+		const ElementType* getArray(const ArrayRecord& record) const noexcept
+		{
+			jassert(record.elementSize == sizeof(ElementType));
+			return reinterpret_cast<const ElementType*> (data + record.offset);
+		}
+
+		String getString(const StringRecord& record) const
+		{
+			return String::fromUTF8(data + record.offset, (int)record.numBytes);
+		}
+
+	private:
+		std::unique_ptr<MemoryMappedFile> mappedFile;
+		const char* data;
+		size_t numBytes;
+		const Header* header;
+
+		bool isValid(const SourceInfo& source, int parserVersion, juce::uint32 loadFlags) const
+		{
+			auto& h = *header;
+
+			if (memcmp(h.magic, "OBJCACHE", sizeof(h.magic)) != 0
+				 || h.formatVersion != formatVersion
+				 || h.byteOrderMark != byteOrderMark
+				 || h.parserVersion != (juce::uint32)parserVersion
+				 || h.loadFlags != loadFlags
+				 || h.totalSize != numBytes)
+				return false;
+
+			if (!(isValid(h.sourcePath) && isValid<DependencyRecord>(h.dependencies) && isValid<ShapeRecord>(h.shapes)))
+				return false;
+
+			if (!(SourceInfo{ getString(h.sourcePath), h.sourceSize, h.sourceModificationTime } == source))
+				return false;
+
+			auto* dependencies = getArray<DependencyRecord>(h.dependencies);
+
+			for (juce::uint32 i = 0; i < h.dependencies.numElements; ++i)
+			{
+				auto& d = dependencies[i];
+
+				if (!(isValid(d.path) && SourceInfo::of(File(getString(d.path))) == SourceInfo{ getString(d.path), d.size, d.modificationTime }))
+					return false;
+			}
+
+			auto* shapes = getArray<ShapeRecord>(h.shapes);
+
+			for (juce::uint32 i = 0; i < h.shapes.numElements; ++i)
+			{
+				auto& s = shapes[i];
+				auto& m = s.material;
+
+				if (!(isValid(s.name) && isValid(m.name)
+					   && isValid(s.vertices, sizeof(Float3)) && isValid(s.normals, sizeof(Float3))
+					   && isValid(s.textureCoords, sizeof(float) * 2) && isValid(s.indices, sizeof(juce::uint32))
+					   && isValid(s.levelIndices, sizeof(juce::uint32)) && isValid<LevelRecord>(s.levels)
+					   && isValid<MeshletRecord>(s.meshlets) && isValid(s.encodedMesh, 1)
+					   && isValid(m.ambientTextureName) && isValid(m.diffuseTextureName)
+					   && isValid(m.specularTextureName) && isValid(m.normalTextureName)
+					   && isValid<StringRecord>(m.parameters)))
+					return false;
+
+				auto* levels = getArray<LevelRecord>(s.levels);
+
+				for (juce::uint32 l = 0; l < s.levels.numElements; ++l)
+					if ((juce::uint64)levels[l].firstIndex + levels[l].numIndices > s.levelIndices.numElements)
+						return false;
+
+				auto* meshlets = getArray<MeshletRecord>(s.meshlets);
+
+				for (juce::uint32 c = 0; c < s.meshlets.numElements; ++c)
+					if ((juce::uint64)meshlets[c].firstIndex + meshlets[c].numIndices > s.indices.numElements)
+						return false;
+
+				auto* parameters = getArray<StringRecord>(m.parameters);
+
+				for (juce::uint32 p = 0; p < m.parameters.numElements; ++p)
+					if (!isValid(parameters[p]))
+						return false;
+			}
+
+			return true;
+		}
+
+		bool isValidRange(juce::uint64 offset, juce::uint64 size) const noexcept
+		{
+			return offset % blockAlignment == 0 && offset <= numBytes && size <= numBytes - offset;
+		}
+
+		bool isValid(const StringRecord& record) const noexcept
+		{
+			return isValidRange(record.offset, (juce::uint64)record.numBytes + 1)
+					&& data[record.offset + record.numBytes] == 0;
+		}
+
+		bool isValid(const ArrayRecord& record, size_t elementSize) const noexcept
+		{
+			return record.elementSize == elementSize
+					&& isValidRange(record.offset, (juce::uint64)record.numElements * elementSize);
+		}
+
+		template <typename ElementType>
+		bool isValid(const ArrayRecord& record) const noexcept
+		{
+			return isValid(record, sizeof(ElementType));
+		}
+
+		JUCE_DECLARE_NON_COPYABLE(Reader)
+	};
+};
+
+
+#endif  // OBJMESHCACHE_H_INCLUDED
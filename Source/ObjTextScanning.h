@@ -0,0 +1,341 @@
+/*
+==============================================================================
+
+ObjTextScanning.h
+Created: 16 October 2026 2:40pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define the low-level number and separator scanners used by the
+*  WavefrontObjFile parser.
+*/
+
+#ifndef OBJTEXTSCANNING_H_INCLUDED
+#define OBJTEXTSCANNING_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <cmath>
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#elif JUCE_ARM && defined (__ARM_NEON)
+ #include <arm_neon.h>
+#endif
+
+#if JUCE_MSVC
+ #include <intrin.h>
+#endif
+
+
+
+//==============================================================================
+/**
+*  Scanners for the tokens in .obj and .mtl lines. Each one works on a [t, end) range of
+*  UTF-8 bytes and never reads past end, except where noted.
+*
+*  readFloat() stands in for casting CharacterFunctions::readDoubleValue() to a float, which is
+*  what the parser used to call. The common short, plain decimal numbers are read with one
+*  exact division, which gives the correctly rounded double (the one strtod() gives), and
+*  everything else (exponents, very long mantissas, nan/inf, and so on) goes to the original.
+*  JUCE 5.2.1's readDoubleValue() isn't always correctly rounded, so the two doubles can differ
+*  in their last bit; the floats made from them only differ if a number sits right on the
+*  boundary between two floats. ObjTextScanningTests checks that the floats are the same for
+*  every number in the bundled models.
+*
+*  The separator scanners look at 16 bytes at a time with SSE2 or NEON when there are that many
+*  left in the line, and fall back to a simple loop for the tail.
+*/
+struct ObjTextScanning
+{
+	static bool isWhitespace(char c) noexcept
+	{
+		return c == ' ' || (c <= 13 && c >= 9);
+	}
+
+	static bool isDigit(char c) noexcept
+	{
+		return (unsigned char)(c - '0') < 10;
+	}
+
+	/** Returns the first character in the range that isn't a space, tab, or other control
+		whitespace.
+	*/
+	static const char* skipWhitespace(const char* t, const char* end) noexcept
+	{
+		if (t < end && !isWhitespace(*t))
+			return t;
+
+	   #if JUCE_INTEL
+		const auto space = _mm_set1_epi8(' ');
+		const auto below = _mm_set1_epi8(8);
+		const auto above = _mm_set1_epi8(14);
+
+		while (end - t >= 16)
+		{
+			auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*> (t));
+			auto isSpace = _mm_or_si128(_mm_cmpeq_epi8(chars, space),
+										_mm_and_si128(_mm_cmpgt_epi8(chars, below), _mm_cmplt_epi8(chars, above)));
+
+			auto notSpace = ~(juce::uint32)_mm_movemask_epi8(isSpace) & 0xffffu;
+
+			if (notSpace != 0)
+				return t + countTrailingZeros(notSpace);
+
+			t += 16;
+		}
+	   #elif JUCE_ARM && defined (__ARM_NEON)
+		const auto space = vdupq_n_u8(' ');
+		const auto tab = vdupq_n_u8(9);
+		const auto numControlSpaces = vdupq_n_u8(5);
+
+		while (end - t >= 16)
+		{
+			auto chars = vld1q_u8(reinterpret_cast<const uint8_t*> (t));
+			auto isSpace = vorrq_u8(vceqq_u8(chars, space), vcltq_u8(vsubq_u8(chars, tab), numControlSpaces));
+
+			auto notSpace = ~movemask(isSpace);
+
+			if (notSpace != 0)
+				return t + (countTrailingZeros(notSpace) >> 2);
+
+			t += 16;
+		}
+	   #endif
+
+		while (t < end && isWhitespace(*t))
+			++t;
+
+		return t;
+	}
+
+	/** Returns the first '/', space or tab in the range, or end if there isn't one. This is the
+		separator set that the parser used to pass to CharacterFunctions::findEndOfToken().
+	*/
+	static const char* findEndOfFaceToken(const char* t, const char* end) noexcept
+	{
+	   #if JUCE_INTEL
+		const auto slash = _mm_set1_epi8('/');
+		const auto space = _mm_set1_epi8(' ');
+		const auto tab = _mm_set1_epi8('\t');
+
+		while (end - t >= 16)
+		{
+			auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*> (t));
+			auto isSeparator = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, slash),
+														 _mm_cmpeq_epi8(chars, space)),
+											_mm_cmpeq_epi8(chars, tab));
+
+			auto separators = (juce::uint32)_mm_movemask_epi8(isSeparator);
+
+			if (separators != 0)
+				return t + countTrailingZeros(separators);
+
+			t += 16;
+		}
+	   #elif JUCE_ARM && defined (__ARM_NEON)
+		const auto slash = vdupq_n_u8('/');
+		const auto space = vdupq_n_u8(' ');
+		const auto tab = vdupq_n_u8('\t');
+
+		while (end - t >= 16)
+		{
+			auto chars = vld1q_u8(reinterpret_cast<const uint8_t*> (t));
+			auto isSeparator = vorrq_u8(vorrq_u8(vceqq_u8(chars, slash), vceqq_u8(chars, space)),
+										vceqq_u8(chars, tab));
+
+			auto separators = movemask(isSeparator);
+
+			if (separators != 0)
+				return t + (countTrailingZeros(separators) >> 2);
+
+			t += 16;
+		}
+	   #endif
+
+		while (t < end && *t != '/' && *t != ' ' && *t != '\t')
+			++t;
+
+		return t;
+	}
+
+	/** Behaves like String::CharPointerType::getIntValue32(): it skips whitespace, takes an
+		optional '-', and then reads digits, wrapping on overflow. It doesn't move t.
+	*/
+	static int readInt(const char* t, const char* end) noexcept
+	{
+		t = skipWhitespace(t, end);
+
+		const bool isNegative = (t < end && *t == '-');
+
+		if (isNegative)
+			++t;
+
+		juce::uint32 v = 0;
+
+		for (; t < end && isDigit(*t); ++t)
+			v = v * 10 + (juce::uint32)(*t - '0');
+
+		return (int)(isNegative ? 0 - v : v);
+	}
+
+	/** Reads a number the way (float) CharacterFunctions::readDoubleValue() does, and moves t
+		past it. t must point at a non-whitespace character, and the byte at end must be
+		readable and not part of a number (the parser's LineReader makes sure of this), since
+		the fallback path doesn't know where the range ends.
+	*/
+	static float readFloat(const char*& t, const char* end) noexcept
+	{
+		double value;
+
+		if (readPlainDecimal(t, end, value))
+			return (float)value;
+
+		CharPointer_UTF8 text(t);
+		value = CharacterFunctions::readDoubleValue(text);
+		t = text.getAddress();
+		return (float)value;
+	}
+
+private:
+	//==============================================================================
+	/** Reads a number with no exponent and at most 9 significant digits on each side of the
+		point, by putting all of its digits together into one whole number and dividing that by
+		10 to the power of the number of digits after the point.
+
+		As long as that whole number is below 2^53 and there are at most 22 digits after the
+		point, both sides of the division are exact doubles, so the one division rounds
+		correctly, to the same double that strtod() gives. JUCE 5.2.1's readDoubleValue()
+		divides only the fraction's digits and then adds the integer part, rounding twice,
+		so its double can be one bit away from this one (see the note on ObjTextScanning).
+		Anything else returns false and leaves t alone.
+	*/
+	static bool readPlainDecimal(const char*& text, const char* end, double& result) noexcept
+	{
+		enum { maxDigitsPerPart = 9 };
+
+		auto t = text;
+		bool isNegative = false;
+
+		if (t < end && (*t == '-' || *t == '+'))
+			isNegative = (*t++ == '-');
+
+		juce::uint32 integerPart = 0, fractionPart = 0;
+		int numIntegerDigits = 0, numFractionDigits = 0, numCountedFractionDigits = 0;
+		bool digitsFound = false;
+
+		// Leading zeros aren't significant digits
+		while (t < end && *t == '0')
+		{
+			++t;
+			digitsFound = true;
+		}
+
+		for (; t < end && isDigit(*t); ++t)
+		{
+			if (++numIntegerDigits > maxDigitsPerPart)
+				return false;
+
+			integerPart = integerPart * 10 + (juce::uint32)(*t - '0');
+		}
+
+		digitsFound = digitsFound || numIntegerDigits > 0;
+		const bool hasPoint = (t < end && *t == '.');
+
+		if (hasPoint)
+		{
+			++t;
+
+			for (; t < end && isDigit(*t); ++t)
+			{
+				++numFractionDigits;
+
+				// With no integer digits, zeros after the point still aren't significant
+				if (numIntegerDigits == 0 && numCountedFractionDigits == 0 && *t == '0')
+					continue;
+
+				if (++numCountedFractionDigits > maxDigitsPerPart)
+					return false;
+
+				fractionPart = fractionPart * 10 + (juce::uint32)(*t - '0');
+			}
+
+			digitsFound = digitsFound || numFractionDigits > 0;
+		}
+
+		if (!digitsFound
+			 || numFractionDigits >= numExactPowersOfTen
+			 || (t < end && (*t == 'e' || *t == 'E')))
+			return false;
+
+		// When there are integer digits, every digit after the point was counted, so at most 9
+		// of them, and the whole number is below 10^18
+		auto digits = (juce::uint64)integerPart;
+
+		if (integerPart != 0)
+			for (auto i = 0; i < numFractionDigits; ++i)
+				digits *= 10;
+
+		digits += fractionPart;
+
+		if (digits >= ((juce::uint64)1 << 53))
+			return false;
+
+		auto value = (double)digits / getExactPowerOfTen(numFractionDigits);
+		result = isNegative ? -value : value;
+		text = t;
+		return true;
+	}
+
+	enum { numExactPowersOfTen = 23 };
+
+	/** Returns 10^n, for an n below numExactPowersOfTen, where a double holds it exactly. */
+	static double getExactPowerOfTen(int n) noexcept
+	{
+		static const double powers[numExactPowersOfTen] =
+		{
+			1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		jassert(n >= 0 && n < numExactPowersOfTen);
+		return powers[n];
+	}
+
+	//==============================================================================
+	static int countTrailingZeros(juce::uint64 bits) noexcept
+	{
+		jassert(bits != 0);
+
+	   #if JUCE_MSVC
+		unsigned long index;
+		#if JUCE_64BIT
+		 _BitScanForward64(&index, bits);
+		#else
+		 if (_BitScanForward(&index, (unsigned long)bits) == 0)
+		 {
+			 _BitScanForward(&index, (unsigned long)(bits >> 32));
+			 index += 32;
+		 }
+		#endif
+		return (int)index;
+	   #else
+		return __builtin_ctzll(bits);
+	   #endif
+	}
+
+   #if JUCE_ARM && defined (__ARM_NEON) && ! JUCE_INTEL
+	/** Packs a NEON comparison result into 4 bits per byte, as a cheaper stand-in for SSE's movemask. */
+	static juce::uint64 movemask(uint8x16_t mask) noexcept
+	{
+		return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(mask), 4)), 0);
+	}
+   #endif
+};
+
+
+#endif  // OBJTEXTSCANNING_H_INCLUDED
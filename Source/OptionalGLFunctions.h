@@ -0,0 +1,249 @@
+/*
+==============================================================================
+
+OptionalGLFunctions.h
+Created: 18 October 2026 2:05am
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define the table of GL functions that the OpenGL view looks up at run
+*  time, because not every context has them, along with the constants they need.
+*/
+
+#ifndef OPTIONALGLFUNCTIONS_H_INCLUDED
+#define OPTIONALGLFUNCTIONS_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+// The calling convention of the GL functions that are looked up at run time
+#if JUCE_WINDOWS
+ #define OPENGLVIEW_GL_CALL __stdcall
+#else
+ #define OPENGLVIEW_GL_CALL
+#endif
+
+#ifndef GL_VERTEX_ARRAY_BINDING
+ #define GL_VERTEX_ARRAY_BINDING 0x85B5
+#endif
+
+// What the staging ring needs from buffer storage, copy buffers and sync objects
+#ifndef GL_COPY_READ_BUFFER
+ #define GL_COPY_READ_BUFFER 0x8F36
+ #define GL_COPY_WRITE_BUFFER 0x8F37
+#endif
+
+#ifndef GL_MAP_PERSISTENT_BIT
+ #define GL_MAP_WRITE_BIT 0x0002
+ #define GL_MAP_PERSISTENT_BIT 0x0040
+ #define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+ #define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+ #define GL_TIMEOUT_EXPIRED 0x911B
+#endif
+
+// And what the program binary cache needs
+#ifndef GL_PROGRAM_BINARY_LENGTH
+ #define GL_PROGRAM_BINARY_LENGTH 0x8741
+ #define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+ #define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+
+// And what the GPU timer needs
+#ifndef GL_QUERY_RESULT
+ #define GL_QUERY_RESULT 0x8866
+ #define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+#ifndef GL_TIME_ELAPSED
+ #define GL_TIME_ELAPSED 0x88BF
+#endif
+
+
+
+//==============================================================================
+/**
+*  The GL functions that not every context has. They're looked up when the context is
+*  created, by their core names and then their extensions' names, and any of them can be
+*  nullptr.
+*/
+struct OptionalGLFunctions
+{
+	typedef void (OPENGLVIEW_GL_CALL* MultiDrawElementsFunction) (GLenum, const GLsizei*, GLenum, const GLvoid* const*, GLsizei);
+	typedef void (OPENGLVIEW_GL_CALL* GenVertexArraysFunction) (GLsizei, GLuint*);
+	typedef void (OPENGLVIEW_GL_CALL* BindVertexArrayFunction) (GLuint);
+	typedef void (OPENGLVIEW_GL_CALL* DeleteVertexArraysFunction) (GLsizei, const GLuint*);
+	typedef void (OPENGLVIEW_GL_CALL* DrawElementsInstancedFunction) (GLenum, GLsizei, GLenum, const GLvoid*, GLsizei);
+	typedef void (OPENGLVIEW_GL_CALL* VertexAttribDivisorFunction) (GLuint, GLuint);
+	typedef void (OPENGLVIEW_GL_CALL* VertexAttrib4fvFunction) (GLuint, const GLfloat*);
+
+	typedef void* SyncObject;   // a GLsync, which older GL headers don't declare
+	typedef void (OPENGLVIEW_GL_CALL* BufferStorageFunction) (GLenum, GLsizeiptr, const GLvoid*, GLbitfield);
+	typedef void* (OPENGLVIEW_GL_CALL* MapBufferRangeFunction) (GLenum, GLintptr, GLsizeiptr, GLbitfield);
+	typedef GLboolean (OPENGLVIEW_GL_CALL* UnmapBufferFunction) (GLenum);
+	typedef void (OPENGLVIEW_GL_CALL* CopyBufferSubDataFunction) (GLenum, GLenum, GLintptr, GLintptr, GLsizeiptr);
+	typedef SyncObject (OPENGLVIEW_GL_CALL* FenceSyncFunction) (GLenum, GLbitfield);
+	typedef GLenum (OPENGLVIEW_GL_CALL* ClientWaitSyncFunction) (SyncObject, GLbitfield, juce::uint64);
+	typedef void (OPENGLVIEW_GL_CALL* DeleteSyncFunction) (SyncObject);
+
+	typedef void (OPENGLVIEW_GL_CALL* GetProgramBinaryFunction) (GLuint, GLsizei, GLsizei*, GLenum*, GLvoid*);
+	typedef void (OPENGLVIEW_GL_CALL* ProgramBinaryFunction) (GLuint, GLenum, const GLvoid*, GLsizei);
+	typedef void (OPENGLVIEW_GL_CALL* ProgramParameteriFunction) (GLuint, GLenum, GLint);
+
+	typedef void (OPENGLVIEW_GL_CALL* GenQueriesFunction) (GLsizei, GLuint*);
+	typedef void (OPENGLVIEW_GL_CALL* DeleteQueriesFunction) (GLsizei, const GLuint*);
+	typedef void (OPENGLVIEW_GL_CALL* BeginQueryFunction) (GLenum, GLuint);
+	typedef void (OPENGLVIEW_GL_CALL* EndQueryFunction) (GLenum);
+	typedef void (OPENGLVIEW_GL_CALL* GetQueryObjectuivFunction) (GLuint, GLenum, GLuint*);
+	typedef void (OPENGLVIEW_GL_CALL* GetQueryObjectui64vFunction) (GLuint, GLenum, juce::uint64*);
+
+	OptionalGLFunctions()
+	{
+		multiDrawElements = (MultiDrawElementsFunction)find("glMultiDrawElements", { "", "EXT" });
+
+		genVertexArrays = (GenVertexArraysFunction)find("glGenVertexArrays", { "", "OES", "APPLE" });
+		bindVertexArray = (BindVertexArrayFunction)find("glBindVertexArray", { "", "OES", "APPLE" });
+		deleteVertexArrays = (DeleteVertexArraysFunction)find("glDeleteVertexArrays", { "", "OES", "APPLE" });
+
+		// These only work in sets, so a context that's missing one of a set gets none of it
+		if (genVertexArrays == nullptr || bindVertexArray == nullptr || deleteVertexArrays == nullptr)
+		{
+			genVertexArrays = nullptr;
+			bindVertexArray = nullptr;
+			deleteVertexArrays = nullptr;
+		}
+
+		// The context binds a vertex array of its own before it calls newOpenGLContextCreated(),
+		// and binds it again after every frame, so this is asked once rather than every draw
+		contextVertexArray = 0;
+
+		if (hasVertexArrays())
+		{
+			GLint binding = 0;
+			glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &binding);
+			contextVertexArray = (GLuint)binding;
+		}
+
+		drawElementsInstanced = (DrawElementsInstancedFunction)find("glDrawElementsInstanced", { "", "ARB", "EXT", "ANGLE" });
+		vertexAttribDivisor = (VertexAttribDivisorFunction)find("glVertexAttribDivisor", { "", "ARB", "EXT", "ANGLE" });
+
+		if (drawElementsInstanced == nullptr || vertexAttribDivisor == nullptr)
+		{
+			drawElementsInstanced = nullptr;
+			vertexAttribDivisor = nullptr;
+		}
+
+		vertexAttrib4fv = (VertexAttrib4fvFunction)find("glVertexAttrib4fv", { "", "ARB" });
+
+		bufferStorage = (BufferStorageFunction)find("glBufferStorage", { "", "EXT" });
+		mapBufferRange = (MapBufferRangeFunction)find("glMapBufferRange", { "", "EXT" });
+		unmapBuffer = (UnmapBufferFunction)find("glUnmapBuffer", { "", "ARB", "OES" });
+		copyBufferSubData = (CopyBufferSubDataFunction)find("glCopyBufferSubData", { "", "NV" });
+		fenceSync = (FenceSyncFunction)find("glFenceSync", { "", "APPLE" });
+		clientWaitSync = (ClientWaitSyncFunction)find("glClientWaitSync", { "", "APPLE" });
+		deleteSync = (DeleteSyncFunction)find("glDeleteSync", { "", "APPLE" });
+
+		if (bufferStorage == nullptr || mapBufferRange == nullptr || unmapBuffer == nullptr || copyBufferSubData == nullptr
+			|| fenceSync == nullptr || clientWaitSync == nullptr || deleteSync == nullptr)
+		{
+			bufferStorage = nullptr;
+			mapBufferRange = nullptr;
+			unmapBuffer = nullptr;
+			copyBufferSubData = nullptr;
+			fenceSync = nullptr;
+			clientWaitSync = nullptr;
+			deleteSync = nullptr;
+		}
+
+		getProgramBinary = (GetProgramBinaryFunction)find("glGetProgramBinary", { "", "OES" });
+		programBinary = (ProgramBinaryFunction)find("glProgramBinary", { "", "OES" });
+		programParameteri = (ProgramParameteriFunction)find("glProgramParameteri", { "", "ARB", "EXT" });
+
+		// A driver can have the functions and still not offer any binary formats
+		GLint numBinaryFormats = 0;
+
+		if (getProgramBinary != nullptr && programBinary != nullptr)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+
+		if (numBinaryFormats <= 0)
+		{
+			getProgramBinary = nullptr;
+			programBinary = nullptr;
+		}
+
+		// Timer queries need GL 3.3 or ARB_timer_query, or EXT_disjoint_timer_query on GLES
+		genQueries = (GenQueriesFunction)find("glGenQueries", { "", "ARB", "EXT" });
+		deleteQueries = (DeleteQueriesFunction)find("glDeleteQueries", { "", "ARB", "EXT" });
+		beginQuery = (BeginQueryFunction)find("glBeginQuery", { "", "ARB", "EXT" });
+		endQuery = (EndQueryFunction)find("glEndQuery", { "", "ARB", "EXT" });
+		getQueryObjectuiv = (GetQueryObjectuivFunction)find("glGetQueryObjectuiv", { "", "ARB", "EXT" });
+		getQueryObjectui64v = (GetQueryObjectui64vFunction)find("glGetQueryObjectui64v", { "", "ARB", "EXT" });
+
+		if (genQueries == nullptr || deleteQueries == nullptr || beginQuery == nullptr || endQuery == nullptr
+			|| getQueryObjectuiv == nullptr || getQueryObjectui64v == nullptr)
+		{
+			genQueries = nullptr;
+			deleteQueries = nullptr;
+			beginQuery = nullptr;
+			endQuery = nullptr;
+			getQueryObjectuiv = nullptr;
+			getQueryObjectui64v = nullptr;
+		}
+	}
+
+	bool hasVertexArrays() const noexcept       { return bindVertexArray != nullptr; }
+	bool hasInstancing() const noexcept         { return drawElementsInstanced != nullptr; }
+	bool hasPersistentMapping() const noexcept  { return bufferStorage != nullptr; }
+	bool hasProgramBinaries() const noexcept    { return programBinary != nullptr; }
+	bool hasTimerQueries() const noexcept       { return getQueryObjectui64v != nullptr; }
+
+	MultiDrawElementsFunction multiDrawElements;
+	GenVertexArraysFunction genVertexArrays;
+	BindVertexArrayFunction bindVertexArray;
+	DeleteVertexArraysFunction deleteVertexArrays;
+	GLuint contextVertexArray;   // the one to put back after drawing with one of ours
+	DrawElementsInstancedFunction drawElementsInstanced;
+	VertexAttribDivisorFunction vertexAttribDivisor;
+	VertexAttrib4fvFunction vertexAttrib4fv;
+	BufferStorageFunction bufferStorage;
+	MapBufferRangeFunction mapBufferRange;
+	UnmapBufferFunction unmapBuffer;
+	CopyBufferSubDataFunction copyBufferSubData;
+	FenceSyncFunction fenceSync;
+	ClientWaitSyncFunction clientWaitSync;
+	DeleteSyncFunction deleteSync;
+	GetProgramBinaryFunction getProgramBinary;
+	ProgramBinaryFunction programBinary;
+	ProgramParameteriFunction programParameteri;   // optional even when the other two are there
+	GenQueriesFunction genQueries;
+	DeleteQueriesFunction deleteQueries;
+	BeginQueryFunction beginQuery;
+	EndQueryFunction endQuery;
+	GetQueryObjectuivFunction getQueryObjectuiv;
+	GetQueryObjectui64vFunction getQueryObjectui64v;
+
+private:
+	static void* find(const char* name, std::initializer_list<const char*> suffixes)
+	{
+		for (auto* suffix : suffixes)
+			if (auto* function = OpenGLHelpers::getExtensionFunction((String(name) + suffix).toRawUTF8()))
+				return function;
+
+		return nullptr;
+	}
+
+	JUCE_DECLARE_NON_COPYABLE(OptionalGLFunctions)
+};
+
+
+#endif  // OPTIONALGLFUNCTIONS_H_INCLUDED
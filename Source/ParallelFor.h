@@ -0,0 +1,101 @@
+/*
+==============================================================================
+
+ParallelFor.h
+Created: 16 October 2026 9:12am
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define a small helper for splitting loops over a pool of worker threads.
+*/
+
+#ifndef PARALLELFOR_H_INCLUDED
+#define PARALLELFOR_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+#include <functional>
+
+
+
+//==============================================================================
+/**
+*  The threads that parallelFor() hands its work to. They're started the first time they're
+*  needed, one per CPU, and then kept for as long as the program runs, so a load that splits
+*  a dozen phases over them doesn't pay to start and join a full set of threads for each one.
+*/
+inline ThreadPool& getParallelForPool()
+{
+	static ThreadPool pool(jmax(1, SystemStats::getNumCpus()));
+	return pool;
+}
+
+//==============================================================================
+/**
+*  Calls function (i) for every i in [0, numItems), spread over up to numThreads threads,
+*  and only returns once all of the calls have finished. The calling thread does its share
+*  of the work too, so with a single thread (or a single item) everything simply runs in
+*  order on the caller. Items are handed out one at a time, so uneven items balance out.
+*
+*  The other threads come from the shared pool. When the caller runs out of items, any job
+*  that no pool thread has picked up yet is taken back off the queue rather than waited for,
+*  so calls from several threads at once (or from inside another parallelFor) can't end up
+*  waiting on each other; they just get less help.
+*
+*  The function is called concurrently, so it must only write to state that belongs to
+*  the item it's been given.
+*/
+template <typename Function>
+void parallelFor(int numItems, int numThreads, const Function& function)
+{
+	numThreads = jmin(numThreads, numItems);
+
+	if (numThreads <= 1)
+	{
+		for (auto i = 0; i < numItems; ++i)
+			function(i);
+
+		return;
+	}
+
+	std::atomic<int> nextItem(0);
+
+	auto runItems = [&]
+	{
+		for (int i; (i = nextItem++) < numItems;)
+			function(i);
+	};
+
+	struct Worker : public ThreadPoolJob
+	{
+		Worker(std::function<void()> workToDo) : ThreadPoolJob("parallelFor"), work(std::move(workToDo)) {}
+
+		JobStatus runJob() override
+		{
+			work();
+			return jobHasFinished;
+		}
+
+		std::function<void()> work;
+	};
+
+	auto& pool = getParallelForPool();
+	OwnedArray<Worker> workers;
+
+	for (auto i = 1; i < numThreads; ++i)
+		pool.addJob(workers.add(new Worker(runItems)), false);
+
+	runItems();
+
+	// Removes the jobs that haven't started, and waits for the ones that have
+	for (auto* worker : workers)
+		pool.removeJob(worker, false, -1);
+}
+
+
+#endif  // PARALLELFOR_H_INCLUDED
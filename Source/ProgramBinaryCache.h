@@ -0,0 +1,172 @@
+/*
+==============================================================================
+
+ProgramBinaryCache.h
+Created: 17 October 2026 9:20pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define the files that keep linked shader programs between runs, so
+*  that the OpenGL view doesn't have to compile its shaders every time its context is made.
+*/
+
+#ifndef PROGRAMBINARYCACHE_H_INCLUDED
+#define PROGRAMBINARYCACHE_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+
+//==============================================================================
+/**
+*  Stores program binaries, as a driver hands them out from glGetProgramBinary, in a folder
+*  of files named by a key. The key is a hash of everything that decides whether a binary can
+*  be reused: the shader sources exactly as they were compiled, and the driver's vendor,
+*  renderer and version strings. Change any of them and the key changes, so the old file is
+*  just never looked at again.
+*
+*  Each file is a fixed Header followed by the binary. load() refuses a file whose header,
+*  size or checksum doesn't match, but a driver can still reject a binary that looks fine
+*  (after an update that didn't change its version string, say), so the caller has to be
+*  ready to compile the shaders anyway, and then save() replaces the file.
+*
+*  Along with the binary, a file keeps how long the compile took that produced it, so the
+*  caller can tell how much time loading it saved.
+*/
+struct ProgramBinaryCache
+{
+	enum
+	{
+		formatVersion = 1
+	};
+
+	struct Header
+	{
+		char magic[8];
+		juce::uint32 formatVersion, binaryFormat;
+		juce::uint64 binarySize, checksum;
+		double compileMilliseconds;
+	};
+
+	/** A program binary, the format the driver gave for it, and what compiling it cost. */
+	struct Entry
+	{
+		juce::uint32 binaryFormat;
+		MemoryBlock binary;
+		double compileMilliseconds;
+	};
+
+	explicit ProgramBinaryCache(const File& cacheDirectory) : directory(cacheDirectory) {}
+
+	/** Where the view keeps its programs, unless it's told otherwise. */
+	static File getDefaultDirectory()
+	{
+		return File::getSpecialLocation(File::tempDirectory).getChildFile("ModularImageViewer Shader Cache");
+	}
+
+	/** Makes a key from the strings that a binary depends on. The order matters. */
+	static String createKey(const StringArray& keyStrings)
+	{
+		auto joined = keyStrings.joinIntoString("\n");
+		return String::toHexString(joined.hashCode64()) + "-" + String::toHexString((int64)joined.getNumBytesAsUTF8());
+	}
+
+	File getFileFor(const String& key) const
+	{
+		return directory.getChildFile(key + ".programbinary");
+	}
+
+	/** Reads the binary for a key. Returns false if there isn't one, or it isn't intact. */
+	bool load(const String& key, Entry& entry) const
+	{
+		MemoryBlock contents;
+
+		if (!getFileFor(key).loadFileAsData(contents) || contents.getSize() < sizeof(Header))
+			return false;
+
+		Header header;
+		memcpy(&header, contents.getData(), sizeof(header));
+
+		if (memcmp(header.magic, "GLPROGBN", sizeof(header.magic)) != 0
+			 || header.formatVersion != formatVersion
+			 || header.binarySize != (juce::uint64)(contents.getSize() - sizeof(Header))
+			 || header.binarySize == 0)
+			return false;
+
+		auto* binary = static_cast<const char*> (contents.getData()) + sizeof(Header);
+
+		if (header.checksum != getChecksum(binary, (size_t)header.binarySize))
+			return false;
+
+		entry.binaryFormat = header.binaryFormat;
+		entry.binary.replaceWith(binary, (size_t)header.binarySize);
+		entry.compileMilliseconds = header.compileMilliseconds;
+		return true;
+	}
+
+	/** Writes the binary for a key. Like the mesh cache, it goes to a temporary file first and
+		is then moved into place, so a reader never sees half of one.
+	*/
+	Result save(const String& key, const Entry& entry) const
+	{
+		if (entry.binary.getSize() == 0)
+			return Result::fail("There's no binary to save");
+
+		auto directoryCreated = directory.createDirectory();
+
+		if (directoryCreated.failed())
+			return directoryCreated;
+
+		Header header;
+		memcpy(header.magic, "GLPROGBN", sizeof(header.magic));
+		header.formatVersion = formatVersion;
+		header.binaryFormat = entry.binaryFormat;
+		header.binarySize = (juce::uint64)entry.binary.getSize();
+		header.checksum = getChecksum(entry.binary.getData(), entry.binary.getSize());
+		header.compileMilliseconds = entry.compileMilliseconds;
+
+		auto file = getFileFor(key);
+		TemporaryFile temp(file);
+
+		{
+			FileOutputStream out(temp.getFile());
+
+			if (out.failedToOpen())
+				return out.getStatus();
+
+			auto ok = out.write(&header, sizeof(header)) && out.write(entry.binary.getData(), entry.binary.getSize());
+			out.flush();
+
+			if (!ok || out.getStatus().failed())
+				return Result::fail("Cannot write file: " + temp.getFile().getFullPathName());
+		}
+
+		if (!temp.overwriteTargetFileWithTemporary())
+			return Result::fail("Cannot write file: " + file.getFullPathName());
+
+		return Result::ok();
+	}
+
+private:
+	File directory;
+
+	/** 64-bit FNV-1a, which is plenty to notice a truncated or damaged file. */
+	static juce::uint64 getChecksum(const void* data, size_t numBytes) noexcept
+	{
+		auto* bytes = static_cast<const juce::uint8*> (data);
+		juce::uint64 hash = 0xcbf29ce484222325ull;
+
+		for (size_t i = 0; i < numBytes; ++i)
+			hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+
+		return hash;
+	}
+};
+
+
+#endif  // PROGRAMBINARYCACHE_H_INCLUDED
@@ -0,0 +1,157 @@
+/*
+==============================================================================
+
+StagingRing.h
+Created: 18 October 2026 2:05am
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define the ring of staging memory that the OpenGL view streams its
+*  models' vertices and indices through.
+*/
+
+#ifndef STAGINGRING_H_INCLUDED
+#define STAGINGRING_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "OptionalGLFunctions.h"
+
+
+
+//==============================================================================
+/**
+*  Staging memory that the models' vertices and indices pass through on their way into
+*  their buffers, a slice at a time, so that a large model doesn't stall a frame.
+*
+*  Where the context has buffer storage and sync objects, the ring is one buffer mapped
+*  for good, split into slices. Each copy is written into the current slice with memcpy,
+*  copied into place on the GPU with glCopyBufferSubData, and fenced. A slice isn't
+*  started again until the fence after its last copy has passed, and if it hasn't,
+*  copy() gives up for this frame rather than wait for it. Without them, the data just
+*  goes in with glBufferSubData, in pieces of the same size.
+*/
+struct StagingRing
+{
+	enum
+	{
+		sliceSize = 1024 * 1024,
+		numSlices = 8,
+		bytesPerFrame = sliceSize * numSlices / 2   // which leaves the last frame's slices in flight
+	};
+
+	StagingRing(OpenGLContext& context, const OptionalGLFunctions& optionalFunctions)
+		: openGLContext(context), functions(optionalFunctions), buffer(0), mappedMemory(nullptr),
+		  currentSlice(0), slicePosition(0)
+	{
+		for (auto& fence : fences)
+			fence = nullptr;
+
+		if (!functions.hasPersistentMapping())
+			return;
+
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		auto& extensions = context.extensions;
+
+		extensions.glGenBuffers(1, &buffer);
+		extensions.glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		functions.bufferStorage(GL_COPY_WRITE_BUFFER, (GLsizeiptr)(sliceSize * numSlices), nullptr, flags);
+		mappedMemory = static_cast<char*> (functions.mapBufferRange(GL_COPY_WRITE_BUFFER, 0, (GLsizeiptr)(sliceSize * numSlices), flags));
+		extensions.glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		if (mappedMemory == nullptr)
+		{
+			extensions.glDeleteBuffers(1, &buffer);
+			buffer = 0;
+		}
+	}
+
+	~StagingRing()
+	{
+		for (auto fence : fences)
+			if (fence != nullptr)
+				functions.deleteSync(fence);
+
+		if (buffer != 0)
+		{
+			openGLContext.extensions.glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			functions.unmapBuffer(GL_COPY_WRITE_BUFFER);
+			openGLContext.extensions.glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			openGLContext.extensions.glDeleteBuffers(1, &buffer);
+		}
+	}
+
+	bool isPersistentlyMapped() const noexcept    { return mappedMemory != nullptr; }
+
+	/** Copies up to sliceSize bytes into a buffer at an offset, and returns how many it
+		copied. That's 0 when the next slice is still waiting for the GPU. The buffers it binds
+		are added to numBufferBinds.
+	*/
+	size_t copy(GLuint destination, size_t destinationOffset, const void* source, size_t numBytes, int& numBufferBinds)
+	{
+		numBytes = jmin(numBytes, (size_t)sliceSize);
+		auto& extensions = openGLContext.extensions;
+
+		if (!isPersistentlyMapped())
+		{
+			extensions.glBindBuffer(GL_ARRAY_BUFFER, destination);
+			extensions.glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)destinationOffset, (GLsizeiptr)numBytes, source);
+			++numBufferBinds;
+			return numBytes;
+		}
+
+		if (slicePosition == (size_t)sliceSize)
+		{
+			currentSlice = (currentSlice + 1) % numSlices;
+			slicePosition = 0;
+		}
+
+		auto& fence = fences[currentSlice];
+
+		if (slicePosition == 0 && fence != nullptr)
+		{
+			if (functions.clientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+				return 0;
+
+			functions.deleteSync(fence);
+			fence = nullptr;
+		}
+
+		numBytes = jmin(numBytes, (size_t)sliceSize - slicePosition);
+		auto ringOffset = (size_t)currentSlice * (size_t)sliceSize + slicePosition;
+		memcpy(mappedMemory + ringOffset, source, numBytes);
+
+		extensions.glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		extensions.glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+		numBufferBinds += 2;
+
+		functions.copyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+									(GLintptr)ringOffset, (GLintptr)destinationOffset, (GLsizeiptr)numBytes);
+
+		// Fences pass in order, so the slice only needs the one after its latest copy
+		if (fence != nullptr)
+			functions.deleteSync(fence);
+
+		fence = functions.fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slicePosition += numBytes;
+		return numBytes;
+	}
+
+private:
+	OpenGLContext& openGLContext;
+	const OptionalGLFunctions& functions;
+	GLuint buffer;
+	char* mappedMemory;
+	OptionalGLFunctions::SyncObject fences[numSlices];
+	int currentSlice;
+	size_t slicePosition;
+
+	JUCE_DECLARE_NON_COPYABLE(StagingRing)
+};
+
+
+#endif  // STAGINGRING_H_INCLUDED
@@ -0,0 +1,319 @@
+/*
+==============================================================================
+
+MeshCodecTests.cpp
+Created: 18 October 2026 1:15am
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we check that MeshCodec gives back the bundled models, exactly or within
+*  half a quantisation step, that its SSSE3 and scalar decoders agree, and that it turns down
+*  blocks that have been cut short or had bits flipped.
+*/
+
+#include "ProjectUnitTests.h"
+#include "../MainComponent.h"
+
+
+//==============================================================================
+class MeshCodecTests  : public UnitTest
+{
+public:
+	MeshCodecTests() : UnitTest("MeshCodec", ProjectUnitTests::getCategory()) {}
+
+	void runTest() override
+	{
+		WavefrontObjFile::LoadOptions loadOptions;
+		loadOptions.generateNormals = true;
+		loadOptions.optimiseMeshes = true;
+		loadOptions.buildLevelsOfDetail = true;
+		loadOptions.buildMeshlets = true;
+
+		for (auto* name : { "humanoid_quad.obj", "humanoid_tri.obj", "teapot.obj", "slot_machine.obj" })
+		{
+			WavefrontObjFile model;
+			expect(model.load(OpenGLView::findResourceFile(name), loadOptions).wasOk());
+			expect(model.shapes.size() > 0);
+
+			beginTest(String("Lossless round trip of ") + name);
+
+			for (auto* shape : model.shapes)
+				checkLosslessRoundTrip(shape->mesh);
+
+			beginTest(String("Quantised round trip of ") + name);
+
+			for (auto* shape : model.shapes)
+				checkQuantisedRoundTrip(shape->mesh);
+
+			beginTest(String("SSSE3 and scalar decoding of ") + name);
+
+			for (auto* shape : model.shapes)
+			{
+				auto& mesh = shape->mesh;
+				checkDecodersAgree(mesh.indices.begin(), mesh.indices.size());
+
+				// The positions' raw bits, which vary far more than the indices do
+				Array<juce::uint32> bits;
+				bits.insertMultiple(0, 0, mesh.vertices.size() * 3);
+				memcpy(bits.begin(), mesh.vertices.begin(), (size_t)bits.size() * sizeof(juce::uint32));
+				checkDecodersAgree(bits.begin(), bits.size());
+			}
+
+			beginTest(String("Damaged blocks of ") + name);
+
+			for (auto* shape : model.shapes)
+				checkDamagedBlocks(shape->mesh);
+		}
+
+		beginTest("SSSE3 and scalar decoding of every length of value");
+		{
+			if (!MeshCodec::canUseSSSE3())
+				logMessage("This machine has no SSSE3, so only the scalar decoder is checked");
+
+			// Runs of every length up to a few groups of four, so each way the SSSE3 loop can
+			// hand over to the scalar one is covered, with deltas of one to four bytes
+			Random random(0xc0dec);
+
+			for (auto numValues = 0; numValues < 70; ++numValues)
+			{
+				Array<juce::uint32> values;
+
+				for (auto i = 0; i < numValues; ++i)
+					values.add((juce::uint32)random.nextInt() >> (random.nextInt(4) * 8));
+
+				checkDecodersAgree(values.begin(), values.size());
+			}
+		}
+	}
+
+private:
+	typedef WavefrontObjFile::Mesh Mesh;
+
+	template <typename ElementType>
+	static bool isBitwiseEqual(const Array<ElementType>& a, const Array<ElementType>& b)
+	{
+		return a.size() == b.size()
+				&& (a.size() == 0 || memcmp(a.begin(), b.begin(), sizeof(ElementType) * (size_t)a.size()) == 0);
+	}
+
+	/** The indices, levels of detail and meshlets, which are never quantised. */
+	void expectSameTopology(const Mesh& decoded, const Mesh& mesh)
+	{
+		expect(isBitwiseEqual(decoded.indices, mesh.indices));
+		expect(isBitwiseEqual(decoded.meshlets, mesh.meshlets));
+		expectEquals(decoded.levelsOfDetail.size(), mesh.levelsOfDetail.size());
+
+		for (auto l = 0; l < jmin(decoded.levelsOfDetail.size(), mesh.levelsOfDetail.size()); ++l)
+		{
+			expect(isBitwiseEqual(decoded.levelsOfDetail.getReference(l).indices, mesh.levelsOfDetail.getReference(l).indices));
+			expectEquals(decoded.levelsOfDetail.getReference(l).error, mesh.levelsOfDetail.getReference(l).error);
+		}
+	}
+
+	void checkLosslessRoundTrip(const Mesh& mesh)
+	{
+		MemoryBlock encoded;
+		MeshCodec::encode(mesh, MeshCodec::Options(), encoded);
+
+		Mesh decoded;
+		expect(MeshCodec::decode(encoded.getData(), encoded.getSize(), decoded));
+
+		expect(isBitwiseEqual(decoded.vertices, mesh.vertices));
+		expect(isBitwiseEqual(decoded.normals, mesh.normals));
+		expect(isBitwiseEqual(decoded.textureCoords, mesh.textureCoords));
+		expectSameTopology(decoded, mesh);
+	}
+
+	void checkQuantisedRoundTrip(const Mesh& mesh)
+	{
+		MeshCodec::Options options;
+		options.positionBits = 16;
+		options.normalBits = 10;
+		options.textureCoordBits = 12;
+
+		MemoryBlock encoded, lossless;
+		MeshCodec::encode(mesh, options, encoded);
+		MeshCodec::encode(mesh, MeshCodec::Options(), lossless);
+
+		Mesh decoded;
+		expect(MeshCodec::decode(encoded.getData(), encoded.getSize(), decoded));
+
+		// A handful of vertices don't make up for the minimum and step stored with each component
+		if (mesh.vertices.size() >= 64)
+			expect(encoded.getSize() < lossless.getSize(), "Quantising didn't make the block smaller");
+
+		expectWithinHalfAStep(decoded.vertices, mesh.vertices, options.positionBits);
+		expectWithinHalfAStep(decoded.normals, mesh.normals, options.normalBits);
+		expectWithinHalfAStep(decoded.textureCoords, mesh.textureCoords, options.textureCoordBits);
+		expectSameTopology(decoded, mesh);
+	}
+
+	/** Checks each component against the step the encoder spreads the bits over its range with,
+		allowing a little for the float arithmetic on either side.
+	*/
+	template <typename ElementType>
+	void expectWithinHalfAStep(const Array<ElementType>& decoded, const Array<ElementType>& original, int bits)
+	{
+		const int numComponents = sizeof(ElementType) / sizeof(float);
+		expectEquals(decoded.size(), original.size());
+
+		if (decoded.size() != original.size())
+			return;
+
+		auto* a = reinterpret_cast<const float*> (decoded.begin());
+		auto* b = reinterpret_cast<const float*> (original.begin());
+		auto numOutside = 0;
+
+		for (auto c = 0; c < numComponents; ++c)
+		{
+			auto low = std::numeric_limits<float>::max(), high = -low;
+
+			for (auto i = 0; i < original.size(); ++i)
+			{
+				low = jmin(low, b[i * numComponents + c]);
+				high = jmax(high, b[i * numComponents + c]);
+			}
+
+			auto step = (high - low) / (float)((1 << bits) - 1);
+			auto tolerance = step * 0.5f + 1.0e-6f * jmax(std::abs(low), std::abs(high));
+
+			for (auto i = 0; i < original.size(); ++i)
+				if (std::abs(a[i * numComponents + c] - b[i * numComponents + c]) > tolerance)
+					++numOutside;
+		}
+
+		expectEquals(numOutside, 0, "Components more than half a step out");
+	}
+
+	/** Encodes a run of values and decodes it with and without SSSE3. */
+	void checkDecodersAgree(const juce::uint32* values, int numValues)
+	{
+		MemoryOutputStream out;
+		MeshCodec::encodeValues(values, numValues, out);
+
+		HeapBlock<juce::uint32> scalar((size_t)jmax(1, numValues)), ssse3((size_t)jmax(1, numValues));
+		auto* start = static_cast<const juce::uint8*> (out.getData());
+		auto* end = start + out.getDataSize();
+
+		auto* p = start;
+		expect(MeshCodec::decodeValues(p, end, numValues, scalar, false));
+		expect(p == end);
+
+		p = start;
+		expect(MeshCodec::decodeValues(p, end, numValues, ssse3, true));
+		expect(p == end);
+
+		expect(numValues == 0 || memcmp(scalar, values, sizeof(juce::uint32) * (size_t)numValues) == 0);
+		expect(numValues == 0 || memcmp(ssse3, values, sizeof(juce::uint32) * (size_t)numValues) == 0);
+
+		// A flipped bit in a control byte changes the total length, which both have to notice.
+		// The first and last few control bytes are enough to cover both loops.
+		MemoryBlock damaged(out.getData(), out.getDataSize());
+		auto* control = static_cast<juce::uint8*> (damaged.getData()) + 4;
+		auto* damagedStart = static_cast<const juce::uint8*> (damaged.getData());
+		auto* damagedEnd = damagedStart + damaged.getSize();
+		auto numControlBytes = (numValues + 3) / 4, numMissed = 0;
+
+		for (auto byte = 0; byte < numControlBytes; ++byte)
+		{
+			if (byte >= 16 && byte < numControlBytes - 4)
+				continue;
+
+			// The padding bits after the last value aren't read
+			auto numBits = jmin(8, (numValues - byte * 4) * 2);
+
+			for (auto bit = 0; bit < numBits; ++bit)
+			{
+				control[byte] ^= (juce::uint8)(1 << bit);
+
+				for (auto allowSSSE3 : { false, true })
+				{
+					p = damagedStart;
+
+					if (MeshCodec::decodeValues(p, damagedEnd, numValues, scalar, allowSSSE3))
+						++numMissed;
+				}
+
+				control[byte] ^= (juce::uint8)(1 << bit);
+			}
+		}
+
+		expectEquals(numMissed, 0);
+	}
+
+	/** Cuts the block short, at about 2000 lengths spread through it and at each of the last
+		64, and flips each bit of the header, none of which may decode. Then flips random bits anywhere, which mostly can't be caught (a flipped
+		bit in a position's data is just a different position), but mustn't ever read outside
+		the block or leave an index that's out of range.
+	*/
+	void checkDamagedBlocks(const Mesh& mesh)
+	{
+		MemoryBlock encoded;
+		MeshCodec::encode(mesh, MeshCodec::Options(), encoded);
+
+		const auto size = encoded.getSize();
+		auto* bytes = static_cast<const juce::uint8*> (encoded.getData());
+		Mesh decoded;
+
+		// Each length gets its own copy of the bytes, so reading past the end shows up in a
+		// memory checker
+		auto numTruncatedDecoded = 0;
+		auto stride = jmax((size_t)1, size / 2000);
+
+		for (size_t length = 0; length < size; length += (length + 64 < size ? stride : 1))
+		{
+			HeapBlock<juce::uint8> truncated(jmax((size_t)1, length));
+			memcpy(truncated, bytes, length);
+
+			if (MeshCodec::decode(truncated, length, decoded))
+				++numTruncatedDecoded;
+		}
+
+		expectEquals(numTruncatedDecoded, 0);
+
+		// The magic, version, counts and meshlet size
+		const auto headerSize = (size_t)(4 * 9);
+		MemoryBlock damaged(encoded);
+		auto* damagedBytes = static_cast<juce::uint8*> (damaged.getData());
+		auto numHeaderFlipsDecoded = 0;
+
+		for (size_t bit = 0; bit < headerSize * 8; ++bit)
+		{
+			damagedBytes[bit / 8] ^= (juce::uint8)(1 << (bit % 8));
+
+			if (MeshCodec::decode(damagedBytes, size, decoded))
+				++numHeaderFlipsDecoded;
+
+			damagedBytes[bit / 8] ^= (juce::uint8)(1 << (bit % 8));
+		}
+
+		expectEquals(numHeaderFlipsDecoded, 0);
+
+		Random random(0xf11b);
+		auto numCaught = 0, numBadIndices = 0;
+		const auto numFlips = 200;
+
+		for (auto n = 0; n < numFlips; ++n)
+		{
+			auto bit = (size_t)random.nextInt64() % (size * 8);
+			damagedBytes[bit / 8] ^= (juce::uint8)(1 << (bit % 8));
+
+			if (!MeshCodec::decode(damagedBytes, size, decoded))
+				++numCaught;
+			else
+				for (auto index : decoded.indices)
+					if (index >= (juce::uint32)decoded.vertices.size())
+						++numBadIndices;
+
+			damagedBytes[bit / 8] ^= (juce::uint8)(1 << (bit % 8));
+		}
+
+		logMessage(String(numCaught) + " of " + String(numFlips) + " random bit flips were caught");
+		expectEquals(numBadIndices, 0);
+	}
+};
+
+static MeshCodecTests meshCodecTests;
@@ -0,0 +1,87 @@
+/*
+==============================================================================
+
+ObjParserBenchmark.h
+Created: 16 October 2026 10:05pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we declare the headless benchmark for the WavefrontObjFile parser.
+*/
+
+#ifndef OBJPARSERBENCHMARK_H_INCLUDED
+#define OBJPARSERBENCHMARK_H_INCLUDED
+
+#pragma once
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/** Set this to 1 in the preprocessor definitions (the project's Benchmark configurations do)
+	to have the benchmark count heap allocations. That replaces malloc() or operator new for the
+	whole app, so it's left out of the normal builds.
+*/
+#ifndef OBJ_PARSER_BENCHMARK_COUNTS_ALLOCATIONS
+ #define OBJ_PARSER_BENCHMARK_COUNTS_ALLOCATIONS 0
+#endif
+
+
+
+//==============================================================================
+/**
+*  Parses the bundled models and a series of generated meshes (1M to 50M faces), and writes
+*  the results as JSON, so that runs from two builds can be diffed. It's started by launching
+*  the app with:
+*
+*      --benchmark-obj-parser [--runs N] [--threads N] [--max-faces N] [--optimise-meshes]
+*                             [--generate-normals] [--ordered-index-map] [--no-mmap]
+*                             [--output results.json] [--keep-generated]
+*                             [--expect earlier-results.json]
+*
+*  in which case no window is created and the app quits when the benchmark is done, returning
+*  0 if every file loaded. Each model is loaded --runs times (3 by default) and the fastest
+*  run is reported, with its throughput, its per-phase times, the number of heap allocations
+*  it made (in builds that count them), and the process's peak resident memory. With
+*  --optimise-meshes, the shapes also go through MeshOptimiser, and the results include their
+*  ACMR before and after. With --generate-normals, the models without vn records are given
+*  normals by NormalGenerator.
+*
+*  --ordered-index-map and --no-mmap switch the parser back to its older paths, so that they
+*  can be timed against the current ones: the std::map de-duplication (see
+*  LoadOptions::useOrderedIndexMap), and reading the file into a String and splitting it into
+*  lines rather than parsing the memory-mapped bytes (see LoadOptions::useMemoryMappedFile).
+*  Both settings are written to the results, next to the others.
+*
+*  Every model's results also describe what was loaded: the numbers of shapes, vertices and
+*  indices, and a hash of the shapes' names, vertices and indices, so that a diff between
+*  builds shows a change in the parser's output as well as in its speed. Given --expect and
+*  the results of an earlier run with the same options, the benchmark compares the two and
+*  returns 1 if any model that's in both came out differently.
+*
+*  The generated meshes are written to the temp directory, and are deleted after use unless
+*  --keep-generated is given, in which case later runs reuse them.
+*/
+struct ObjParserBenchmark
+{
+	static bool isBenchmarkCommand(const String& commandLine);
+
+	/** Runs the benchmark and returns the process exit code. */
+	static int run(const String& commandLine);
+
+	/** The number of heap allocations the process has made so far, or -1 if this build
+		doesn't count them. Where malloc() can be intercepted (glibc) this counts every
+		allocation; elsewhere it only counts operator new.
+	*/
+	static int64 getNumHeapAllocations() noexcept;
+
+	/** The highest resident memory the process has used, in bytes, since the last call to
+		resetPeakResidentMemory(), or since it started where that can't be reset.
+	*/
+	static int64 getPeakResidentMemory();
+	static void resetPeakResidentMemory();
+};
+
+
+#endif  // OBJPARSERBENCHMARK_H_INCLUDED
@@ -0,0 +1,85 @@
+/*
+==============================================================================
+
+ObjTextScanningTests.cpp
+Created: 17 October 2026 11:40pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we check ObjTextScanning::readFloat() against the number reader the parser
+*  used before it, CharacterFunctions::readDoubleValue(), on the bundled models.
+*/
+
+#include "ProjectUnitTests.h"
+#include "../MainComponent.h"
+
+
+//==============================================================================
+class ObjTextScanningTests  : public UnitTest
+{
+public:
+	ObjTextScanningTests() : UnitTest("ObjTextScanning", ProjectUnitTests::getCategory()) {}
+
+	void runTest() override
+	{
+		for (auto* name : { "humanoid_quad.obj", "humanoid_tri.obj", "teapot.obj", "slot_machine.obj" })
+		{
+			beginTest(String("readFloat() matches readDoubleValue() in ") + name);
+
+			auto lines = StringArray::fromLines(OpenGLView::findResourceFile(name).loadFileAsString());
+			auto numNumbers = 0, numDifferent = 0;
+
+			for (auto& line : lines)
+			{
+				if (!(line.startsWith("v ") || line.startsWith("vt ") || line.startsWith("vn ")))
+					continue;
+
+				auto tokens = StringArray::fromTokens(line.fromFirstOccurrenceOf(" ", false, false), false);
+				tokens.removeEmptyStrings();
+
+				for (auto& token : tokens)
+				{
+					++numNumbers;
+
+					if (!readsTheSame(token))
+						if (++numDifferent <= 10)
+							logMessage(String(name) + ": " + token + " reads differently");
+				}
+			}
+
+			expect(numNumbers > 0, String("No numbers read from ") + name);
+			expectEquals(numDifferent, 0);
+		}
+	}
+
+private:
+	/** True if readFloat() gives the same bits as the parser's old (float) readDoubleValue(),
+		and stops at the same place.
+	*/
+	static bool readsTheSame(const String& token)
+	{
+		// The String's terminating null is the unreadable-as-a-number byte readFloat() needs
+		auto* start = token.toRawUTF8();
+		auto* end = start + token.getNumBytesAsUTF8();
+		auto* t = start;
+		auto value = ObjTextScanning::readFloat(t, end);
+
+		auto reference = token.getCharPointer();
+		auto expected = (float)CharacterFunctions::readDoubleValue(reference);
+
+		return getBits(value) == getBits(expected)
+			&& (int)(t - start) == (int)(reference.getAddress() - token.getCharPointer().getAddress());
+	}
+
+	static juce::uint32 getBits(float value) noexcept
+	{
+		juce::uint32 bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+};
+
+static ObjTextScanningTests objTextScanningTests;
@@ -0,0 +1,57 @@
+/*
+==============================================================================
+
+ProjectUnitTests.cpp
+Created: 17 October 2026 11:40pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+#include "ProjectUnitTests.h"
+#include <iostream>
+
+
+namespace
+{
+	/** Prints the test output to stderr, since there's no window to show it in. */
+	struct ConsoleTestRunner  : public UnitTestRunner
+	{
+		void logMessage(const String& message) override
+		{
+			std::cerr << message.toRawUTF8() << std::endl;
+		}
+	};
+}
+
+//==============================================================================
+bool ProjectUnitTests::isUnitTestCommand(const String& commandLine)
+{
+	return StringArray::fromTokens(commandLine, true).contains("--run-unit-tests");
+}
+
+int ProjectUnitTests::run(const String& commandLine)
+{
+	auto args = StringArray::fromTokens(commandLine, true);
+	args.trim();
+	args.removeEmptyStrings();
+
+	auto categoryIndex = args.indexOf("--category");
+	auto category = isPositiveAndBelow(categoryIndex + 1, args.size()) && categoryIndex >= 0 ? args[categoryIndex + 1]
+																							: String(getCategory());
+
+	ConsoleTestRunner runner;
+	runner.setAssertOnFailure(false);
+	runner.runTestsInCategory(category);
+
+	auto numTests = runner.getNumResults();
+	auto numFailures = 0;
+
+	for (auto i = 0; i < numTests; ++i)
+		numFailures += runner.getResult(i)->failures;
+
+	std::cerr << (numTests == 0 ? String("No tests in category " + category)
+								: String(numTests) + " tests, " + String(numFailures) + " failures").toRawUTF8() << std::endl;
+
+	return numTests > 0 && numFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+/*
+==============================================================================
+
+ProjectUnitTests.h
+Created: 17 October 2026 11:40pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we declare the headless runner for the project's unit tests.
+*/
+
+#ifndef PROJECTUNITTESTS_H_INCLUDED
+#define PROJECTUNITTESTS_H_INCLUDED
+
+#pragma once
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+
+
+//==============================================================================
+/**
+*  Runs the juce::UnitTest classes in Source/Tests, which check the mesh code against the
+*  bundled models. It's started by launching the app with:
+*
+*      --run-unit-tests [--category name]
+*
+*  in which case no window is created, each test's results are printed, and the app quits
+*  when they're done, returning 0 if every test passed. With --category, only the tests in
+*  that category run. Every test in this project is in the "Mesh" category, so that JUCE's
+*  own tests (in builds with JUCE_UNIT_TESTS) can be left out.
+*/
+struct ProjectUnitTests
+{
+	static bool isUnitTestCommand(const String& commandLine);
+
+	/** Runs the tests and returns the process exit code. */
+	static int run(const String& commandLine);
+
+	/** The category that every test in Source/Tests is registered in. */
+	static const char* getCategory() noexcept       { return "Mesh"; }
+};
+
+
+#endif  // PROJECTUNITTESTS_H_INCLUDED
@@ -8,15 +8,533 @@
   ==============================================================================
 */
 
-//TODO 
 /**
-*  Come up with several edge cases
-*  Use Google Mock to test functionality
-*  work in-progress
+*  In this module, we define the headless OBJ parser benchmark declared in
+*  ObjParserBenchmark.h, and the allocation counting it can be built with.
 */
 
+#include "ObjParserBenchmark.h"
+#include "../MainComponent.h"
+#include <iostream>
+#include <limits>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
 
-class Test
+#if JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+ #include <psapi.h>
+ #pragma comment (lib, "psapi.lib")
+#else
+ #include <sys/resource.h>
+#endif
+
+
+#if OBJ_PARSER_BENCHMARK_COUNTS_ALLOCATIONS
+//==============================================================================
+// Allocation counting for the benchmark. With glibc, the executable can replace malloc() and
+// friends, which catches juce::HeapBlock (and so every juce::Array) as well as operator new,
+// which calls malloc(). Elsewhere, only operator new can be replaced portably.
+//
+// Each thread counts into its own slot, on its own cache line, so the parser's threads don't
+// fight over one counter while they're being timed; the slots are only added up when the
+// benchmark asks for the total. Threads beyond the last slot share one atomic counter.
+namespace
+{
+	enum { maxCountingThreads = 256 };
+
+	struct alignas (64) AllocationCounter
+	{
+		std::atomic<int64> count;
+	};
+
+	AllocationCounter allocationCounters[maxCountingThreads];
+	AllocationCounter sharedAllocationCounter;
+	std::atomic<int> numCountingThreads(0);
+
+	// A plain int, so that giving a thread its slot never allocates
+	thread_local int allocationCounterSlot = -1;
+
+	inline void countHeapAllocation() noexcept
+	{
+		if (allocationCounterSlot < 0)
+			allocationCounterSlot = numCountingThreads.fetch_add(1, std::memory_order_relaxed);
+
+		if (allocationCounterSlot < maxCountingThreads)
+		{
+			// Only this thread writes its slot, so it needs no locked instruction
+			auto& count = allocationCounters[allocationCounterSlot].count;
+			count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+		else
+		{
+			sharedAllocationCounter.count.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+#if JUCE_LINUX && defined (__GLIBC__)
+ #define OBJ_BENCHMARK_COUNTS_MALLOC 1
+
+extern "C"
+{
+	void* __libc_malloc(size_t);
+	void* __libc_calloc(size_t, size_t);
+	void* __libc_realloc(void*, size_t);
+
+	void* malloc(size_t size) noexcept                      { countHeapAllocation(); return __libc_malloc(size); }
+	void* calloc(size_t num, size_t size) noexcept          { countHeapAllocation(); return __libc_calloc(num, size); }
+	void* realloc(void* ptr, size_t size) noexcept          { countHeapAllocation(); return __libc_realloc(ptr, size); }
+}
+#else
+ #define OBJ_BENCHMARK_COUNTS_MALLOC 0
+
+void* operator new (size_t size)
+{
+	countHeapAllocation();
+
+	if (auto* p = std::malloc(size > 0 ? size : 1))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void* operator new (size_t size, const std::nothrow_t&) noexcept
+{
+	countHeapAllocation();
+	return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[] (size_t size)                                      { return operator new (size); }
+void* operator new[] (size_t size, const std::nothrow_t& nt) noexcept   { return operator new (size, nt); }
+
+void operator delete (void* p) noexcept                                 { std::free(p); }
+void operator delete[] (void* p) noexcept                               { std::free(p); }
+void operator delete (void* p, size_t) noexcept                         { std::free(p); }
+void operator delete[] (void* p, size_t) noexcept                       { std::free(p); }
+void operator delete (void* p, const std::nothrow_t&) noexcept          { std::free(p); }
+void operator delete[] (void* p, const std::nothrow_t&) noexcept        { std::free(p); }
+#endif
+
+int64 ObjParserBenchmark::getNumHeapAllocations() noexcept
 {
-    //This is where my google tests will go when I have more time
-};
\ No newline at end of file
+	auto total = sharedAllocationCounter.count.load(std::memory_order_relaxed);
+
+	for (auto& counter : allocationCounters)
+		total += counter.count.load(std::memory_order_relaxed);
+
+	return total;
+}
+#else
+int64 ObjParserBenchmark::getNumHeapAllocations() noexcept
+{
+	return -1;
+}
+#endif
+
+//==============================================================================
+int64 ObjParserBenchmark::getPeakResidentMemory()
+{
+   #if JUCE_WINDOWS
+	PROCESS_MEMORY_COUNTERS counters;
+
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return (int64)counters.PeakWorkingSetSize;
+
+	return 0;
+   #else
+	#if JUCE_LINUX
+	// VmHWM can be reset (see below), unlike ru_maxrss
+	if (auto* status = std::fopen("/proc/self/status", "r"))
+	{
+		char line[256];
+		long long kilobytes = -1;
+
+		while (kilobytes < 0 && std::fgets(line, sizeof(line), status) != nullptr)
+			if (std::sscanf(line, "VmHWM: %lld kB", &kilobytes) != 1)
+				kilobytes = -1;
+
+		std::fclose(status);
+
+		if (kilobytes >= 0)
+			return (int64)kilobytes * 1024;
+	}
+	#endif
+
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	#if JUCE_MAC
+	return (int64)usage.ru_maxrss;
+	#else
+	return (int64)usage.ru_maxrss * 1024;
+	#endif
+   #endif
+}
+
+void ObjParserBenchmark::resetPeakResidentMemory()
+{
+   #if JUCE_LINUX
+	if (auto* clearRefs = std::fopen("/proc/self/clear_refs", "w"))
+	{
+		std::fputs("5", clearRefs);
+		std::fclose(clearRefs);
+	}
+   #endif
+}
+
+//==============================================================================
+namespace
+{
+	/** Writes a grid of quads, each split into two triangles, with a position and texture
+		coordinate per grid point, one shared normal, and the faces cut into 16 groups.
+	*/
+	bool writeGridMesh(const File& file, int64 numFaces)
+	{
+		const int64 columns = 1000;
+		const auto rows = (numFaces / 2 + columns - 1) / columns;
+		const auto numGroups = 16;
+
+		file.deleteFile();
+		FileOutputStream out(file);
+
+		if (out.failedToOpen())
+			return false;
+
+		char line[160];
+
+		auto writeLine = [&] (int length)
+		{
+			out.write(line, (size_t)length);
+		};
+
+		for (int64 r = 0; r <= rows; ++r)
+			for (int64 c = 0; c <= columns; ++c)
+				writeLine(std::snprintf(line, sizeof(line), "v %.4f %.4f %.4f\n",
+										(double)c * 0.01, (double)r * 0.01, (double)((r * 7 + c * 13) % 100) * 0.001));
+
+		for (int64 r = 0; r <= rows; ++r)
+			for (int64 c = 0; c <= columns; ++c)
+				writeLine(std::snprintf(line, sizeof(line), "vt %.5f %.5f\n",
+										(double)c / (double)columns, (double)r / (double)rows));
+
+		writeLine(std::snprintf(line, sizeof(line), "vn 0 0 1\n"));
+
+		int64 numWritten = 0;
+
+		for (int64 r = 0; r < rows && numWritten < numFaces; ++r)
+		{
+			if (r % jmax((int64)1, rows / numGroups) == 0)
+				writeLine(std::snprintf(line, sizeof(line), "g part%lld\n", (long long)(r / jmax((int64)1, rows / numGroups))));
+
+			for (int64 c = 0; c < columns && numWritten < numFaces; ++c)
+			{
+				auto a = (long long)(r * (columns + 1) + c + 1);
+				auto b = a + 1;
+				auto d = a + (long long)(columns + 1);
+				auto e = d + 1;
+
+				writeLine(std::snprintf(line, sizeof(line), "f %lld/%lld/1 %lld/%lld/1 %lld/%lld/1\n", a, a, b, b, e, e));
+
+				if (++numWritten < numFaces)
+					writeLine(std::snprintf(line, sizeof(line), "f %lld/%lld/1 %lld/%lld/1 %lld/%lld/1\n", a, a, e, e, d, d));
+
+				++numWritten;
+			}
+		}
+
+		out.flush();
+		return out.getStatus().wasOk();
+	}
+
+	String getArgumentValue(const StringArray& args, const String& name, const String& defaultValue)
+	{
+		auto index = args.indexOf(name);
+		return isPositiveAndBelow(index + 1, args.size()) && index >= 0 ? args[index + 1] : defaultValue;
+	}
+
+	void log(const String& message)
+	{
+		std::cerr << message.toRawUTF8() << std::endl;
+	}
+
+	/** 64-bit FNV-1a over a run of bytes, continuing from hash. */
+	juce::uint64 addToHash(juce::uint64 hash, const void* data, size_t numBytes) noexcept
+	{
+		auto* bytes = static_cast<const juce::uint8*> (data);
+
+		for (size_t i = 0; i < numBytes; ++i)
+			hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+
+		return hash;
+	}
+
+	/** Describes what a load produced: how big it is, and a hash of the shapes' names,
+		vertices, normals, texture coordinates and indices, in order.
+	*/
+	var describeOutput(const WavefrontObjFile& model)
+	{
+		juce::uint64 hash = 0xcbf29ce484222325ull;
+		int64 numVertices = 0, numIndices = 0;
+
+		for (auto* shape : model.shapes)
+		{
+			auto& mesh = shape->mesh;
+			hash = addToHash(hash, shape->name.toRawUTF8(), shape->name.getNumBytesAsUTF8() + 1);
+			hash = addToHash(hash, mesh.vertices.begin(), (size_t)mesh.vertices.size() * sizeof(WavefrontObjFile::Vertex));
+			hash = addToHash(hash, mesh.normals.begin(), (size_t)mesh.normals.size() * sizeof(WavefrontObjFile::Vertex));
+			hash = addToHash(hash, mesh.textureCoords.begin(), (size_t)mesh.textureCoords.size() * sizeof(WavefrontObjFile::TextureCoord));
+			hash = addToHash(hash, mesh.indices.begin(), (size_t)mesh.indices.size() * sizeof(WavefrontObjFile::Index));
+
+			numVertices += mesh.vertices.size();
+			numIndices += mesh.indices.size();
+		}
+
+		auto* output = new DynamicObject();
+		output->setProperty("shapes", model.shapes.size());
+		output->setProperty("vertices", numVertices);
+		output->setProperty("indices", numIndices);
+
+		// As a string, since a JSON number can't hold all 64 bits
+		output->setProperty("hash", String::toHexString((int64)hash));
+		return var(output);
+	}
+
+	/** Compares each model's output with the one of the same name in an earlier run's
+		results, and returns the number that differ.
+	*/
+	int compareOutputs(const Array<var>& models, const var& expectedResults)
+	{
+		auto numDifferent = 0;
+
+		if (auto* expectedModels = expectedResults["models"].getArray())
+		{
+			for (auto& model : models)
+			{
+				for (auto& expected : *expectedModels)
+				{
+					if (expected["name"].toString() != model["name"].toString())
+						continue;
+
+					auto output = model["output"], expectedOutput = expected["output"];
+
+					for (auto* property : { "shapes", "vertices", "indices", "hash" })
+					{
+						if (output[property].toString() != expectedOutput[property].toString())
+						{
+							log(model["name"].toString() + ": " + property + " is " + output[property].toString()
+								+ ", expected " + expectedOutput[property].toString());
+							++numDifferent;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		return numDifferent;
+	}
+
+	/** Loads a file numRuns times, and returns the results of the fastest run. */
+	var benchmarkFile(const File& file, const String& name, const WavefrontObjFile::LoadOptions& options,
+					  int numRuns, bool& allLoaded)
+	{
+		auto* result = new DynamicObject();
+		var resultVar(result);
+		result->setProperty("name", name);
+
+		auto bestSeconds = std::numeric_limits<double>::max();
+
+		for (auto run = 0; run < numRuns; ++run)
+		{
+			std::unique_ptr<WavefrontObjFile> model(new WavefrontObjFile());
+
+			ObjParserBenchmark::resetPeakResidentMemory();
+			auto allocationsBefore = ObjParserBenchmark::getNumHeapAllocations();
+			auto start = Time::getHighResolutionTicks();
+
+			auto loadResult = model->load(file, options);
+
+			auto seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+			auto numAllocations = allocationsBefore < 0 ? (int64)-1 : ObjParserBenchmark::getNumHeapAllocations() - allocationsBefore;
+			auto peakMemory = ObjParserBenchmark::getPeakResidentMemory();
+
+			if (loadResult.failed())
+			{
+				log(name + ": " + loadResult.getErrorMessage());
+				result->setProperty("error", loadResult.getErrorMessage());
+				allLoaded = false;
+				return resultVar;
+			}
+
+			if (seconds >= bestSeconds)
+				continue;
+
+			bestSeconds = seconds;
+
+			auto& stats = model->getLoadStatistics();
+			int64 numIndices = 0;
+
+			for (auto* shape : model->shapes)
+				numIndices += shape->mesh.indices.size();
+
+			auto* phases = new DynamicObject();
+			phases->setProperty("read", stats.readSeconds);
+			phases->setProperty("tokenize", stats.tokenizeSeconds);
+			phases->setProperty("groupBuild", stats.groupBuildSeconds);
+			phases->setProperty("dedup", stats.dedupSeconds);
+
+			if (options.generateNormals)
+				phases->setProperty("normals", stats.normalSeconds);
+
+			if (options.optimiseMeshes)
+			{
+				phases->setProperty("optimise", stats.optimiseSeconds);
+				result->setProperty("acmrBefore", stats.acmrBefore);
+				result->setProperty("acmrAfter", stats.acmrAfter);
+			}
+
+			result->setProperty("bytes", stats.numBytes);
+			result->setProperty("faces", stats.numFaces);
+			result->setProperty("triangles", numIndices / 3);
+			result->setProperty("shapes", model->shapes.size());
+			result->setProperty("seconds", seconds);
+			result->setProperty("mbPerSecond", (double)stats.numBytes / (1000.0 * 1000.0) / seconds);
+			result->setProperty("facesPerSecond", (double)stats.numFaces / seconds);
+			result->setProperty("output", describeOutput(*model));
+
+			if (numAllocations >= 0)
+				result->setProperty("heapAllocations", numAllocations);
+
+			result->setProperty("arenaAllocations", stats.arena.numAllocations);
+			result->setProperty("arenaBlocks", stats.arena.numBlocks);
+			result->setProperty("peakResidentBytes", peakMemory);
+			result->setProperty("phases", var(phases));
+		}
+
+		log(name + ": " + String(bestSeconds * 1000.0, 1) + " ms, "
+			+ String((double)result->getProperty("mbPerSecond"), 1) + " MB/s"
+			+ (result->hasProperty("heapAllocations") ? ", " + result->getProperty("heapAllocations").toString() + " allocations" : String()));
+
+		return resultVar;
+	}
+}
+
+//==============================================================================
+bool ObjParserBenchmark::isBenchmarkCommand(const String& commandLine)
+{
+	return StringArray::fromTokens(commandLine, true).contains("--benchmark-obj-parser");
+}
+
+int ObjParserBenchmark::run(const String& commandLine)
+{
+	auto args = StringArray::fromTokens(commandLine, true);
+	args.trim();
+	args.removeEmptyStrings();
+
+	auto numRuns = jmax(1, getArgumentValue(args, "--runs", "3").getIntValue());
+	auto maxFaces = getArgumentValue(args, "--max-faces", "50000000").getLargeIntValue();
+	auto outputFile = getArgumentValue(args, "--output", String());
+	auto keepGenerated = args.contains("--keep-generated");
+	auto expectedFile = getArgumentValue(args, "--expect", String());
+
+	WavefrontObjFile::LoadOptions options;
+	options.numThreads = getArgumentValue(args, "--threads", "0").getIntValue();
+	options.optimiseMeshes = args.contains("--optimise-meshes");
+	options.generateNormals = args.contains("--generate-normals");
+	options.useOrderedIndexMap = args.contains("--ordered-index-map");
+	options.useMemoryMappedFile = !args.contains("--no-mmap");
+
+	auto allLoaded = true;
+	Array<var> models;
+
+	for (auto* name : { "humanoid_quad.obj", "humanoid_tri.obj", "teapot.obj", "slot_machine.obj" })
+		models.add(benchmarkFile(OpenGLView::findResourceFile(name), name, options, numRuns, allLoaded));
+
+	auto generatedFolder = File::getSpecialLocation(File::tempDirectory).getChildFile("ObjParserBenchmark");
+	generatedFolder.createDirectory();
+
+	for (auto numFaces : { (int64)1000000, (int64)5000000, (int64)10000000, (int64)25000000, (int64)50000000 })
+	{
+		if (numFaces > maxFaces)
+			break;
+
+		auto name = "grid_" + String(numFaces / 1000000) + "M.obj";
+		auto file = generatedFolder.getChildFile(name);
+
+		if (!(keepGenerated && file.existsAsFile()))
+		{
+			log("Writing " + file.getFullPathName());
+
+			if (!writeGridMesh(file, numFaces))
+			{
+				log("Couldn't write " + file.getFullPathName());
+				allLoaded = false;
+				continue;
+			}
+		}
+
+		models.add(benchmarkFile(file, name, options, numRuns, allLoaded));
+
+		if (!keepGenerated)
+			file.deleteFile();
+	}
+
+	auto* results = new DynamicObject();
+	var resultsVar(results);
+	results->setProperty("benchmark", "ObjParser");
+	results->setProperty("version", ProjectInfo::versionString);
+	results->setProperty("parserVersion", (int)WavefrontObjFile::parserVersion);
+	results->setProperty("threads", options.numThreads > 0 ? options.numThreads : SystemStats::getNumCpus());
+	results->setProperty("runs", numRuns);
+	results->setProperty("optimiseMeshes", options.optimiseMeshes);
+	results->setProperty("generateNormals", options.generateNormals);
+	results->setProperty("useOrderedIndexMap", options.useOrderedIndexMap);
+	results->setProperty("useMemoryMappedFile", options.useMemoryMappedFile);
+   #if OBJ_PARSER_BENCHMARK_COUNTS_ALLOCATIONS
+	results->setProperty("allocationCounter", OBJ_BENCHMARK_COUNTS_MALLOC ? "malloc" : "operator new");
+   #else
+	results->setProperty("allocationCounter", "none");
+   #endif
+	results->setProperty("models", models);
+
+	auto json = JSON::toString(resultsVar);
+
+	if (outputFile.isNotEmpty())
+	{
+		auto f = File::getCurrentWorkingDirectory().getChildFile(outputFile);
+
+		if (!f.replaceWithText(json))
+		{
+			log("Couldn't write " + f.getFullPathName());
+			return 1;
+		}
+	}
+	else
+	{
+		std::cout << json.toRawUTF8() << std::endl;
+	}
+
+	auto outputsMatch = true;
+
+	if (expectedFile.isNotEmpty())
+	{
+		auto expected = JSON::parse(File::getCurrentWorkingDirectory().getChildFile(expectedFile));
+
+		if (expected.isVoid())
+		{
+			log("Couldn't read " + expectedFile);
+			return 1;
+		}
+
+		auto numDifferent = compareOutputs(models, expected);
+		outputsMatch = (numDifferent == 0);
+		log(outputsMatch ? String("Every model's output matches " + expectedFile)
+						 : String(numDifferent) + " models' output differs from " + expectedFile);
+	}
+
+	return allLoaded && outputsMatch ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+/*
+==============================================================================
+
+TriangleBvhTests.cpp
+Created: 17 October 2026 11:40pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we check TriangleBvh::intersect() against testing every triangle, on the
+*  bundled models and on a run of ever smaller triangles that makes a lopsided tree.
+*/
+
+#include "ProjectUnitTests.h"
+#include "../MainComponent.h"
+
+
+//==============================================================================
+class TriangleBvhTests  : public UnitTest
+{
+public:
+	TriangleBvhTests() : UnitTest("TriangleBvh", ProjectUnitTests::getCategory()) {}
+
+	void runTest() override
+	{
+		for (auto* name : { "humanoid_quad.obj", "teapot.obj", "slot_machine.obj" })
+		{
+			beginTest(String("Random rays against every triangle in ") + name);
+
+			WavefrontObjFile model;
+			expect(model.load(OpenGLView::findResourceFile(name)).wasOk());
+
+			Array<TriangleBvh::Part> parts;
+
+			for (auto* shape : model.shapes)
+				parts.add({ reinterpret_cast<const float*> (shape->mesh.vertices.begin()), shape->mesh.vertices.size(),
+							shape->mesh.indices.begin(), shape->mesh.indices.size() });
+
+			checkRandomRays(parts, 300);
+		}
+
+		beginTest("A lopsided tree");
+		{
+			// Each triangle is 0.9 times the size of the one before and sits right next to it,
+			// nearer the origin, so the heuristic keeps peeling the biggest ones off
+			const auto numTriangles = 200;
+			const auto ratio = 0.9f;
+			Array<float> positions;
+			Array<juce::uint32> indices;
+			auto size = 1.0f;
+
+			for (auto i = 0; i < numTriangles; ++i, size *= ratio)
+			{
+				for (auto v : { size, 0.0f, 0.0f,  size / ratio, 0.0f, 0.0f,  size, size * 0.05f, 0.0f })
+					positions.add(v);
+
+				for (auto c = 0; c < 3; ++c)
+					indices.add((juce::uint32)(i * 3 + c));
+			}
+
+			Array<TriangleBvh::Part> parts;
+			parts.add({ positions.begin(), positions.size() / 3, indices.begin(), indices.size() });
+
+			TriangleBvh bvh;
+			expect(bvh.build(parts, 1));
+			logMessage("Depth " + String(bvh.getStatistics().maxDepth));
+
+			// A ray straight down onto each triangle has to find that one
+			auto numWrong = 0;
+			size = 1.0f;
+
+			for (auto i = 0; i < numTriangles; ++i, size *= ratio)
+				if (bvh.intersect({ size * 1.05f, size * 0.01f, 1.0f }, { 0.0f, 0.0f, -1.0f }).triangle != i)
+					++numWrong;
+
+			expectEquals(numWrong, 0);
+			checkRandomRays(parts, 300);
+		}
+	}
+
+private:
+	/** Fires rays from well outside the parts' bounds at random points inside them, and
+		checks each hit against testing every triangle.
+	*/
+	void checkRandomRays(const Array<TriangleBvh::Part>& parts, int numRays)
+	{
+		TriangleBvh bvh;
+		expect(bvh.build(parts, 0));
+
+		const auto largest = std::numeric_limits<float>::max();
+		Vector3D<float> low(largest, largest, largest), high(-largest, -largest, -largest);
+
+		for (auto& part : parts)
+		{
+			for (auto i = 0; i < part.numVertices; ++i)
+			{
+				auto* p = part.positions + i * 3;
+				low = { jmin(low.x, p[0]), jmin(low.y, p[1]), jmin(low.z, p[2]) };
+				high = { jmax(high.x, p[0]), jmax(high.y, p[1]), jmax(high.z, p[2]) };
+			}
+		}
+
+		Random random(0x5eed);
+		auto size = high - low;
+		auto numHits = 0, numWrong = 0;
+
+		for (auto n = 0; n < numRays; ++n)
+		{
+			Vector3D<float> target(low.x + random.nextFloat() * size.x, low.y + random.nextFloat() * size.y,
+								   low.z + random.nextFloat() * size.z);
+			Vector3D<float> origin(target.x + (random.nextFloat() - 0.5f) * 10.0f * (size.x + 1.0f),
+								   target.y + (random.nextFloat() - 0.5f) * 10.0f * (size.y + 1.0f),
+								   target.z + (random.nextFloat() - 0.5f) * 10.0f * (size.z + 1.0f));
+
+			// Every tenth ray runs along an axis, where the boxes' slabs have zero components
+			if (n % 10 == 0)
+				origin = { origin.x, target.y, target.z };
+
+			auto direction = target - origin;
+			auto hit = bvh.intersect(origin, direction);
+			auto expected = intersectEveryTriangle(parts, origin, direction);
+
+			if (expected >= 0.0)
+				++numHits;
+
+			if ((expected < 0.0) != (hit.part < 0)
+				 || (expected >= 0.0 && std::abs(expected - hit.distance) > 1.0e-4 * jmax(1.0, expected)))
+				if (++numWrong <= 5)
+					logMessage("Ray " + String(n) + " hit at " + String(hit.distance) + ", expected " + String(expected));
+		}
+
+		logMessage(String(numHits) + " of " + String(numRays) + " rays hit");
+		expect(numHits > 0);
+		expectEquals(numWrong, 0);
+	}
+
+	/** The distance along the ray to the nearest triangle, worked out in doubles, or -1. */
+	static double intersectEveryTriangle(const Array<TriangleBvh::Part>& parts,
+										 const Vector3D<float>& origin, const Vector3D<float>& direction)
+	{
+		const double o[3] = { origin.x, origin.y, origin.z }, d[3] = { direction.x, direction.y, direction.z };
+		auto nearest = -1.0;
+
+		for (auto& part : parts)
+		{
+			for (auto t = 0; t + 2 < part.numIndices; t += 3)
+			{
+				const float* p[3];
+
+				for (auto c = 0; c < 3; ++c)
+					p[c] = part.positions + part.indices[t + c] * 3;
+
+				double e1[3], e2[3], s[3];
+
+				for (auto i = 0; i < 3; ++i)
+				{
+					e1[i] = p[1][i] - p[0][i];
+					e2[i] = p[2][i] - p[0][i];
+					s[i] = o[i] - p[0][i];
+				}
+
+				const double pv[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+				auto determinant = e1[0] * pv[0] + e1[1] * pv[1] + e1[2] * pv[2];
+
+				if (determinant == 0.0)
+					continue;
+
+				auto u = (s[0] * pv[0] + s[1] * pv[1] + s[2] * pv[2]) / determinant;
+
+				if (u < 0.0 || u > 1.0)
+					continue;
+
+				const double q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+				auto v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) / determinant;
+
+				if (v < 0.0 || u + v > 1.0)
+					continue;
+
+				auto distance = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) / determinant;
+
+				if (distance >= 0.0 && (nearest < 0.0 || distance < nearest))
+					nearest = distance;
+			}
+		}
+
+		return nearest;
+	}
+};
+
+static TriangleBvhTests triangleBvhTests;
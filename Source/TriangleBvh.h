@@ -0,0 +1,820 @@
+/*
+==============================================================================
+
+TriangleBvh.h
+Created: 17 October 2026 3:30pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define the bounding volume hierarchy that OpenGLView uses to find the
+*  triangle under the mouse.
+*/
+
+#ifndef TRIANGLEBVH_H_INCLUDED
+#define TRIANGLEBVH_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+#if JUCE_INTEL
+ #include <xmmintrin.h>
+#endif
+
+
+
+//==============================================================================
+/**
+*  A bounding volume hierarchy over the triangles of several indexed meshes (the parts), for
+*  finding the nearest triangle that a ray hits.
+*
+*  The tree is built top-down as a binary tree, splitting each node where the surface area
+*  heuristic says a ray will do the least work, estimated over a fixed number of bins along
+*  the node's longest axis. The first few levels are split on the calling thread until there
+*  are enough subtrees to go round, and the subtrees are then built in parallel.
+*
+*  The binary tree is then collapsed into one with four children per node, whose boxes are
+*  stored side by side so a ray can be tested against all four at once with SSE (or one by
+*  one, on processors without it).
+*
+*  The hierarchy keeps pointers to the parts' positions and indices, which must stay alive and
+*  unchanged until it's rebuilt or deleted.
+*/
+class TriangleBvh
+{
+public:
+	TriangleBvh() {}
+
+	/** An indexed triangle list. positions holds x, y and z for each of numVertices vertices. */
+	struct Part
+	{
+		const float* positions;
+		int numVertices;
+		const juce::uint32* indices;
+		int numIndices;
+	};
+
+	/** Builds the hierarchy, using up to numThreads threads (zero means one per CPU core).
+		Triangles with an index outside their part's vertices are left out.
+
+		If shouldCancel isn't null, it's checked between the nodes being split, and once it's
+		set the build stops, leaves the hierarchy empty and returns false.
+	*/
+	bool build(const Array<Part>& newParts, int numThreads, const std::atomic<bool>* shouldCancel = nullptr)
+	{
+		auto startTime = Time::getMillisecondCounterHiRes();
+
+		parts = newParts;
+		nodes.clear();
+		primitives.clear();
+		statistics = {};
+
+		if (numThreads <= 0)
+			numThreads = SystemStats::getNumCpus();
+
+		Array<Primitive> buildPrimitives;
+		collectPrimitives(buildPrimitives);
+
+		if (!buildPrimitives.isEmpty())
+		{
+			Array<BinaryNode> binaryNodes;
+
+			if (!buildBinaryTree(buildPrimitives, binaryNodes, numThreads, shouldCancel))
+			{
+				parts.clear();
+				statistics = {};
+				return false;
+			}
+
+			for (auto& p : buildPrimitives)
+				primitives.add({ p.part, p.triangle });
+
+			nodes.add(WideNode());
+			collapse(binaryNodes, 0, 0, 1);
+		}
+
+		statistics.numTriangles = primitives.size();
+		statistics.numNodes = nodes.size();
+		statistics.buildSeconds = (Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+		return true;
+	}
+
+	bool isEmpty() const noexcept    { return nodes.isEmpty(); }
+
+	/** Where a ray first met a triangle. part is -1 if it missed everything. */
+	struct Hit
+	{
+		int part, triangle;   // the triangle's first index is at triangle * 3 in the part's indices
+		float distance;       // in units of the ray's direction
+		float u, v;           // the barycentric coordinates of the hit on the triangle
+	};
+
+	/** Returns the nearest triangle, from either side, that the ray origin + t * direction
+		meets with 0 <= t <= maxDistance.
+	*/
+	Hit intersect(const Vector3D<float>& origin, const Vector3D<float>& direction,
+				  float maxDistance = std::numeric_limits<float>::max()) const
+	{
+		Hit hit = { -1, -1, maxDistance, 0.0f, 0.0f };
+
+		if (nodes.isEmpty())
+			return hit;
+
+		Ray ray(origin, direction);
+
+		// Each entry is a node and how far along the ray its box starts. Every node that's
+		// taken off puts back at most four children, one level down, so a tree maxDepth nodes
+		// deep never needs more than 3 * maxDepth + 1 entries. Nothing limits how deep the
+		// heuristic makes the tree, so one that won't fit on the call stack gets a heap block.
+		struct StackEntry { int node; float distance; };
+		StackEntry localStack[maxLocalStackSize];
+		HeapBlock<StackEntry> heapStack;
+		auto* stack = localStack;
+		const auto stackCapacity = 3 * statistics.maxDepth + 1;
+
+		if (stackCapacity > (int)maxLocalStackSize)
+		{
+			heapStack.malloc((size_t)stackCapacity);
+			stack = heapStack.get();
+		}
+
+		auto stackSize = 0;
+		stack[stackSize++] = { 0, 0.0f };
+
+		while (stackSize > 0)
+		{
+			auto entry = stack[--stackSize];
+
+			if (entry.distance > hit.distance)
+				continue;
+
+			auto& node = nodes.getReference(entry.node);
+			float distances[4];
+			auto hitMask = intersectBoxes(node, ray, hit.distance, distances);
+
+			// Push the children furthest first, so the nearest is tried first
+			int order[4];
+			auto numHit = 0;
+
+			for (auto i = 0; i < 4; ++i)
+			{
+				if ((hitMask & (1 << i)) == 0)
+					continue;
+
+				auto j = numHit++;
+
+				for (; j > 0 && distances[order[j - 1]] < distances[i]; --j)
+					order[j] = order[j - 1];
+
+				order[j] = i;
+			}
+
+			for (auto n = 0; n < numHit; ++n)
+			{
+				auto i = order[n];
+
+				if (node.numPrimitives[i] > 0)
+				{
+					for (auto p = node.child[i]; p < node.child[i] + node.numPrimitives[i]; ++p)
+						intersectTriangle(primitives.getReference(p), ray, hit);
+				}
+				else
+				{
+					jassert(stackSize < stackCapacity);
+					stack[stackSize++] = { node.child[i], distances[i] };
+				}
+			}
+		}
+
+		return hit;
+	}
+
+	struct Statistics
+	{
+		int numTriangles, numNodes;
+		int maxDepth;   // in four-wide nodes, counting the root as 1
+		double buildSeconds;
+	};
+
+	const Statistics& getStatistics() const noexcept    { return statistics; }
+
+private:
+	//==============================================================================
+	enum
+	{
+		numBins = 16,
+		minLeafSize = 4,      // ranges this small are never split
+		maxLeafSize = 16,     // ranges up to this size are only split if the heuristic says so
+		maxLocalStackSize = 256,
+		minPrimitivesPerTask = 4096
+	};
+
+	struct Box
+	{
+		Box() noexcept
+		{
+			for (auto i = 0; i < 3; ++i)
+			{
+				low[i] = std::numeric_limits<float>::max();
+				high[i] = -std::numeric_limits<float>::max();
+			}
+		}
+
+		void add(const float* p) noexcept
+		{
+			for (auto i = 0; i < 3; ++i)
+			{
+				low[i] = jmin(low[i], p[i]);
+				high[i] = jmax(high[i], p[i]);
+			}
+		}
+
+		void add(const Box& other) noexcept
+		{
+			for (auto i = 0; i < 3; ++i)
+			{
+				low[i] = jmin(low[i], other.low[i]);
+				high[i] = jmax(high[i], other.high[i]);
+			}
+		}
+
+		bool isEmpty() const noexcept    { return low[0] > high[0]; }
+
+		float getSurfaceArea() const noexcept
+		{
+			if (isEmpty())
+				return 0.0f;
+
+			auto x = high[0] - low[0], y = high[1] - low[1], z = high[2] - low[2];
+			return 2.0f * (x * y + y * z + z * x);
+		}
+
+		float low[3], high[3];
+	};
+
+	/** A triangle while the tree is being built: its box, and the centre of that box. */
+	struct Primitive
+	{
+		Box bounds;
+		float centre[3];
+		int part, triangle;
+	};
+
+	struct PrimitiveRef
+	{
+		int part, triangle;
+	};
+
+	/** A node of the binary tree: either two children, or a range of primitives. */
+	struct BinaryNode
+	{
+		Box bounds;
+		int left, right;            // child nodes, if numPrimitives is zero
+		int firstPrimitive, numPrimitives;
+	};
+
+	/** Four children, each either another node or a range of primitives. Unused slots have
+		an empty box, which no ray can hit.
+	*/
+	struct WideNode
+	{
+		WideNode() noexcept
+		{
+			for (auto i = 0; i < 4; ++i)
+				setChild(i, Box(), -1, 0);
+		}
+
+		void setChild(int i, const Box& box, int index, int count) noexcept
+		{
+			for (auto axis = 0; axis < 3; ++axis)
+			{
+				low[axis][i] = box.low[axis];
+				high[axis][i] = box.high[axis];
+			}
+
+			child[i] = index;
+			numPrimitives[i] = count;
+		}
+
+		float low[3][4], high[3][4];   // by axis, then by child
+		int child[4];                  // a node, or the first primitive if numPrimitives isn't zero
+		int numPrimitives[4];
+	};
+
+	struct Ray
+	{
+		Ray(const Vector3D<float>& o, const Vector3D<float>& d) noexcept
+		{
+			origin[0] = o.x;  origin[1] = o.y;  origin[2] = o.z;
+			direction[0] = d.x;  direction[1] = d.y;  direction[2] = d.z;
+
+			for (auto i = 0; i < 3; ++i)
+			{
+				// Nudge zero components so that their slabs don't come out as 0 * infinity
+				auto component = std::abs(direction[i]) > 1.0e-30f ? direction[i] : 1.0e-30f;
+				inverseDirection[i] = 1.0f / component;
+				isNegative[i] = inverseDirection[i] < 0.0f;
+			}
+		}
+
+		float origin[3], direction[3], inverseDirection[3];
+		bool isNegative[3];
+	};
+
+	Array<Part> parts;
+	Array<WideNode> nodes;
+	Array<PrimitiveRef> primitives;
+	Statistics statistics;
+
+	//==============================================================================
+	void collectPrimitives(Array<Primitive>& result) const
+	{
+		auto total = 0;
+
+		for (auto& part : parts)
+			total += part.numIndices / 3;
+
+		result.ensureStorageAllocated(total);
+
+		for (auto p = 0; p < parts.size(); ++p)
+		{
+			auto& part = parts.getReference(p);
+
+			for (auto t = 0; t < part.numIndices / 3; ++t)
+			{
+				auto* corners = part.indices + t * 3;
+
+				if (corners[0] >= (juce::uint32)part.numVertices || corners[1] >= (juce::uint32)part.numVertices
+					 || corners[2] >= (juce::uint32)part.numVertices)
+					continue;
+
+				Primitive primitive;
+				primitive.part = p;
+				primitive.triangle = t;
+
+				for (auto k = 0; k < 3; ++k)
+					primitive.bounds.add(part.positions + corners[k] * 3);
+
+				for (auto i = 0; i < 3; ++i)
+					primitive.centre[i] = 0.5f * (primitive.bounds.low[i] + primitive.bounds.high[i]);
+
+				result.add(primitive);
+			}
+		}
+	}
+
+	/** A range of primitives that still has to be turned into a subtree below node, and the
+		box around their centres.
+	*/
+	struct PendingRange
+	{
+		int node, begin, end;
+		Box centres;
+	};
+
+	static bool isCancelled(const std::atomic<bool>* shouldCancel) noexcept
+	{
+		return shouldCancel != nullptr && shouldCancel->load(std::memory_order_relaxed);
+	}
+
+	/** Returns false, with the tree only partly built, if shouldCancel gets set. */
+	bool buildBinaryTree(Array<Primitive>& prims, Array<BinaryNode>& result, int numThreads, const std::atomic<bool>* shouldCancel)
+	{
+		PendingRange root = { 0, 0, prims.size(), Box() };
+		Box bounds;
+
+		for (auto& p : prims)
+		{
+			bounds.add(p.bounds);
+			root.centres.add(p.centre);
+		}
+
+		result.add(createNode(bounds, 0, prims.size()));
+
+		// Split the largest ranges here until there's enough work for every thread
+		Array<PendingRange> pending;
+		pending.add(root);
+
+		auto targetNumTasks = numThreads > 1 ? numThreads * 4 : 1;
+
+		while (pending.size() < targetNumTasks)
+		{
+			if (isCancelled(shouldCancel))
+				return false;
+
+			auto largest = 0;
+
+			for (auto i = 1; i < pending.size(); ++i)
+				if (pending.getReference(i).end - pending.getReference(i).begin
+					  > pending.getReference(largest).end - pending.getReference(largest).begin)
+					largest = i;
+
+			auto range = pending.getReference(largest);
+
+			if (range.end - range.begin < minPrimitivesPerTask)
+				break;
+
+			pending.remove(largest);
+			PendingRange children[2];
+
+			if (splitNode(prims, result, range, children))
+			{
+				pending.add(children[0]);
+				pending.add(children[1]);
+			}
+		}
+
+		// Then build the subtrees side by side, each into its own array
+		OwnedArray<Array<BinaryNode>> subtrees;
+
+		for (auto i = 0; i < pending.size(); ++i)
+			subtrees.add(new Array<BinaryNode>());
+
+		parallelFor(pending.size(), numThreads, [&] (int i)
+		{
+			auto range = pending.getReference(i);
+			auto& subtree = *subtrees.getUnchecked(i);
+
+			subtree.ensureStorageAllocated(2 * (range.end - range.begin) / minLeafSize);
+			subtree.add(result.getReference(range.node));
+			range.node = 0;
+			buildSubtree(prims, subtree, range, shouldCancel);
+		});
+
+		if (isCancelled(shouldCancel))
+			return false;
+
+		// And hang them off the top of the tree
+		for (auto i = 0; i < pending.size(); ++i)
+		{
+			auto& subtree = *subtrees.getUnchecked(i);
+			auto offset = result.size() - 1;
+
+			result.setUnchecked(pending.getReference(i).node, relocate(subtree.getReference(0), offset));
+
+			for (auto n = 1; n < subtree.size(); ++n)
+				result.add(relocate(subtree.getReference(n), offset));
+		}
+
+		return true;
+	}
+
+	/** Subtree node n >= 1 goes to n + offset in the whole tree. */
+	static BinaryNode relocate(BinaryNode node, int offset) noexcept
+	{
+		if (node.numPrimitives == 0)
+		{
+			node.left += offset;
+			node.right += offset;
+		}
+
+		return node;
+	}
+
+	static void buildSubtree(Array<Primitive>& prims, Array<BinaryNode>& tree, const PendingRange& root,
+							 const std::atomic<bool>* shouldCancel)
+	{
+		Array<PendingRange> stack;
+		stack.add(root);
+
+		while (!stack.isEmpty() && !isCancelled(shouldCancel))
+		{
+			auto range = stack.removeAndReturn(stack.size() - 1);
+			PendingRange children[2];
+
+			if (splitNode(prims, tree, range, children))
+			{
+				stack.add(children[0]);
+				stack.add(children[1]);
+			}
+		}
+	}
+
+	static BinaryNode createNode(const Box& bounds, int begin, int end) noexcept
+	{
+		BinaryNode node;
+		node.bounds = bounds;
+		node.left = node.right = -1;
+		node.firstPrimitive = begin;
+		node.numPrimitives = end - begin;
+		return node;
+	}
+
+	/** Splits a leaf in two if that's worth doing, adding the two halves to the tree and
+		returning them as children. Returns false if the node should stay a leaf.
+	*/
+	static bool splitNode(Array<Primitive>& prims, Array<BinaryNode>& tree, const PendingRange& range, PendingRange* children)
+	{
+		Box childBounds[2];
+
+		if (!split(prims, tree.getReference(range.node).bounds, range, childBounds, children))
+			return false;
+
+		auto left = tree.size();
+		tree.add(createNode(childBounds[0], children[0].begin, children[0].end));
+		tree.add(createNode(childBounds[1], children[1].begin, children[1].end));
+
+		auto& parent = tree.getReference(range.node);
+		parent.left = left;
+		parent.right = left + 1;
+		parent.numPrimitives = 0;
+
+		children[0].node = left;
+		children[1].node = left + 1;
+		return true;
+	}
+
+	/** Partitions a range where the binned surface area heuristic finds it cheapest to split
+		it, and fills in the two halves' ranges, boxes and centre boxes. Returns false if the
+		range is better off as a leaf.
+	*/
+	static bool split(Array<Primitive>& prims, const Box& bounds, const PendingRange& range,
+					  Box* childBounds, PendingRange* children)
+	{
+		auto begin = range.begin, end = range.end, count = end - begin;
+		auto& centres = range.centres;
+
+		if (count <= minLeafSize)
+			return false;
+
+		auto axis = 0;
+
+		for (auto i = 1; i < 3; ++i)
+			if (centres.high[i] - centres.low[i] > centres.high[axis] - centres.low[axis])
+				axis = i;
+
+		auto extent = centres.high[axis] - centres.low[axis];
+
+		if (extent <= 0.0f)
+		{
+			// Every centre is in the same place, so no plane can separate them
+			if (count <= maxLeafSize)
+				return false;
+
+			splitAt(prims, begin, begin + count / 2, end, childBounds, children);
+			return true;
+		}
+
+		Box binBounds[numBins], binCentres[numBins];
+		int binCounts[numBins] = {};
+		auto binScale = (float)numBins / extent;
+
+		auto binOf = [&] (const Primitive& p)
+		{
+			return jlimit(0, (int)numBins - 1, (int)((p.centre[axis] - centres.low[axis]) * binScale));
+		};
+
+		for (auto i = begin; i < end; ++i)
+		{
+			auto& p = prims.getReference(i);
+			auto bin = binOf(p);
+			binBounds[bin].add(p.bounds);
+			binCentres[bin].add(p.centre);
+			++binCounts[bin];
+		}
+
+		// The cost of each plane between bins, sweeping from the right, then from the left
+		float rightAreas[numBins];
+		int rightCounts[numBins];
+		Box sweep;
+		auto sweepCount = 0;
+
+		for (auto b = numBins - 1; b > 0; --b)
+		{
+			sweep.add(binBounds[b]);
+			sweepCount += binCounts[b];
+			rightAreas[b] = sweep.getSurfaceArea();
+			rightCounts[b] = sweepCount;
+		}
+
+		sweep = Box();
+		sweepCount = 0;
+		auto bestCost = std::numeric_limits<float>::max();
+		auto bestPlane = -1;
+
+		for (auto b = 1; b < numBins; ++b)
+		{
+			sweep.add(binBounds[b - 1]);
+			sweepCount += binCounts[b - 1];
+
+			if (sweepCount == 0 || rightCounts[b] == 0)
+				continue;
+
+			auto cost = sweep.getSurfaceArea() * (float)sweepCount + rightAreas[b] * (float)rightCounts[b];
+
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestPlane = b;
+			}
+		}
+
+		// A leaf costs one triangle test per primitive; a split costs a box test, plus the
+		// triangles of each side weighted by how likely a ray through this node is to hit it
+		auto area = bounds.getSurfaceArea();
+		auto splitCost = area > 0.0f ? 1.0f + bestCost / area : 0.0f;
+
+		if (bestPlane < 0 || (count <= maxLeafSize && splitCost >= (float)count))
+		{
+			if (count <= maxLeafSize)
+				return false;
+
+			splitAt(prims, begin, begin + count / 2, end, childBounds, children);
+			return true;
+		}
+
+		auto* middle = std::partition(prims.begin() + begin, prims.begin() + end,
+									  [&] (const Primitive& p) { return binOf(p) < bestPlane; });
+		auto mid = (int)(middle - prims.begin());
+
+		children[0] = { -1, begin, mid, Box() };
+		children[1] = { -1, mid, end, Box() };
+
+		for (auto b = 0; b < numBins; ++b)
+		{
+			auto side = b < bestPlane ? 0 : 1;
+			childBounds[side].add(binBounds[b]);
+			children[side].centres.add(binCentres[b]);
+		}
+
+		return true;
+	}
+
+	/** Splits a range at mid, in whatever order its primitives are already in. */
+	static void splitAt(const Array<Primitive>& prims, int begin, int mid, int end, Box* childBounds, PendingRange* children)
+	{
+		children[0] = { -1, begin, mid, Box() };
+		children[1] = { -1, mid, end, Box() };
+
+		for (auto i = begin; i < end; ++i)
+		{
+			auto side = i < mid ? 0 : 1;
+			auto& p = prims.getReference(i);
+			childBounds[side].add(p.bounds);
+			children[side].centres.add(p.centre);
+		}
+	}
+
+	//==============================================================================
+	/** Fills wide node target from the binary subtree at binaryNode, pulling up grandchildren
+		until it has four children or they're all leaves.
+	*/
+	void collapse(const Array<BinaryNode>& tree, int binaryNode, int target, int depth)
+	{
+		int children[4] = { binaryNode, -1, -1, -1 };
+		auto numChildren = 1;
+
+		if (tree.getReference(binaryNode).numPrimitives == 0)
+		{
+			children[0] = tree.getReference(binaryNode).left;
+			children[1] = tree.getReference(binaryNode).right;
+			numChildren = 2;
+		}
+
+		while (numChildren < 4)
+		{
+			// Open up the biggest child that isn't a leaf
+			auto biggest = -1;
+
+			for (auto i = 0; i < numChildren; ++i)
+			{
+				auto& node = tree.getReference(children[i]);
+
+				if (node.numPrimitives == 0
+					 && (biggest < 0 || node.bounds.getSurfaceArea() > tree.getReference(children[biggest]).bounds.getSurfaceArea()))
+					biggest = i;
+			}
+
+			if (biggest < 0)
+				break;
+
+			auto& node = tree.getReference(children[biggest]);
+			children[biggest] = node.left;
+			children[numChildren++] = node.right;
+		}
+
+		statistics.maxDepth = jmax(statistics.maxDepth, depth);
+
+		for (auto i = 0; i < numChildren; ++i)
+		{
+			auto& node = tree.getReference(children[i]);
+
+			if (node.numPrimitives > 0)
+			{
+				nodes.getReference(target).setChild(i, node.bounds, node.firstPrimitive, node.numPrimitives);
+			}
+			else
+			{
+				auto index = nodes.size();
+				nodes.add(WideNode());
+				nodes.getReference(target).setChild(i, node.bounds, index, 0);
+				collapse(tree, children[i], index, depth + 1);
+			}
+		}
+	}
+
+	//==============================================================================
+	/** Returns a bit for each of the node's children whose box the ray enters before maxDistance,
+		and sets distances to where it enters them.
+	*/
+	static int intersectBoxes(const WideNode& node, const Ray& ray, float maxDistance, float* distances) noexcept
+	{
+	   #if JUCE_INTEL
+		auto tNear = _mm_setzero_ps();
+		auto tFar = _mm_set1_ps(maxDistance);
+
+		for (auto axis = 0; axis < 3; ++axis)
+		{
+			auto* nearPlanes = ray.isNegative[axis] ? node.high[axis] : node.low[axis];
+			auto* farPlanes = ray.isNegative[axis] ? node.low[axis] : node.high[axis];
+			auto origin = _mm_set1_ps(ray.origin[axis]);
+			auto inverse = _mm_set1_ps(ray.inverseDirection[axis]);
+
+			tNear = _mm_max_ps(tNear, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nearPlanes), origin), inverse));
+			tFar = _mm_min_ps(tFar, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(farPlanes), origin), inverse));
+		}
+
+		_mm_storeu_ps(distances, tNear);
+		return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+	   #else
+		auto mask = 0;
+
+		for (auto i = 0; i < 4; ++i)
+		{
+			auto tNear = 0.0f, tFar = maxDistance;
+
+			for (auto axis = 0; axis < 3; ++axis)
+			{
+				auto nearPlane = ray.isNegative[axis] ? node.high[axis][i] : node.low[axis][i];
+				auto farPlane = ray.isNegative[axis] ? node.low[axis][i] : node.high[axis][i];
+
+				tNear = jmax(tNear, (nearPlane - ray.origin[axis]) * ray.inverseDirection[axis]);
+				tFar = jmin(tFar, (farPlane - ray.origin[axis]) * ray.inverseDirection[axis]);
+			}
+
+			distances[i] = tNear;
+
+			if (tNear <= tFar)
+				mask |= 1 << i;
+		}
+
+		return mask;
+	   #endif
+	}
+
+	/** The Moller-Trumbore test. Updates hit if the triangle is nearer than it. */
+	void intersectTriangle(const PrimitiveRef& primitive, const Ray& ray, Hit& hit) const noexcept
+	{
+		auto& part = parts.getReference(primitive.part);
+		auto* corners = part.indices + primitive.triangle * 3;
+		auto* p0 = part.positions + corners[0] * 3;
+		auto* p1 = part.positions + corners[1] * 3;
+		auto* p2 = part.positions + corners[2] * 3;
+
+		float edge1[3], edge2[3], s[3];
+
+		for (auto i = 0; i < 3; ++i)
+		{
+			edge1[i] = p1[i] - p0[i];
+			edge2[i] = p2[i] - p0[i];
+			s[i] = ray.origin[i] - p0[i];
+		}
+
+		auto& d = ray.direction;
+		float p[3] = { d[1] * edge2[2] - d[2] * edge2[1], d[2] * edge2[0] - d[0] * edge2[2], d[0] * edge2[1] - d[1] * edge2[0] };
+		auto determinant = edge1[0] * p[0] + edge1[1] * p[1] + edge1[2] * p[2];
+
+		if (determinant == 0.0f)
+			return;
+
+		auto inverseDeterminant = 1.0f / determinant;
+		auto u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverseDeterminant;
+
+		if (u < 0.0f || u > 1.0f)
+			return;
+
+		float q[3] = { s[1] * edge1[2] - s[2] * edge1[1], s[2] * edge1[0] - s[0] * edge1[2], s[0] * edge1[1] - s[1] * edge1[0] };
+		auto v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inverseDeterminant;
+
+		if (v < 0.0f || u + v > 1.0f)
+			return;
+
+		auto t = (edge2[0] * q[0] + edge2[1] * q[1] + edge2[2] * q[2]) * inverseDeterminant;
+
+		if (t >= 0.0f && t < hit.distance)
+			hit = { primitive.part, primitive.triangle, t, u, v };
+	}
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TriangleBvh)
+};
+
+
+#endif  // TRIANGLEBVH_H_INCLUDED
@@ -0,0 +1,2110 @@
+/*
+==============================================================================
+
+WavefrontObjFile.h
+Created: 18 March 2018 10:30pm
+Author:  Akira DeMoss
+
+==============================================================================
+*/
+
+/**
+*  In this module, we define the Wavefront .obj/.mtl loader used by the OpenGLView.
+*/
+
+#ifndef WAVEFRONTOBJFILE_H_INCLUDED
+#define WAVEFRONTOBJFILE_H_INCLUDED
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ObjTextScanning.h"
+#include "ObjMeshCache.h"
+#include "MonotonicArena.h"
+#include "MaterialTextures.h"
+#include "MeshOptimiser.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "NormalGenerator.h"
+#include "MeshCodec.h"
+#include "TriangleBvh.h"
+#include "ParallelFor.h"
+#include <map>
+
+
+
+//==============================================================================
+/**
+*  Adding This in from the OpenGLAppTutorial so that we can incorporate an additional OpenGLView.
+*  To complete this concept, we would use a strategy similar to how we passed am object
+*  reference of the ImageView class to the FileBrowser class, so that when the
+*  listener detects an appropriate file that is selected, the the OpenGLView will change.
+*  However, this is slightly different in the respect that in the Shape struct, we are
+*  directly referencing the Resources directory.  We will leave this up to future work while
+*  observing the proof of concept with the ImageView example.
+*
+*  The parser works directly on ranges of UTF-8 bytes, so a file can either be memory-mapped
+*  and parsed in place, or loaded into a String first; both paths produce the same shapes.
+*  Large inputs are cut into chunks at line boundaries and parsed on several threads, after
+*  which the group and material records are replayed in file order, so the result is the
+*  same as parsing the whole file on one thread.
+*
+*  When LoadOptions::useBinaryCache is set, the finished shapes are also written to an
+*  ObjMeshCache file, and the next load of the same, unchanged file reads that instead.
+*
+*  Everything the parser only needs while it's running (face corners, group and material
+*  records, de-duplication tables) comes from a MonotonicArena that is thrown away in one go
+*  at the end of the load, so the heap only sees a handful of large blocks.
+*
+*  Each .mtl library is read once per load, however many mtllib lines name it, and its
+*  materials are looked up by name through a hash table. The texture maps they refer to can
+*  be decoded in the background while the rest of the file is still being processed (see
+*  LoadOptions::textures).
+*
+*  Once the shapes are built, their triangles and vertices can be reordered for the GPU's
+*  vertex cache, for less overdraw and for vertex fetch locality (see MeshOptimiser and
+*  LoadOptions::optimiseMeshes), simplified into a chain of coarser levels of detail
+*  (see MeshSimplifier and LoadOptions::buildLevelsOfDetail), and split into meshlets that
+*  can be culled on their own (see MeshletBuilder and LoadOptions::buildMeshlets).
+*/
+class WavefrontObjFile
+{
+public:
+	WavefrontObjFile() : loadedFromCache(false)
+	{
+		zerostruct(statistics);
+	}
+
+	/** Bump this whenever a change to the parser changes the shapes it produces, so that any
+		cache files written by older versions are ignored.
+	*/
+	enum { parserVersion = 1 };
+
+	//==============================================================================
+	/** Shared between a load and whoever is watching it. The parser adds to the counters as it
+		goes, and checks shouldCancel every few thousand lines or faces; if it has been set, the
+		load stops and returns a failed Result, leaving no shapes.
+	*/
+	struct LoadProgress
+	{
+		LoadProgress() noexcept : totalBytes(0), bytesProcessed(0), linesProcessed(0), shouldCancel(false) {}
+
+		/** Returns how far through the text the parser is, from 0 to 1. */
+		double getProportionComplete() const noexcept
+		{
+			auto total = totalBytes.load();
+			return total > 0 ? jlimit(0.0, 1.0, (double)bytesProcessed.load() / (double)total) : 0.0;
+		}
+
+		std::atomic<int64> totalBytes, bytesProcessed, linesProcessed;
+		std::atomic<bool> shouldCancel;
+
+		JUCE_DECLARE_NON_COPYABLE(LoadProgress)
+	};
+
+	/** Options that control how load() reads a file. */
+	struct LoadOptions
+	{
+		LoadOptions() noexcept
+			: useMemoryMappedFile(true), numThreads(0), useOrderedIndexMap(false),
+			  useBinaryCache(false), compressCache(false), optimiseMeshes(false), buildLevelsOfDetail(false),
+			  buildMeshlets(false), buildTriangleBvh(false), decodeTextures(false), generateNormals(false),
+			  creaseAngle(180.0f), textures(nullptr), progress(nullptr)
+		{
+		}
+
+		/** When true, the .obj and .mtl files are memory-mapped and parsed straight from
+			the mapped bytes, rather than being decoded into a String and split into lines.
+			If a file can't be mapped, it falls back to the String path.
+		*/
+		bool useMemoryMappedFile;
+
+		/** The number of threads used to parse the file and build its shapes. Zero means one
+			per CPU core; one keeps everything on the calling thread. Small files are always
+			parsed as a single chunk.
+		*/
+		int numThreads;
+
+		/** Makes the loader de-duplicate vertices with the original std::map rather than the
+			flat hash table. The results are identical; this is only here for benchmarking.
+		*/
+		bool useOrderedIndexMap;
+
+		/** When true, the loader first looks for an up-to-date ObjMeshCache file for the .obj file,
+			and if there isn't one, it writes one after parsing. Failing to write the cache
+			doesn't make the load fail.
+		*/
+		bool useBinaryCache;
+
+		/** Where the cache files go. Leave this as File() to keep them next to the .obj files. */
+		File cacheDirectory;
+
+		/** When true, the shapes in a new cache file are encoded with MeshCodec, which makes the
+			file a good deal smaller, at the cost of decoding it when it's read. A cache file
+			written with this setting is only used by loads with the same setting.
+		*/
+		bool compressCache;
+
+		/** How MeshCodec quantises the shapes' attributes in a compressed cache. The default
+			keeps them exactly; with anything else, the shapes loaded from the cache aren't quite
+			the ones that were parsed, and a cache only matches loads with the same options.
+		*/
+		MeshCodec::Options cacheCodecOptions;
+
+		/** When true, each shape is run through MeshOptimiser once it has been built. The shapes
+			look the same, but their triangles and vertices come out in a different order. A cache
+			file written with this setting is only used by loads with the same setting.
+		*/
+		bool optimiseMeshes;
+
+		/** When true, each shape's Mesh::levelsOfDetail is filled with a chain of simplified
+			versions of it, built on the parsing threads. Like optimiseMeshes, a cache file only
+			matches loads with the same setting.
+		*/
+		bool buildLevelsOfDetail;
+
+		/** When true, each shape's triangles are reordered into meshlets by MeshletBuilder, after
+			the shape has been optimised, and Mesh::meshlets says where each one is. Like
+			optimiseMeshes, a cache file only matches loads with the same setting.
+		*/
+		bool buildMeshlets;
+
+		/** Only used by AsyncLoader: when true, once the file has loaded, it also builds a
+			TriangleBvh over the full-detail triangles of every shape, for picking.
+		*/
+		bool buildTriangleBvh;
+
+		/** Only used by AsyncLoader: when true, it decodes the materials' textures into its own
+			MaterialTextures (see AsyncLoader::getTextures()), and a load only counts as finished
+			once they're all ready. Leave it off unless something uses the images, since it
+			holds the load up until the last one has decoded.
+		*/
+		bool decodeTextures;
+
+		/** When true, shapes that have no normals of their own are given smooth ones by
+			NormalGenerator, before they're optimised. Triangles are only smoothed together with
+			others from the same s group; faces that come before any s record count as one group,
+			and "s off" faces are left flat. Like optimiseMeshes, a cache file only matches loads
+			with the same setting.
+		*/
+		bool generateNormals;
+
+		/** In degrees: when normals are generated, triangles in the same smoothing group that meet
+			at a sharper angle than this still get a hard edge. 180 leaves it to the s records.
+		*/
+		float creaseAngle;
+
+		/** If this isn't null, the diffuse, specular and normal maps of every material are
+			added to it for decoding as soon as their library has been read.
+		*/
+		MaterialTextures* textures;
+
+		/** If this isn't null, the load reports its progress here and can be cancelled through it.
+			It must stay alive until load() returns.
+		*/
+		LoadProgress* progress;
+	};
+
+	Result load(const String& objFileContent)
+	{
+		return load(objFileContent, LoadOptions());
+	}
+
+	/** Parses OBJ text that's already in memory. The options that are about files (the cache and
+		memory mapping) don't apply, but the rest do, as they would for load (File, options).
+	*/
+	Result load(const String& objFileContent, const LoadOptions& options)
+	{
+		loadOptions = options;
+
+		shapes.clear();
+		dependencies.clear();
+		loadedFromCache = false;
+		zerostruct(statistics);
+		return parseObjFile(objFileContent.toRawUTF8(), objFileContent.getNumBytesAsUTF8(), true);
+	}
+
+	Result load(const File& file)
+	{
+		return load(file, LoadOptions());
+	}
+
+	Result load(const File& file, const LoadOptions& options)
+	{
+		sourceFile = file;
+		loadOptions = options;
+
+		shapes.clear();
+		dependencies.clear();
+		loadedFromCache = false;
+		zerostruct(statistics);
+
+		// Take the file's details before reading it, so that a cache is never written with the
+		// timestamp of a later version of the file than the one that was parsed
+		auto source = ObjMeshCache::SourceInfo::of(file);
+
+		if (options.useBinaryCache)
+		{
+			const ScopedPhaseTimer timer(statistics.readSeconds);
+
+			if (loadFromCache(source))
+				return Result::ok();
+		}
+
+		std::unique_ptr<SourceText> text;
+
+		{
+			const ScopedPhaseTimer timer(statistics.readSeconds);
+			text.reset(new SourceText(file, options.useMemoryMappedFile));
+		}
+
+		auto result = parseObjFile(text->data, text->numBytes, text->isNullTerminated);
+
+		if (result.wasOk() && options.useBinaryCache)
+			writeCache(source);
+
+		return result;
+	}
+
+	/** True if the last load() read its shapes from a cache file rather than parsing the .obj file. */
+	bool wasLoadedFromCache() const noexcept    { return loadedFromCache; }
+
+	/** Where the time of the last load() went, and how its temporary data was allocated. */
+	struct LoadStatistics
+	{
+		double readSeconds;         // mapping or reading the file, or reading the mesh cache
+		double tokenizeSeconds;     // parsing the lines of every chunk
+		double groupBuildSeconds;   // joining the chunks, and replaying their records into groups
+		double dedupSeconds;        // de-duplicating each group's vertices into its shape
+		double optimiseSeconds;     // reordering the shapes with MeshOptimiser, if that was asked for
+		double levelOfDetailSeconds;    // simplifying the shapes with MeshSimplifier, if that was asked for
+		double meshletSeconds;          // splitting the shapes into meshlets, if that was asked for
+		double normalSeconds;           // generating normals for the shapes without any, if that was asked for
+
+		int64 numBytes, numFaces;
+
+		/** The triangle-weighted average ACMR of the shapes before and after MeshOptimiser
+			reordered them, over the numOptimisedTriangles triangles it was able to work on.
+		*/
+		double acmrBefore, acmrAfter;
+		int64 numOptimisedTriangles;
+
+		/** The number of requests the parse's arena served, against the blocks it took from the heap. */
+		MonotonicArena::Statistics arena;
+	};
+
+	const LoadStatistics& getLoadStatistics() const noexcept    { return statistics; }
+
+	/** Returns the file a material's texture name refers to. */
+	File getTextureFile(const String& textureName) const
+	{
+		return sourceFile.getSiblingFile(textureName);
+	}
+
+	//==============================================================================
+	/**
+	*  Loads an .obj file on its own thread, so that neither the message thread nor a GL
+	*  thread has to wait for it. Poll isFinished(), and once it returns true the loaded
+	*  file can be used from any thread; it isn't touched by the loader again.
+	*
+	*  If LoadOptions::decodeTextures is set, the materials' textures are decoded into the
+	*  loader's own MaterialTextures, and a load only counts as finished once they're all ready
+	*  too. If LoadOptions::buildTriangleBvh is
+	*  set, the hierarchy is built after the load has finished, so the model can be drawn
+	*  while it's being built; cancelling stops that build as well.
+	*/
+	class AsyncLoader : private Thread
+	{
+	public:
+		AsyncLoader() : Thread("OBJ Loader"), loadResult(Result::ok()), finished(false), triangleBvhReady(false) {}
+
+		~AsyncLoader()
+		{
+			cancel();
+		}
+
+		/** Cancels anything already loading, and starts loading this file. */
+		void startLoading(const File& file, const LoadOptions& options)
+		{
+			cancel();
+
+			loadedFile.reset(new WavefrontObjFile());
+			fileToLoad = file;
+			loadOptions = options;
+			progress.reset(new LoadProgress());
+			loadOptions.progress = progress.get();
+			textures.reset(loadOptions.decodeTextures ? new MaterialTextures() : nullptr);
+			loadOptions.textures = textures.get();
+			loadResult = Result::ok();
+			finished = false;
+			triangleBvh.reset(new TriangleBvh());
+			triangleBvhReady = false;
+
+			startThread();
+		}
+
+		void startLoading(const File& file)
+		{
+			startLoading(file, LoadOptions());
+		}
+
+		/** Asks the parser to stop, and waits for the thread to finish. */
+		void cancel()
+		{
+			if (progress != nullptr)
+				progress->shouldCancel = true;
+
+			if (textures != nullptr)
+				textures->stopWaiting();
+
+			stopThread(-1);
+		}
+
+		bool isFinished() const noexcept                   { return finished; }
+
+		/** Returns the loaded file once loading has finished successfully, or nullptr. */
+		const WavefrontObjFile* getLoadedFile() const noexcept
+		{
+			return finished && loadResult.wasOk() ? loadedFile.get() : nullptr;
+		}
+
+		/** Only meaningful once isFinished() returns true. */
+		Result getResult() const                            { return finished ? loadResult : Result::ok(); }
+
+		const File& getFile() const noexcept                { return fileToLoad; }
+
+		/** Returns the counters of the current load, or nullptr if nothing has been started. */
+		const LoadProgress* getProgress() const noexcept    { return progress.get(); }
+
+		/** Returns the hierarchy over the loaded shapes once it has been built, or nullptr. Its
+			parts are in the same order as the loaded file's shapes.
+		*/
+		const TriangleBvh* getTriangleBvh() const noexcept
+		{
+			return triangleBvhReady ? triangleBvh.get() : nullptr;
+		}
+
+		/** Returns the decoded textures once loading has finished successfully, or nullptr if
+			it hasn't, or if LoadOptions::decodeTextures wasn't set.
+		*/
+		const MaterialTextures* getTextures() const noexcept
+		{
+			return getLoadedFile() != nullptr ? textures.get() : nullptr;
+		}
+
+	private:
+		void run() override
+		{
+			loadResult = loadedFile->load(fileToLoad, loadOptions);
+
+			if (loadResult.wasOk() && textures != nullptr && !textures->waitUntilFinished())
+				loadResult = Result::fail("Loading was cancelled");
+
+			finished = true;
+
+			if (loadResult.wasOk() && loadOptions.buildTriangleBvh && !threadShouldExit())
+			{
+				Array<TriangleBvh::Part> parts;
+
+				for (auto* shape : loadedFile->shapes)
+				{
+					auto& mesh = shape->mesh;
+					parts.add({ reinterpret_cast<const float*> (mesh.vertices.begin()), mesh.vertices.size(),
+								mesh.indices.begin(), mesh.indices.size() });
+				}
+
+				// It's built after the load has finished, so cancelling has to stop it too
+				triangleBvhReady = triangleBvh->build(parts, loadOptions.numThreads, &progress->shouldCancel);
+			}
+		}
+
+		std::unique_ptr<WavefrontObjFile> loadedFile;
+		std::unique_ptr<LoadProgress> progress;
+		std::unique_ptr<MaterialTextures> textures;
+		File fileToLoad;
+		LoadOptions loadOptions;
+		Result loadResult;
+		std::atomic<bool> finished;
+		std::unique_ptr<TriangleBvh> triangleBvh;
+		std::atomic<bool> triangleBvhReady;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AsyncLoader)
+	};
+
+	//==============================================================================
+	typedef juce::uint32 Index;
+
+	struct Vertex { float x, y, z; };
+	struct TextureCoord { float x, y; };
+	typedef MeshletBuilder::Meshlet Meshlet;
+
+	/** A coarser version of a mesh: another list of triangles over the same vertices, and the
+		furthest (in the mesh's units) that it may stray from the full-detail surface.
+	*/
+	struct LevelOfDetail
+	{
+		Array<Index> indices;
+		float error;
+	};
+
+	struct Mesh
+	{
+		Array<Vertex> vertices, normals;
+		Array<TextureCoord> textureCoords;
+		Array<Index> indices;
+
+		/** Each level has about half the triangles of the one before, starting from indices. */
+		Array<LevelOfDetail> levelsOfDetail;
+
+		/** Ranges of indices, in order, with bounds for culling them. Only the full-detail
+			triangles are split into meshlets.
+		*/
+		Array<Meshlet> meshlets;
+	};
+
+	struct Material
+	{
+		Material() noexcept  : shininess(1.0f), refractiveIndex(0.0f)
+		{
+			zerostruct(ambient);
+			zerostruct(diffuse);
+			zerostruct(specular);
+			zerostruct(transmittance);
+			zerostruct(emission);
+		}
+
+		String name;
+
+		Vertex ambient, diffuse, specular, transmittance, emission;
+		float shininess, refractiveIndex;
+
+		String ambientTextureName, diffuseTextureName,
+			specularTextureName, normalTextureName;
+
+		StringPairArray parameters;
+	};
+
+	struct Shape
+	{
+		String name;
+		Mesh mesh;
+		Material material;
+	};
+
+	OwnedArray<Shape> shapes;
+
+private:
+	//==============================================================================
+	File sourceFile;
+	LoadOptions loadOptions;
+	Array<ObjMeshCache::SourceInfo> dependencies;
+	bool loadedFromCache;
+	LoadStatistics statistics;
+
+	//==============================================================================
+	/** Gives read-only access to the bytes of a file, either by mapping it into memory or,
+		when that isn't possible or wanted, by loading it into a String.
+	*/
+	struct SourceText
+	{
+		SourceText(const File& file, bool allowMapping)
+			: data(nullptr), numBytes(0), isNullTerminated(false)
+		{
+			if (allowMapping)
+			{
+				mappedFile.reset(new MemoryMappedFile(file, MemoryMappedFile::readOnly));
+
+				auto* bytes = static_cast<const char*> (mappedFile->getData());
+				auto size = mappedFile->getSize();
+
+				if (bytes != nullptr && !isUTF16(bytes, size))
+				{
+					if (size >= 3 && CharPointer_UTF8::isByteOrderMark(bytes))
+					{
+						bytes += 3;
+						size -= 3;
+					}
+
+					data = bytes;
+					numBytes = size;
+					return;
+				}
+
+				mappedFile.reset();
+			}
+
+			content = file.loadFileAsString();
+			data = content.toRawUTF8();
+			numBytes = content.getNumBytesAsUTF8();
+			isNullTerminated = true;
+		}
+
+		static bool isUTF16(const char* bytes, size_t size) noexcept
+		{
+			return size >= 2 && (CharPointer_UTF16::isByteOrderMarkBigEndian(bytes)
+								|| CharPointer_UTF16::isByteOrderMarkLittleEndian(bytes));
+		}
+
+		std::unique_ptr<MemoryMappedFile> mappedFile;
+		String content;
+
+		const char* data;
+		size_t numBytes;
+		bool isNullTerminated;
+
+		JUCE_DECLARE_NON_COPYABLE(SourceText)
+	};
+
+	//==============================================================================
+	/** Splits a block of text into lines on \n, \r\n or \r, the same way StringArray::fromLines()
+		does, but without copying anything.
+
+		The byte at each line's end pointer is always safe to read and is never part of a number,
+		so the token scanners below can run up to it. When the block isn't null-terminated, that
+		can't be guaranteed for the final line, so that one line is copied into a terminated buffer.
+	*/
+	struct LineReader
+	{
+		LineReader(const char* textData, size_t numBytes, bool nullTerminated) noexcept
+			: text(textData), end(textData + numBytes),
+			  isNullTerminated(nullTerminated), hitNullCharacter(false)
+		{
+		}
+
+		bool next(const char*& lineStart, const char*& lineEnd)
+		{
+			if (text == nullptr || text >= end)
+				return false;
+
+			auto* t = text;
+
+			while (t < end && *t != '\n' && *t != '\r' && *t != 0)
+				++t;
+
+			lineStart = text;
+			lineEnd = t;
+
+			if (t == end || *t == 0)
+			{
+				text = end;
+				hitNullCharacter = (t < end);
+
+				if (t == end && !isNullTerminated)
+				{
+					auto length = (size_t)(t - lineStart);
+					lastLine.malloc(length + 1);
+					memcpy(lastLine.get(), lineStart, length);
+					lastLine[length] = '\n';
+
+					lineStart = lastLine.get();
+					lineEnd = lineStart + length;
+				}
+
+				return true;
+			}
+
+			if (*t == '\r' && t + 1 < end && t[1] == '\n')
+				++t;
+
+			text = t + 1;
+			return true;
+		}
+
+		/** True if the text stopped early at a null character rather than at its end. */
+		bool stoppedAtNullCharacter() const noexcept   { return hitNullCharacter; }
+
+		const char* text;
+		const char* end;
+		bool isNullTerminated, hitNullCharacter;
+		HeapBlock<char> lastLine;
+
+		JUCE_DECLARE_NON_COPYABLE(LineReader)
+	};
+
+	static const char* skipWhitespace(const char* t, const char* end) noexcept
+	{
+		return ObjTextScanning::skipWhitespace(t, end);
+	}
+
+	static void trim(const char*& t, const char*& end) noexcept
+	{
+		t = skipWhitespace(t, end);
+
+		while (end > t && ObjTextScanning::isWhitespace(end[-1]))
+			--end;
+	}
+
+	static String trimmedString(const char* t, const char* end)
+	{
+		trim(t, end);
+		return String(CharPointer_UTF8(t), CharPointer_UTF8(end));
+	}
+
+	/** Returns the first space or tab in the range, or end if there isn't one. */
+	static const char* findEndOfToken(const char* t, const char* end) noexcept
+	{
+		while (t < end && *t != ' ' && *t != '\t')
+			++t;
+
+		return t;
+	}
+
+	static bool rangeEquals(const char* t, const char* end, const String& s) noexcept
+	{
+		auto length = (size_t)(end - t);
+		return s.getNumBytesAsUTF8() == length && memcmp(s.toRawUTF8(), t, length) == 0;
+	}
+
+	//==============================================================================
+	struct TripleIndex
+	{
+		TripleIndex() noexcept : vertexIndex(-1), textureIndex(-1), normalIndex(-1) {}
+
+		bool operator< (const TripleIndex& other) const noexcept
+		{
+			if (this == &other)
+				return false;
+
+			if (vertexIndex != other.vertexIndex)
+				return vertexIndex < other.vertexIndex;
+
+			if (textureIndex != other.textureIndex)
+				return textureIndex < other.textureIndex;
+
+			return normalIndex < other.normalIndex;
+		}
+
+		int vertexIndex, textureIndex, normalIndex;
+	};
+
+	/** How many v, vn and vt records had been read at some point in the file. A face group
+		can only use the elements that came before the line that ended it.
+	*/
+	struct ElementCounts
+	{
+		int vertices, normals, textureCoords;
+
+		static ElementCounts of(const Mesh& m) noexcept
+		{
+			return { m.vertices.size(), m.normals.size(), m.textureCoords.size() };
+		}
+
+		ElementCounts operator+ (const ElementCounts& other) const noexcept
+		{
+			return { vertices + other.vertices, normals + other.normals, textureCoords + other.textureCoords };
+		}
+	};
+
+	/** Copies the elements a triple refers to onto the end of newMesh, and returns the new
+		vertex's index. Triples that refer to missing elements just leave those ones out.
+	*/
+	static Index addVertex(const TripleIndex& i, Mesh& newMesh, const Mesh& srcMesh, const ElementCounts& available)
+	{
+		auto index = (Index)newMesh.vertices.size();
+
+		if (isPositiveAndBelow(i.vertexIndex, available.vertices))
+			newMesh.vertices.add(srcMesh.vertices.getReference(i.vertexIndex));
+
+		if (isPositiveAndBelow(i.normalIndex, available.normals))
+			newMesh.normals.add(srcMesh.normals.getReference(i.normalIndex));
+
+		if (isPositiveAndBelow(i.textureIndex, available.textureCoords))
+			newMesh.textureCoords.add(srcMesh.textureCoords.getReference(i.textureIndex));
+
+		return index;
+	}
+
+	/** De-duplicates the triples of a face group with a flat, open-addressed hash table.
+		Each slot holds a packed TripleIndex and its vertex index side by side, and collisions
+		are probed linearly, so a lookup normally touches a single cache line and inserting
+		never allocates. The table is sized up-front from the number of face corners in the
+		group, and only grows if that estimate turns out to be too small.
+	*/
+	struct IndexMap
+	{
+		struct Slot
+		{
+			TripleIndex key;
+			Index index;
+		};
+
+		/** Holds on to the tables of finished maps, so that the groups de-duplicated after them
+			can reuse that memory instead of each taking fresh pages from the arena.
+		*/
+		class TablePool
+		{
+		public:
+			explicit TablePool(MonotonicArena& arenaToUse) : arena(arenaToUse) {}
+
+			/** Returns a table with at least the given capacity, and updates capacity to its
+				actual size. A spare table is only reused if it isn't far too big, since every
+				slot of it has to be cleared.
+			*/
+			Slot* take(juce::uint32& capacity)
+			{
+				{
+					const SpinLock::ScopedLockType sl(lock);
+					auto best = -1;
+
+					for (auto i = 0; i < spareTables.size(); ++i)
+					{
+						auto spareCapacity = spareTables.getReference(i).capacity;
+
+						if (spareCapacity >= capacity && spareCapacity <= capacity * 4
+							 && (best < 0 || spareCapacity < spareTables.getReference(best).capacity))
+							best = i;
+					}
+
+					if (best >= 0)
+					{
+						auto table = spareTables.removeAndReturn(best);
+						capacity = table.capacity;
+						return table.slots;
+					}
+				}
+
+				return arena.allocateArray<Slot>(capacity);
+			}
+
+			void giveBack(Slot* slots, juce::uint32 capacity)
+			{
+				const SpinLock::ScopedLockType sl(lock);
+				spareTables.add({ slots, capacity });
+			}
+
+		private:
+			struct Table
+			{
+				Slot* slots;
+				juce::uint32 capacity;
+			};
+
+			MonotonicArena& arena;
+			Array<Table> spareTables;
+			SpinLock lock;
+
+			JUCE_DECLARE_NON_COPYABLE(TablePool)
+		};
+
+		IndexMap(int expectedNumVertices, TablePool& tablePool)
+			: pool(tablePool), slots(nullptr), capacity(0), mask(0), numUsed(0)
+		{
+			auto size = 16;
+
+			while (size < expectedNumVertices + expectedNumVertices / 2)
+				size *= 2;
+
+			allocate((juce::uint32)size);
+		}
+
+		~IndexMap()
+		{
+			pool.giveBack(slots, capacity);
+		}
+
+		Index getIndexFor(TripleIndex i, Mesh& newMesh, const Mesh& srcMesh, const ElementCounts& available)
+		{
+			if (numUsed * 4 >= capacity * 3)
+				grow();
+
+			for (auto slot = hash(i) & mask;; slot = (slot + 1) & mask)
+			{
+				auto& s = slots[slot];
+
+				if (s.index == emptySlot)
+				{
+					s.key = i;
+					s.index = addVertex(i, newMesh, srcMesh, available);
+					++numUsed;
+					return s.index;
+				}
+
+				if (s.key.vertexIndex == i.vertexIndex
+					&& s.key.textureIndex == i.textureIndex
+					&& s.key.normalIndex == i.normalIndex)
+					return s.index;
+			}
+		}
+
+	private:
+		enum { emptySlot = 0xffffffff };
+
+		TablePool& pool;
+		Slot* slots;
+		juce::uint32 capacity, mask, numUsed;
+
+		static juce::uint32 hash(const TripleIndex& i) noexcept
+		{
+			auto h = (juce::uint32)i.vertexIndex * 0x9e3779b1u
+				   ^ (juce::uint32)i.textureIndex * 0x85ebca77u
+				   ^ (juce::uint32)i.normalIndex * 0xc2b2ae3du;
+
+			h ^= h >> 16;
+			h *= 0x7feb352du;
+			h ^= h >> 15;
+			return h;
+		}
+
+		void allocate(juce::uint32 size)
+		{
+			capacity = size;
+			slots = pool.take(capacity);
+			mask = capacity - 1;
+
+			for (juce::uint32 i = 0; i < capacity; ++i)
+				slots[i].index = emptySlot;
+		}
+
+		void grow()
+		{
+			auto* oldSlots = slots;
+			auto oldCapacity = capacity;
+
+			allocate(capacity * 2);
+
+			for (juce::uint32 i = 0; i < oldCapacity; ++i)
+			{
+				if (oldSlots[i].index != emptySlot)
+				{
+					auto slot = hash(oldSlots[i].key) & mask;
+
+					while (slots[slot].index != emptySlot)
+						slot = (slot + 1) & mask;
+
+					slots[slot] = oldSlots[i];
+				}
+			}
+
+			pool.giveBack(oldSlots, oldCapacity);
+		}
+
+		JUCE_DECLARE_NON_COPYABLE(IndexMap)
+	};
+
+	/** The original std::map based de-duplication. It gives exactly the same results as
+		IndexMap, and is kept so the two can be compared (see LoadOptions::useOrderedIndexMap).
+	*/
+	struct OrderedIndexMap
+	{
+		OrderedIndexMap(int /*expectedNumVertices*/, IndexMap::TablePool&) {}
+
+		std::map<TripleIndex, Index> map;
+
+		Index getIndexFor(TripleIndex i, Mesh& newMesh, const Mesh& srcMesh, const ElementCounts& available)
+		{
+			const std::map<TripleIndex, Index>::iterator it(map.find(i));
+
+			if (it != map.end())
+				return it->second;
+
+			auto index = addVertex(i, newMesh, srcMesh, available);
+			map[i] = index;
+			return index;
+		}
+	};
+
+	static float parseFloat(const char*& t, const char* end)
+	{
+		t = skipWhitespace(t, end);
+
+		if (t >= end)
+			return 0.0f;
+
+		return ObjTextScanning::readFloat(t, end);
+	}
+
+	static Vertex parseVertex(const char* t, const char* end)
+	{
+		Vertex v;
+		v.x = parseFloat(t, end);
+		v.y = parseFloat(t, end);
+		v.z = parseFloat(t, end);
+		return v;
+	}
+
+	static TextureCoord parseTextureCoord(const char* t, const char* end)
+	{
+		TextureCoord tc;
+		tc.x = parseFloat(t, end);
+		tc.y = parseFloat(t, end);
+		return tc;
+	}
+
+	static bool matchToken(const char*& t, const char* end, const char* token)
+	{
+		auto len = strlen(token);
+
+		if ((size_t)(end - t) >= len && memcmp(token, t, len) == 0)
+		{
+			auto tokenEnd = t + len;
+
+			if (tokenEnd == end || ObjTextScanning::isWhitespace(*tokenEnd))
+			{
+				t = skipWhitespace(tokenEnd, end);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/** The faces of a chunk, with all of their corners kept in one flat array. Face i's corners
+		run from corners[faceStarts[i]] up to corners[faceStarts[i + 1]], so adding a face only
+		appends to these two arrays, which are reserved up-front from the chunk's RecordCounts.
+	*/
+	struct FaceList
+	{
+		explicit FaceList(MonotonicArena& arena) : corners(arena), faceStarts(arena)
+		{
+			faceStarts.add(0);
+		}
+
+		int size() const noexcept                       { return faceStarts.size() - 1; }
+		int getNumCorners(int face) const noexcept      { return faceStarts.getUnchecked(face + 1) - faceStarts.getUnchecked(face); }
+
+		void ensureStorageAllocated(int numFaces, int numCorners)
+		{
+			faceStarts.ensureStorageAllocated(numFaces + 1);
+			corners.ensureStorageAllocated(numCorners);
+		}
+
+		void addFace(const char* t, const char* end)
+		{
+			while (t < end)
+				corners.add(parseTriple(t, end));
+
+			faceStarts.add(corners.size());
+		}
+
+		/** Triangulates a face as a fan, and adds its indices to newMesh. */
+		template <typename IndexMapType>
+		void addIndices(int face, Mesh& newMesh, const Mesh& srcMesh, const ElementCounts& available, IndexMapType& indexMap) const
+		{
+			auto numTriples = getNumCorners(face);
+
+			if (numTriples < 3)
+				return;
+
+			auto* triples = corners.begin() + faceStarts.getUnchecked(face);
+			TripleIndex i0(triples[0]), i1, i2(triples[1]);
+
+			for (auto i = 2; i < numTriples; ++i)
+			{
+				i1 = i2;
+				i2 = triples[i];
+
+				newMesh.indices.add(indexMap.getIndexFor(i0, newMesh, srcMesh, available));
+				newMesh.indices.add(indexMap.getIndexFor(i1, newMesh, srcMesh, available));
+				newMesh.indices.add(indexMap.getIndexFor(i2, newMesh, srcMesh, available));
+			}
+		}
+
+		static TripleIndex parseTriple(const char*& t, const char* end)
+		{
+			TripleIndex i;
+
+			t = skipWhitespace(t, end);
+			i.vertexIndex = ObjTextScanning::readInt(t, end) - 1;
+			t = ObjTextScanning::findEndOfFaceToken(t, end);
+
+			if (t >= end || *t++ != '/')
+				return i;
+
+			if (t < end && *t == '/')
+			{
+				++t;
+			}
+			else
+			{
+				i.textureIndex = ObjTextScanning::readInt(t, end) - 1;
+				t = ObjTextScanning::findEndOfFaceToken(t, end);
+
+				if (t >= end || *t++ != '/')
+					return i;
+			}
+
+			i.normalIndex = ObjTextScanning::readInt(t, end) - 1;
+			t = ObjTextScanning::findEndOfFaceToken(t, end);
+			return i;
+		}
+
+		ArenaArray<TripleIndex> corners;
+		ArenaArray<int> faceStarts;
+	};
+
+	/** How many of each kind of record a run of lines holds, found by a quick pass over it before
+		it's parsed, so that every array the parser fills can be allocated once at its final size.
+	*/
+	struct RecordCounts
+	{
+		RecordCounts() noexcept : vertices(0), normals(0), textureCoords(0), faces(0), corners(0) {}
+
+		static RecordCounts count(const char* text, size_t numBytes, bool isNullTerminated)
+		{
+			RecordCounts counts;
+			LineReader lines(text, numBytes, isNullTerminated);
+			const char* lineStart;
+			const char* end;
+
+			while (lines.next(lineStart, end))
+			{
+				auto l = skipWhitespace(lineStart, end);
+
+				if (matchToken(l, end, "v"))  { ++counts.vertices;      continue; }
+				if (matchToken(l, end, "vn")) { ++counts.normals;       continue; }
+				if (matchToken(l, end, "vt")) { ++counts.textureCoords; continue; }
+
+				if (matchToken(l, end, "f"))
+				{
+					++counts.faces;
+
+					// The same steps FaceList::addFace() takes, one per corner
+					while (l < end)
+					{
+						++counts.corners;
+						l = skipWhitespace(l, end);
+
+						l = findEndOfToken(l, end);
+					}
+				}
+			}
+
+			return counts;
+		}
+
+		int vertices, normals, textureCoords, faces, corners;
+	};
+
+	//==============================================================================
+	/** A g/o, s, usemtl or mtllib line found while parsing a chunk. These can't be acted on until
+		the chunks before it have been parsed, so they're replayed in order afterwards.
+	*/
+	struct ChunkRecord
+	{
+		enum Type { groupRecord, smoothingGroupRecord, useMaterialRecord, materialLibraryRecord };
+
+		Type type;
+		int faceIndex;          // how many of the chunk's faces came before this line
+		ElementCounts counts;   // how many of the chunk's elements came before this line
+		const char* argument;   // a null-terminated copy in the parse's arena
+	};
+
+	/** Everything parsed from one run of lines. Element indices in the faces are still relative
+		to the whole file, so the chunks' elements just need to be appended in order.
+	*/
+	struct ParsedChunk
+	{
+		explicit ParsedChunk(MonotonicArena& arenaToUse)
+			: arena(arenaToUse), faces(arenaToUse), records(arenaToUse), stoppedAtNullCharacter(false)
+		{
+		}
+
+		MonotonicArena& arena;
+		Mesh mesh;
+		FaceList faces;
+		ArenaArray<ChunkRecord> records;
+		bool stoppedAtNullCharacter;
+	};
+
+	/** The faces that will become one shape, which may run across several chunks. */
+	struct PendingGroup
+	{
+		explicit PendingGroup(MonotonicArena& arena)
+			: faceRanges(arena), material(nullptr), name("")
+		{
+		}
+
+		struct FaceRange { const FaceList* faces; int start, end; juce::uint32 smoothingGroup; };
+
+		ArenaArray<FaceRange> faceRanges;
+		ElementCounts available;
+		const Material* material;
+		const char* name;
+	};
+
+	/** The materials of one .mtl file, indexed by name. If a name is defined more than once,
+		the last definition wins, as it always has.
+	*/
+	struct MaterialLibrary
+	{
+		Array<Material> materials;
+		HashMap<String, int> indexByName;
+
+		const Material* find(const char* name) const
+		{
+			auto key = String(CharPointer_UTF8(name));
+			return indexByName.contains(key) ? &materials.getReference(indexByName[key]) : nullptr;
+		}
+	};
+
+	/** Builds a group's shape. If triangleGroups isn't null, it's filled with the smoothing
+		group of each of the shape's triangles.
+	*/
+	template <typename IndexMapType>
+	static Shape* parseFaceGroup(const Mesh& srcMesh, const PendingGroup& group, const Material& material,
+								 IndexMap::TablePool& tablePool, Array<juce::uint32>* triangleGroups,
+								 const LoadProgress* progress)
+	{
+		std::unique_ptr<Shape> shape(new Shape());
+		shape->name = String(CharPointer_UTF8(group.name));
+		shape->material = material;
+
+		// The number of indices is known exactly. A group can't have more distinct vertices than
+		// it has face corners, nor (usually) many more than the file has elements of each kind.
+		auto numCorners = 0, numIndices = 0;
+
+		for (auto& range : group.faceRanges)
+		{
+			for (auto i = range.start; i < range.end; ++i)
+			{
+				auto n = range.faces->getNumCorners(i);
+				numCorners += n;
+				numIndices += jmax(0, n - 2) * 3;
+			}
+		}
+
+		auto& mesh = shape->mesh;
+		auto& available = group.available;
+		mesh.indices.ensureStorageAllocated(numIndices);
+		mesh.vertices.ensureStorageAllocated(jmin(numCorners, available.vertices));
+		mesh.normals.ensureStorageAllocated(jmin(numCorners, available.normals));
+		mesh.textureCoords.ensureStorageAllocated(jmin(numCorners, available.textureCoords));
+
+		IndexMapType indexMap(jmin(numCorners, jmax(16, available.vertices)), tablePool);
+
+		if (triangleGroups != nullptr)
+			triangleGroups->ensureStorageAllocated(numIndices / 3);
+
+		for (auto& range : group.faceRanges)
+		{
+			auto rangeStart = mesh.indices.size();
+
+			for (auto i = range.start; i < range.end; ++i)
+			{
+				if ((i & 0xffff) == 0 && isCancelled(progress))
+					return nullptr;
+
+				range.faces->addIndices(i, mesh, srcMesh, available, indexMap);
+			}
+
+			if (triangleGroups != nullptr)
+				triangleGroups->insertMultiple(-1, range.smoothingGroup, (mesh.indices.size() - rangeStart) / 3);
+		}
+
+		return shape.release();
+	}
+
+	/** Adds the time between its construction and destruction to a LoadStatistics phase. */
+	struct ScopedPhaseTimer
+	{
+		explicit ScopedPhaseTimer(double& phaseSeconds) noexcept
+			: seconds(phaseSeconds), start(Time::getHighResolutionTicks())
+		{
+		}
+
+		~ScopedPhaseTimer()
+		{
+			seconds += Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+		}
+
+		double& seconds;
+		const int64 start;
+
+		JUCE_DECLARE_NON_COPYABLE(ScopedPhaseTimer)
+	};
+
+	/** Faces that come before any s record are smoothed together, rather than left flat as the
+		format says, since files without normals or s records would otherwise all look faceted.
+	*/
+	enum { defaultSmoothingGroup = 0xffffffff };
+
+	/** Reads the argument of an s record: a group number, or "off", which is group 0. */
+	static juce::uint32 parseSmoothingGroup(const char* argument) noexcept
+	{
+		auto end = argument + strlen(argument);
+
+		if (end - argument == 3 && memcmp(argument, "off", 3) == 0)
+			return NormalGenerator::flatGroup;
+
+		return (juce::uint32)jmax(0, ObjTextScanning::readInt(argument, end));
+	}
+
+	static bool isCancelled(const LoadProgress* progress) noexcept
+	{
+		return progress != nullptr && progress->shouldCancel.load(std::memory_order_relaxed);
+	}
+
+	static void parseChunk(ParsedChunk& chunk, const char* text, size_t numBytes, bool isNullTerminated,
+						   LoadProgress* progress)
+	{
+		auto addRecord = [&chunk] (ChunkRecord::Type type, const char* argumentStart, const char* argumentEnd)
+		{
+			chunk.records.add({ type, chunk.faces.size(), ElementCounts::of(chunk.mesh),
+								chunk.arena.copyString(argumentStart, argumentEnd) });
+		};
+
+		auto counts = RecordCounts::count(text, numBytes, isNullTerminated);
+		chunk.mesh.vertices.ensureStorageAllocated(counts.vertices);
+		chunk.mesh.normals.ensureStorageAllocated(counts.normals);
+		chunk.mesh.textureCoords.ensureStorageAllocated(counts.textureCoords);
+		chunk.faces.ensureStorageAllocated(counts.faces, counts.corners);
+
+		LineReader lines(text, numBytes, isNullTerminated);
+		const char* lineStart;
+		const char* end;
+
+		auto lastReportedPosition = text;
+		auto numLinesSinceReport = 0;
+
+		auto reportProgress = [&]
+		{
+			if (progress != nullptr)
+			{
+				auto position = jmin(lines.text, text + numBytes);
+				progress->bytesProcessed += (int64)(position - lastReportedPosition);
+				progress->linesProcessed += numLinesSinceReport;
+				lastReportedPosition = position;
+				numLinesSinceReport = 0;
+			}
+		};
+
+		while (lines.next(lineStart, end))
+		{
+			if (++numLinesSinceReport == 8192)
+			{
+				reportProgress();
+
+				if (isCancelled(progress))
+					return;
+			}
+
+			auto l = skipWhitespace(lineStart, end);
+
+			if (matchToken(l, end, "v")) { chunk.mesh.vertices.add(parseVertex(l, end));            continue; }
+			if (matchToken(l, end, "vn")) { chunk.mesh.normals.add(parseVertex(l, end));             continue; }
+			if (matchToken(l, end, "vt")) { chunk.mesh.textureCoords.add(parseTextureCoord(l, end)); continue; }
+			if (matchToken(l, end, "f")) { chunk.faces.addFace(l, end);                             continue; }
+
+			if (matchToken(l, end, "usemtl")) { trim(l, end); addRecord(ChunkRecord::useMaterialRecord, l, end);     continue; }
+			if (matchToken(l, end, "mtllib")) { trim(l, end); addRecord(ChunkRecord::materialLibraryRecord, l, end); continue; }
+
+			if (matchToken(l, end, "g") || matchToken(l, end, "o"))
+			{
+				addRecord(ChunkRecord::groupRecord, l, findEndOfToken(l, end));
+				continue;
+			}
+
+			if (matchToken(l, end, "s"))
+			{
+				addRecord(ChunkRecord::smoothingGroupRecord, l, findEndOfToken(l, end));
+				continue;
+			}
+		}
+
+		reportProgress();
+		chunk.stoppedAtNullCharacter = lines.stoppedAtNullCharacter();
+	}
+
+	/** Picks the start of each chunk, moving each split point forward to the start of a line. */
+	static Array<size_t> findChunkBoundaries(const char* text, size_t numBytes, int numChunks)
+	{
+		Array<size_t> boundaries;
+		boundaries.add(0);
+
+		for (auto i = 1; i < numChunks; ++i)
+		{
+			auto pos = jmax(boundaries.getLast(), (size_t)((juce::uint64)numBytes * (juce::uint64)i / (juce::uint64)numChunks));
+
+			while (pos < numBytes && text[pos] != '\n' && text[pos] != '\r')
+				++pos;
+
+			if (pos < numBytes && text[pos++] == '\r' && pos < numBytes && text[pos] == '\n')
+				++pos;
+
+			if (pos >= numBytes)
+				break;
+
+			if (pos > boundaries.getLast())
+				boundaries.add(pos);
+		}
+
+		boundaries.add(numBytes);
+		return boundaries;
+	}
+
+	int getNumThreadsToUse() const
+	{
+		return loadOptions.numThreads > 0 ? loadOptions.numThreads : SystemStats::getNumCpus();
+	}
+
+	Result parseObjFile(const char* text, size_t numBytes, bool isNullTerminated)
+	{
+		MonotonicArena arena;
+		auto result = parseObjFile(text, numBytes, isNullTerminated, arena);
+		statistics.numBytes = (int64)numBytes;
+		statistics.arena = arena.getStatistics();
+		return result;
+	}
+
+	Result parseObjFile(const char* text, size_t numBytes, bool isNullTerminated, MonotonicArena& arena)
+	{
+		const size_t minBytesPerChunk = 1024 * 1024;
+
+		auto numThreads = getNumThreadsToUse();
+		auto numChunks = (int) jmin((size_t)(numThreads * 4), jmax((size_t) 1, numBytes / minBytesPerChunk));
+
+		if (numThreads <= 1)
+			numChunks = 1;
+
+		auto boundaries = findChunkBoundaries(text, numBytes, numChunks);
+		numChunks = boundaries.size() - 1;
+
+		auto* progress = loadOptions.progress;
+
+		if (progress != nullptr)
+			progress->totalBytes = (int64)numBytes;
+
+		OwnedArray<ParsedChunk> chunks;
+
+		for (auto i = 0; i < numChunks; ++i)
+			chunks.add(new ParsedChunk(arena));
+
+		{
+			const ScopedPhaseTimer timer(statistics.tokenizeSeconds);
+
+			parallelFor(numChunks, numThreads, [&] (int i)
+			{
+				auto isLastChunk = (i == numChunks - 1);
+
+				parseChunk(*chunks.getUnchecked(i), text + boundaries[i], boundaries[i + 1] - boundaries[i],
+						   isLastChunk ? isNullTerminated : true, progress);
+			});
+		}
+
+		if (isCancelled(progress))
+			return Result::fail("Loading was cancelled");
+
+		auto groupBuildStart = Time::getHighResolutionTicks();
+
+		// The serial parser would have stopped at a null character, so drop anything after one
+		for (auto i = 0; i < chunks.size(); ++i)
+		{
+			if (chunks.getUnchecked(i)->stoppedAtNullCharacter)
+			{
+				chunks.removeRange(i + 1, chunks.size());
+				break;
+			}
+		}
+
+		Mesh mesh;
+		Array<ElementCounts> chunkStarts;
+		ElementCounts total = { 0, 0, 0 };
+
+		for (auto* chunk : chunks)
+		{
+			chunkStarts.add(total);
+			total = total + ElementCounts::of(chunk->mesh);
+			statistics.numFaces += chunk->faces.size();
+		}
+
+		if (chunks.size() == 1)
+		{
+			mesh.vertices.swapWith(chunks.getFirst()->mesh.vertices);
+			mesh.normals.swapWith(chunks.getFirst()->mesh.normals);
+			mesh.textureCoords.swapWith(chunks.getFirst()->mesh.textureCoords);
+		}
+		else
+		{
+			mesh.vertices.ensureStorageAllocated(total.vertices);
+			mesh.normals.ensureStorageAllocated(total.normals);
+			mesh.textureCoords.ensureStorageAllocated(total.textureCoords);
+
+			for (auto* chunk : chunks)
+			{
+				mesh.vertices.addArray(chunk->mesh.vertices);
+				mesh.normals.addArray(chunk->mesh.normals);
+				mesh.textureCoords.addArray(chunk->mesh.textureCoords);
+				chunk->mesh = Mesh();
+			}
+		}
+
+		// Now replay the records in file order, to find where each group starts and ends,
+		// and which material and name it was given. Each library is only read the first time
+		// it's named, and stays alive until the shapes have been built.
+		OwnedArray<MaterialLibrary> libraries;
+		HashMap<String, MaterialLibrary*> librariesByPath;
+		const MaterialLibrary* currentLibrary = nullptr;
+
+		const Material defaultMaterial;
+		auto* lastMaterial = &defaultMaterial;
+		const char* lastName = "";
+
+		ArenaArray<PendingGroup*> groups(arena);
+		auto* currentGroup = arena.create<PendingGroup>(arena);
+		auto smoothingGroup = (juce::uint32)defaultSmoothingGroup;
+
+		auto addFaces = [&] (const ParsedChunk& chunk, int start, int end)
+		{
+			if (end > start)
+				currentGroup->faceRanges.add({ &chunk.faces, start, end, smoothingGroup });
+		};
+
+		auto endGroup = [&] (const ElementCounts& available)
+		{
+			if (currentGroup->faceRanges.size() > 0)
+			{
+				currentGroup->available = available;
+				currentGroup->material = lastMaterial;
+				currentGroup->name = lastName;
+				groups.add(currentGroup);
+				currentGroup = arena.create<PendingGroup>(arena);
+			}
+		};
+
+		for (auto chunkIndex = 0; chunkIndex < chunks.size(); ++chunkIndex)
+		{
+			auto& chunk = *chunks.getUnchecked(chunkIndex);
+			auto nextFace = 0;
+
+			for (auto& record : chunk.records)
+			{
+				addFaces(chunk, nextFace, record.faceIndex);
+				nextFace = record.faceIndex;
+
+				if (record.type == ChunkRecord::smoothingGroupRecord)
+				{
+					smoothingGroup = parseSmoothingGroup(record.argument);
+				}
+				else if (record.type == ChunkRecord::useMaterialRecord)
+				{
+					if (currentLibrary != nullptr)
+						if (auto* material = currentLibrary->find(record.argument))
+							lastMaterial = material;
+				}
+				else if (record.type == ChunkRecord::materialLibraryRecord)
+				{
+					// A library that can't be opened leaves the current one in place
+					if (auto* library = findMaterialLibrary(String(CharPointer_UTF8(record.argument)), libraries, librariesByPath))
+						currentLibrary = library;
+				}
+				else
+				{
+					endGroup(chunkStarts.getReference(chunkIndex) + record.counts);
+					lastName = record.argument;
+				}
+			}
+
+			addFaces(chunk, nextFace, chunk.faces.size());
+		}
+
+		endGroup(total);
+
+		statistics.groupBuildSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - groupBuildStart);
+		const ScopedPhaseTimer dedupTimer(statistics.dedupSeconds);
+
+		// Each group is independent, so their vertices can be de-duplicated in parallel
+		Array<Shape*> newShapes;
+		newShapes.insertMultiple(0, nullptr, groups.size());
+		IndexMap::TablePool tablePool(arena);
+
+		// When normals will be generated, each shape's triangles also need their smoothing groups
+		Array<Array<juce::uint32>> triangleGroups;
+
+		if (loadOptions.generateNormals)
+			triangleGroups.insertMultiple(0, {}, groups.size());
+
+		parallelFor(groups.size(), numThreads, [&] (int i)
+		{
+			auto& group = *groups.getUnchecked(i);
+			auto& material = *group.material;
+			auto* groupsOfTriangles = loadOptions.generateNormals ? &triangleGroups.getReference(i) : nullptr;
+
+			newShapes.setUnchecked(i, loadOptions.useOrderedIndexMap ? parseFaceGroup<OrderedIndexMap>(mesh, group, material, tablePool, groupsOfTriangles, progress)
+																	 : parseFaceGroup<IndexMap>(mesh, group, material, tablePool, groupsOfTriangles, progress));
+		});
+
+		if (isCancelled(progress))
+		{
+			for (auto* shape : newShapes)
+				delete shape;
+
+			return Result::fail("Loading was cancelled");
+		}
+
+		if (loadOptions.generateNormals)
+			generateNormals(newShapes, triangleGroups, numThreads);
+
+		if (loadOptions.optimiseMeshes)
+			optimiseShapes(newShapes, numThreads);
+
+		if (loadOptions.buildMeshlets)
+			buildMeshlets(newShapes, numThreads);
+
+		if (loadOptions.buildLevelsOfDetail)
+		{
+			buildLevelsOfDetail(newShapes, numThreads);
+
+			if (isCancelled(progress))
+			{
+				for (auto* shape : newShapes)
+					delete shape;
+
+				return Result::fail("Loading was cancelled");
+			}
+		}
+
+		for (auto* shape : newShapes)
+			shapes.add(shape);
+
+		return Result::ok();
+	}
+
+	void optimiseShapes(const Array<Shape*>& newShapes, int numThreads)
+	{
+		const ScopedPhaseTimer timer(statistics.optimiseSeconds);
+
+		Array<MeshOptimiser::Report> reports;
+		reports.insertMultiple(0, {}, newShapes.size());
+
+		parallelFor(newShapes.size(), numThreads, [&] (int i)
+		{
+			if (!MeshOptimiser::optimise(newShapes.getUnchecked(i)->mesh, reports.getReference(i)))
+				reports.getReference(i).numTriangles = 0;
+		});
+
+		for (auto& report : reports)
+		{
+			statistics.acmrBefore += report.acmrBefore * report.numTriangles;
+			statistics.acmrAfter += report.acmrAfter * report.numTriangles;
+			statistics.numOptimisedTriangles += report.numTriangles;
+		}
+
+		if (statistics.numOptimisedTriangles > 0)
+		{
+			statistics.acmrBefore /= (double)statistics.numOptimisedTriangles;
+			statistics.acmrAfter /= (double)statistics.numOptimisedTriangles;
+		}
+	}
+
+	void generateNormals(const Array<Shape*>& newShapes, const Array<Array<juce::uint32>>& triangleGroups, int numThreads)
+	{
+		const ScopedPhaseTimer timer(statistics.normalSeconds);
+
+		auto generate = [&] (int i, int threadsPerShape)
+		{
+			auto& mesh = newShapes.getUnchecked(i)->mesh;
+			auto& groups = triangleGroups.getReference(i);
+
+			NormalGenerator::Options options;
+			options.creaseAngle = loadOptions.creaseAngle;
+			options.numThreads = threadsPerShape;
+			NormalGenerator::generate(mesh, groups.size() == mesh.indices.size() / 3 ? groups.begin() : nullptr, options);
+		};
+
+		// Big shapes are shared out over every thread in turn, and the rest get a thread each
+		Array<int> smallShapes;
+
+		for (auto i = 0; i < newShapes.size(); ++i)
+		{
+			auto numThreadsForShape = newShapes.getUnchecked(i)->mesh.indices.size() / (3 * (int)NormalGenerator::minTrianglesPerThread);
+
+			if (numThreadsForShape > 1)
+				generate(i, jmin(numThreads, numThreadsForShape));
+			else
+				smallShapes.add(i);
+		}
+
+		parallelFor(smallShapes.size(), numThreads, [&] (int i)
+		{
+			generate(smallShapes.getUnchecked(i), 1);
+		});
+	}
+
+	void buildMeshlets(const Array<Shape*>& newShapes, int numThreads)
+	{
+		const ScopedPhaseTimer timer(statistics.meshletSeconds);
+
+		parallelFor(newShapes.size(), numThreads, [&] (int i)
+		{
+			auto& mesh = newShapes.getUnchecked(i)->mesh;
+			mesh.meshlets = MeshletBuilder::build(mesh.indices.begin(), mesh.indices.size(),
+												  mesh.vertices.begin(), mesh.vertices.size());
+		});
+	}
+
+	void buildLevelsOfDetail(const Array<Shape*>& newShapes, int numThreads)
+	{
+		const ScopedPhaseTimer timer(statistics.levelOfDetailSeconds);
+
+		auto* progress = loadOptions.progress;
+		auto optimiseLevels = loadOptions.optimiseMeshes;
+
+		parallelFor(newShapes.size(), numThreads, [&] (int i)
+		{
+			buildLevelsOfDetail(newShapes.getUnchecked(i)->mesh, optimiseLevels, progress);
+		});
+	}
+
+	/** Simplifies a mesh into levels of about half the triangles each, until a level is small,
+		or the simplifier can't make much headway (a mesh that's all borders and seams, say).
+	*/
+	static void buildLevelsOfDetail(Mesh& mesh, bool optimiseLevels, const LoadProgress* progress)
+	{
+		const int maxNumLevels = 8, minNumTriangles = 64;
+		auto numVertices = mesh.vertices.size();
+
+		for (auto index : mesh.indices)
+			if (index >= (Index)numVertices)
+				return;
+
+		auto error = 0.0f;
+
+		while (mesh.levelsOfDetail.size() < maxNumLevels && !isCancelled(progress))
+		{
+			auto& source = mesh.levelsOfDetail.isEmpty() ? mesh.indices : mesh.levelsOfDetail.getReference(mesh.levelsOfDetail.size() - 1).indices;
+			auto numTriangles = source.size() / 3;
+
+			if (numTriangles < minNumTriangles * 2)
+				break;
+
+			LevelOfDetail level;
+			auto levelError = 0.0f;
+			level.indices = MeshSimplifier::simplify(source.begin(), source.size(), mesh.vertices.begin(), numVertices,
+													 numTriangles / 2 * 3, levelError);
+
+			if (level.indices.size() > source.size() / 10 * 9)
+				break;
+
+			// Each level is simplified from the one before, so adding up their errors gives a
+			// bound on how far it is from the full detail
+			error += levelError;
+			level.error = error;
+
+			if (optimiseLevels)
+				MeshOptimiser::optimiseVertexCache(level.indices.begin(), level.indices.size(), numVertices);
+
+			mesh.levelsOfDetail.add(std::move(level));
+		}
+	}
+
+	/** Returns the library for an mtllib name, reading it if this is the first time it has been
+		named, or nullptr if it can't be opened.
+	*/
+	MaterialLibrary* findMaterialLibrary(const String& filename, OwnedArray<MaterialLibrary>& libraries,
+										 HashMap<String, MaterialLibrary*>& librariesByPath)
+	{
+		jassert(sourceFile.exists());
+		auto f = sourceFile.getSiblingFile(filename);
+		auto path = f.getFullPathName();
+
+		if (librariesByPath.contains(path))
+			return librariesByPath[path];
+
+		std::unique_ptr<MaterialLibrary> library(new MaterialLibrary());
+		MaterialLibrary* result = nullptr;
+
+		if (parseMaterial(library->materials, f).wasOk())
+		{
+			for (auto i = 0; i < library->materials.size(); ++i)
+			{
+				auto& material = library->materials.getReference(i);
+				library->indexByName.set(material.name, i);
+				queueTextures(material);
+			}
+
+			result = libraries.add(library.release());
+		}
+
+		librariesByPath.set(path, result);
+		return result;
+	}
+
+	/** Starts decoding the texture maps a material refers to, if LoadOptions::textures is set. */
+	void queueTextures(const Material& material) const
+	{
+		if (auto* textures = loadOptions.textures)
+			for (auto* name : { &material.diffuseTextureName, &material.specularTextureName, &material.normalTextureName })
+				if (name->isNotEmpty())
+					textures->addTexture(getTextureFile(*name));
+	}
+
+	Result parseMaterial(Array<Material>& materials, const File& f)
+	{
+		dependencies.add(ObjMeshCache::SourceInfo::of(f));
+
+		if (!f.exists())
+			return Result::fail("Cannot open file: " + f.getFileName());
+
+		SourceText text(f, loadOptions.useMemoryMappedFile);
+		LineReader lines(text.data, text.numBytes, text.isNullTerminated);
+		const char* lineStart;
+		const char* end;
+
+		Material material;
+
+		while (lines.next(lineStart, end))
+		{
+			auto l = skipWhitespace(lineStart, end);
+
+			if (matchToken(l, end, "newmtl")) { materials.add(material); material.name = trimmedString(l, end); continue; }
+
+			if (matchToken(l, end, "Ka")) { material.ambient = parseVertex(l, end); continue; }
+			if (matchToken(l, end, "Kd")) { material.diffuse = parseVertex(l, end); continue; }
+			if (matchToken(l, end, "Ks")) { material.specular = parseVertex(l, end); continue; }
+			if (matchToken(l, end, "Kt")) { material.transmittance = parseVertex(l, end); continue; }
+			if (matchToken(l, end, "Ke")) { material.emission = parseVertex(l, end); continue; }
+			if (matchToken(l, end, "Ni")) { material.refractiveIndex = parseFloat(l, end);  continue; }
+			if (matchToken(l, end, "Ns")) { material.shininess = parseFloat(l, end);  continue; }
+
+			if (matchToken(l, end, "map_Ka")) { material.ambientTextureName = trimmedString(l, end); continue; }
+			if (matchToken(l, end, "map_Kd")) { material.diffuseTextureName = trimmedString(l, end); continue; }
+			if (matchToken(l, end, "map_Ks")) { material.specularTextureName = trimmedString(l, end); continue; }
+			if (matchToken(l, end, "map_Ns")) { material.normalTextureName = trimmedString(l, end); continue; }
+
+			// Any other line is a parameter: its first two space- or tab-separated tokens
+			auto keyEnd = findEndOfToken(l, end);
+
+			if (keyEnd < end)
+				material.parameters.set(trimmedString(l, keyEnd), trimmedString(keyEnd + 1, findEndOfToken(keyEnd + 1, end)));
+		}
+
+		materials.add(material);
+		return Result::ok();
+	}
+
+	//==============================================================================
+	static_assert(sizeof(Vertex) == sizeof(ObjMeshCache::Float3), "Vertex must match the cache layout");
+	static_assert(sizeof(TextureCoord) == sizeof(float) * 2, "TextureCoord must match the cache layout");
+	static_assert(sizeof(Index) == sizeof(juce::uint32), "Index must match the cache layout");
+
+	static ObjMeshCache::Float3 toCache(const Vertex& v) noexcept      { return { v.x, v.y, v.z }; }
+	static Vertex fromCache(const ObjMeshCache::Float3& v) noexcept    { return { v.x, v.y, v.z }; }
+
+	static ObjMeshCache::MeshletRecord toCache(const Meshlet& m) noexcept
+	{
+		ObjMeshCache::MeshletRecord record;
+		record.firstIndex = m.firstIndex;
+		record.numIndices = m.numIndices;
+		record.numVertices = m.numVertices;
+		record.reserved = 0;
+		record.centre = { m.centre[0], m.centre[1], m.centre[2] };
+		record.radius = m.radius;
+		record.boundsMin = { m.boundsMin[0], m.boundsMin[1], m.boundsMin[2] };
+		record.boundsMax = { m.boundsMax[0], m.boundsMax[1], m.boundsMax[2] };
+		record.coneApex = { m.coneApex[0], m.coneApex[1], m.coneApex[2] };
+		record.coneAxis = { m.coneAxis[0], m.coneAxis[1], m.coneAxis[2] };
+		record.coneCutoff = m.coneCutoff;
+		return record;
+	}
+
+	static Meshlet fromCache(const ObjMeshCache::MeshletRecord& record) noexcept
+	{
+		Meshlet m;
+		m.firstIndex = record.firstIndex;
+		m.numIndices = record.numIndices;
+		m.numVertices = record.numVertices;
+		copyFloat3(record.centre, m.centre);
+		m.radius = record.radius;
+		copyFloat3(record.boundsMin, m.boundsMin);
+		copyFloat3(record.boundsMax, m.boundsMax);
+		copyFloat3(record.coneApex, m.coneApex);
+		copyFloat3(record.coneAxis, m.coneAxis);
+		m.coneCutoff = record.coneCutoff;
+		return m;
+	}
+
+	static void copyFloat3(const ObjMeshCache::Float3& v, float* dest) noexcept
+	{
+		dest[0] = v.x;
+		dest[1] = v.y;
+		dest[2] = v.z;
+	}
+
+	/** The bits that ObjMeshCache::Header::loadFlags holds, for the options that change the shapes. */
+	enum CacheLoadFlags
+	{
+		optimisedMeshesFlag = 1,
+		levelsOfDetailFlag = 2,
+		meshletsFlag = 4,
+		generatedNormalsFlag = 8,
+		compressedCacheFlag = 16,
+		creaseAngleShift = 8,        // the crease angle, in whole degrees, goes in bits 8 to 15
+		codecBitsShift = 16          // MeshCodec's three bit counts go in bits 16 to 30, five bits each
+	};
+
+	juce::uint32 getCacheLoadFlags() const noexcept
+	{
+		auto normalFlags = loadOptions.generateNormals
+							 ? ((juce::uint32)generatedNormalsFlag
+								 | (juce::uint32)jlimit(0, 180, roundToInt(loadOptions.creaseAngle)) << creaseAngleShift)
+							 : 0;
+
+		auto& codec = loadOptions.cacheCodecOptions;
+		auto compressionFlags = loadOptions.compressCache
+								  ? ((juce::uint32)compressedCacheFlag
+									  | getCodecBits(codec.positionBits) << codecBitsShift
+									  | getCodecBits(codec.normalBits) << (codecBitsShift + 5)
+									  | getCodecBits(codec.textureCoordBits) << (codecBitsShift + 10))
+								  : 0;
+
+		return (loadOptions.optimiseMeshes ? (juce::uint32)optimisedMeshesFlag : 0)
+			 | (loadOptions.buildLevelsOfDetail ? (juce::uint32)levelsOfDetailFlag : 0)
+			 | (loadOptions.buildMeshlets ? (juce::uint32)meshletsFlag : 0)
+			 | normalFlags | compressionFlags;
+	}
+
+	static juce::uint32 getCodecBits(int bits) noexcept
+	{
+		return (juce::uint32)jlimit(0, (int)MeshCodec::maxQuantisationBits, bits);
+	}
+
+	File getCacheFile() const
+	{
+		return ObjMeshCache::getCacheFileFor(sourceFile, loadOptions.cacheDirectory);
+	}
+
+	bool loadFromCache(const ObjMeshCache::SourceInfo& source)
+	{
+		ObjMeshCache::Reader reader;
+
+		if (!reader.open(getCacheFile(), source, parserVersion, getCacheLoadFlags()))
+			return false;
+
+		Array<int> encodedShapes;
+
+		for (auto i = 0; i < reader.getNumShapes(); ++i)
+		{
+			auto& record = reader.getShape(i);
+			auto* shape = shapes.add(new Shape());
+
+			shape->name = reader.getString(record.name);
+
+			if (record.encodedMesh.numElements > 0)
+				encodedShapes.add(i);
+
+			auto& mesh = shape->mesh;
+			mesh.vertices.addArray(reader.getArray<Vertex>(record.vertices), (int)record.vertices.numElements);
+			mesh.normals.addArray(reader.getArray<Vertex>(record.normals), (int)record.normals.numElements);
+			mesh.textureCoords.addArray(reader.getArray<TextureCoord>(record.textureCoords), (int)record.textureCoords.numElements);
+			mesh.indices.addArray(reader.getArray<Index>(record.indices), (int)record.indices.numElements);
+
+			auto* levelIndices = reader.getArray<Index>(record.levelIndices);
+			auto* levels = reader.getArray<ObjMeshCache::LevelRecord>(record.levels);
+
+			for (juce::uint32 l = 0; l < record.levels.numElements; ++l)
+			{
+				if ((juce::uint64)levels[l].firstIndex + levels[l].numIndices > (juce::uint64)record.levelIndices.numElements)
+				{
+					shapes.clear();
+					return false;
+				}
+
+				LevelOfDetail level;
+				level.indices.addArray(levelIndices + levels[l].firstIndex, (int)levels[l].numIndices);
+				level.error = levels[l].error;
+				mesh.levelsOfDetail.add(std::move(level));
+			}
+
+			auto* meshlets = reader.getArray<ObjMeshCache::MeshletRecord>(record.meshlets);
+
+			for (juce::uint32 c = 0; c < record.meshlets.numElements; ++c)
+				mesh.meshlets.add(fromCache(meshlets[c]));
+
+			// The codec checks the shapes it decodes; these ones are checked here, so that a
+			// damaged file never gets as far as a GL index buffer
+			if (record.encodedMesh.numElements == 0 && !hasIndicesInRange(mesh))
+			{
+				shapes.clear();
+				return false;
+			}
+
+			auto& m = record.material;
+			auto& material = shape->material;
+			material.name = reader.getString(m.name);
+			material.ambient = fromCache(m.ambient);
+			material.diffuse = fromCache(m.diffuse);
+			material.specular = fromCache(m.specular);
+			material.transmittance = fromCache(m.transmittance);
+			material.emission = fromCache(m.emission);
+			material.shininess = m.shininess;
+			material.refractiveIndex = m.refractiveIndex;
+			material.ambientTextureName = reader.getString(m.ambientTextureName);
+			material.diffuseTextureName = reader.getString(m.diffuseTextureName);
+			material.specularTextureName = reader.getString(m.specularTextureName);
+			material.normalTextureName = reader.getString(m.normalTextureName);
+
+			auto* parameters = reader.getArray<ObjMeshCache::StringRecord>(m.parameters);
+
+			for (juce::uint32 p = 0; p + 1 < m.parameters.numElements; p += 2)
+				material.parameters.set(reader.getString(parameters[p]), reader.getString(parameters[p + 1]));
+		}
+
+		// The compressed shapes are decoded a shape per thread. A block that doesn't decode
+		// sends the load back to the .obj file, like any other bad cache file would
+		std::atomic<bool> decodedAll(true);
+
+		parallelFor(encodedShapes.size(), getNumThreadsToUse(), [&] (int i)
+		{
+			auto index = encodedShapes.getUnchecked(i);
+			auto& record = reader.getShape(index).encodedMesh;
+
+			if (!MeshCodec::decode(reader.getArray<char>(record), record.numElements, shapes.getUnchecked(index)->mesh))
+				decodedAll = false;
+		});
+
+		if (!decodedAll)
+		{
+			shapes.clear();
+			return false;
+		}
+
+		for (auto* shape : shapes)
+			queueTextures(shape->material);
+
+		for (auto i = 0; i < reader.getNumDependencies(); ++i)
+			dependencies.add(reader.getDependency(i));
+
+		if (auto* progress = loadOptions.progress)
+		{
+			progress->totalBytes = source.size;
+			progress->bytesProcessed = source.size;
+		}
+
+		loadedFromCache = true;
+		return true;
+	}
+
+	/** True if every index, at full detail and in each level of detail, is below the number
+		of vertices, and every meshlet's range is within the indices.
+	*/
+	static bool hasIndicesInRange(const Mesh& mesh) noexcept
+	{
+		auto numVertices = (Index)mesh.vertices.size();
+
+		auto allBelow = [numVertices] (const Array<Index>& indices)
+		{
+			for (auto index : indices)
+				if (index >= numVertices)
+					return false;
+
+			return true;
+		};
+
+		if (!allBelow(mesh.indices))
+			return false;
+
+		for (auto& level : mesh.levelsOfDetail)
+			if (!allBelow(level.indices))
+				return false;
+
+		for (auto& meshlet : mesh.meshlets)
+			if ((juce::uint64)meshlet.firstIndex + meshlet.numIndices > (juce::uint64)mesh.indices.size())
+				return false;
+
+		return true;
+	}
+
+	Result writeCache(const ObjMeshCache::SourceInfo& source) const
+	{
+		ObjMeshCache::Writer writer;
+
+		ObjMeshCache::Header header;
+		zerostruct(header);
+		header.parserVersion = parserVersion;
+		header.loadFlags = getCacheLoadFlags();
+		header.sourceSize = source.size;
+		header.sourceModificationTime = source.modificationTime;
+		header.sourcePath = writer.addString(source.path);
+
+		Array<ObjMeshCache::DependencyRecord> dependencyRecords;
+
+		for (auto& d : dependencies)
+			dependencyRecords.add({ writer.addString(d.path), d.size, d.modificationTime });
+
+		Array<ObjMeshCache::ShapeRecord> shapeRecords;
+		OwnedArray<Array<ObjMeshCache::StringRecord>> parameterRecords;
+		OwnedArray<Array<Index>> levelIndexArrays;
+		OwnedArray<Array<ObjMeshCache::LevelRecord>> levelRecordArrays;
+		OwnedArray<Array<ObjMeshCache::MeshletRecord>> meshletRecordArrays;
+		OwnedArray<MemoryBlock> encodedMeshes;
+		const Mesh noArrays;
+
+		for (auto* shape : shapes)
+		{
+			auto& material = shape->material;
+			auto* parameters = parameterRecords.add(new Array<ObjMeshCache::StringRecord>());
+
+			for (auto i = 0; i < material.parameters.size(); ++i)
+			{
+				parameters->add(writer.addString(material.parameters.getAllKeys()[i]));
+				parameters->add(writer.addString(material.parameters.getAllValues()[i]));
+			}
+
+			ObjMeshCache::ShapeRecord record;
+			zerostruct(record);
+			record.name = writer.addString(shape->name);
+
+			// With a compressed cache, the whole mesh goes into one encoded block, and the
+			// arrays that would otherwise hold it are written empty
+			auto& mesh = loadOptions.compressCache ? noArrays : shape->mesh;
+			auto* encoded = encodedMeshes.add(new MemoryBlock());
+
+			if (loadOptions.compressCache)
+				MeshCodec::encode(shape->mesh, loadOptions.cacheCodecOptions, *encoded);
+
+			record.encodedMesh = writer.addArray(encoded->getData(), (int)encoded->getSize(), 1);
+			record.vertices = writer.addArray(mesh.vertices);
+			record.normals = writer.addArray(mesh.normals);
+			record.textureCoords = writer.addArray(mesh.textureCoords);
+			record.indices = writer.addArray(mesh.indices);
+
+			// The levels' indices go into one block, and each level records its part of it
+			auto* levelIndices = levelIndexArrays.add(new Array<Index>());
+			auto* levelRecords = levelRecordArrays.add(new Array<ObjMeshCache::LevelRecord>());
+
+			for (auto& level : mesh.levelsOfDetail)
+			{
+				levelRecords->add({ (juce::uint32)levelIndices->size(), (juce::uint32)level.indices.size(), level.error, 0 });
+				levelIndices->addArray(level.indices);
+			}
+
+			record.levelIndices = writer.addArray(*levelIndices);
+			record.levels = writer.addArray(*levelRecords);
+
+			auto* meshletRecords = meshletRecordArrays.add(new Array<ObjMeshCache::MeshletRecord>());
+
+			for (auto& meshlet : mesh.meshlets)
+				meshletRecords->add(toCache(meshlet));
+
+			record.meshlets = writer.addArray(*meshletRecords);
+
+			auto& m = record.material;
+			m.name = writer.addString(material.name);
+			m.ambient = toCache(material.ambient);
+			m.diffuse = toCache(material.diffuse);
+			m.specular = toCache(material.specular);
+			m.transmittance = toCache(material.transmittance);
+			m.emission = toCache(material.emission);
+			m.shininess = material.shininess;
+			m.refractiveIndex = material.refractiveIndex;
+			m.ambientTextureName = writer.addString(material.ambientTextureName);
+			m.diffuseTextureName = writer.addString(material.diffuseTextureName);
+			m.specularTextureName = writer.addString(material.specularTextureName);
+			m.normalTextureName = writer.addString(material.normalTextureName);
+			m.parameters = writer.addArray(*parameters);
+
+			shapeRecords.add(record);
+		}
+
+		// The record tables go last, once nothing else will be added to them
+		header.dependencies = writer.addArray(dependencyRecords);
+		header.shapes = writer.addArray(shapeRecords);
+
+		return writer.writeTo(getCacheFile(), header);
+	}
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WavefrontObjFile)
+};
+
+
+#endif  // WAVEFRONTOBJFILE_H_INCLUDED